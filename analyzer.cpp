@@ -18,6 +18,20 @@ void DumpData(const vector<uint16_t> &x, unsigned int n)
 	printf("\n");
 }
 
+static void DecodeRaw(unsigned int raw, int &x, int &y, int &p)
+{
+	p = (raw & 0x0f) + ((raw >> 1) & 0xf0);
+	raw >>= 9;
+	int c =    (raw >> 12) & 7;
+	c = c*6 + ((raw >>  9) & 7);
+	int r =    (raw >>  6) & 7;
+	r = r*6 + ((raw >>  3) & 7);
+	r = r*6 + ( raw        & 7);
+	y = 80 - r/2;
+	x = 2*c + (r&1);
+}
+
+
 void DecodePixel(const vector<uint16_t> &x, int &pos, PixelReadoutData &pix)
 { PROFILING
 	pix.Clear();
@@ -41,15 +55,39 @@ void DecodePixel(const vector<uint16_t> &x, int &pos, PixelReadoutData &pix)
 	while (!(pos >= int(x.size()) || (x[pos] & 0x8000))) { pos++; cnt++; }
 	pix.n += cnt / 2;
 
-	pix.p = (raw & 0x0f) + ((raw >> 1) & 0xf0);
-	raw >>= 9;
-	int c =    (raw >> 12) & 7;
-	c = c*6 + ((raw >>  9) & 7);
-	int r =    (raw >>  6) & 7;
-	r = r*6 + ((raw >>  3) & 7);
-	r = r*6 + ( raw        & 7);
-	pix.y = 80 - r/2;
-	pix.x = 2*c + (r&1);
+	DecodeRaw(raw, pix.x, pix.y, pix.p);
+}
+
+
+void DecodePixels(const vector<uint16_t> &x, int &pos, unsigned int &hdr,
+	vector<PixelHit> &hits)
+{ PROFILING
+	hits.clear();
+
+	// check header
+	if (pos >= int(x.size())) throw int(1); // missing data
+	if ((x[pos] & 0x8ffc) != 0x87f8) throw int(2); // wrong header
+	hdr = x[pos++] & 0xfff;
+
+	// read pixel
+	while (!(pos >= int(x.size()) || (x[pos] & 0x8000)))
+	{
+		unsigned int raw = (x[pos++] & 0xfff) << 12;
+		if (pos >= int(x.size()) || (x[pos] & 0x8000)) throw int(3); // incomplete data
+		raw += x[pos++] & 0xfff;
+		PixelHit hit;
+		DecodeRaw(raw, hit.x, hit.y, hit.p);
+		hits.push_back(hit);
+	}
+}
+
+
+void DecodeModule(const vector<uint16_t> &x, int &pos, unsigned int nroc,
+	vector<unsigned int> &hdr, vector< vector<PixelHit> > &hits)
+{ PROFILING
+	hdr.resize(nroc);
+	hits.resize(nroc);
+	for (unsigned int i=0; i<nroc; i++) DecodePixels(x, pos, hdr[i], hits[i]);
 }
 
 
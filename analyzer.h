@@ -19,6 +19,23 @@ struct PixelReadoutData
 };
 
 
+struct PixelHit
+{
+	int x;
+	int y;
+	int p;  // pulse heigth
+};
+
+
 void DumpData(const vector<uint16_t> &x, unsigned int n);
 
 void DecodePixel(const std::vector<uint16_t> &x, int &pos, PixelReadoutData &pix);
+
+// decodes header and all pixel hits of a ROC readout
+void DecodePixels(const std::vector<uint16_t> &x, int &pos, unsigned int &hdr,
+	std::vector<PixelHit> &hits);
+
+// decodes one event of a module: header and hits of nroc ROCs in token
+// chain order (index = ROC)
+void DecodeModule(const std::vector<uint16_t> &x, int &pos, unsigned int nroc,
+	std::vector<unsigned int> &hdr, std::vector< std::vector<PixelHit> > &hits);
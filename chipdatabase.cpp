@@ -6,7 +6,11 @@
 
 #include "ps.h"
 #include "color.h"
+#include <algorithm>
 #include "chipdatabase.h"
+#include "parallel.h"
+#include "resultstore.h"
+#include "textbuffer.h"
 
 
 
@@ -171,6 +175,7 @@ void CChip::Invalidate()
 	pickGroup = 99;
 	nPh = 0;
 	nPhFail = 0;
+	trimVcal = trimVthrComp = trimVtrim = -1;
 	pixmap.Init();
 	dcol.Init();
 }
@@ -238,8 +243,10 @@ void CChip::Save(FILE *f)
 }
 
 
-bool CChip::Read(CScanner &Log)
+bool CChip::Read(CScanner &Log, CPixelMap *map)
 {
+	CPixelMap &pmap = map ? *map : *pixmap;
+
 	// read [CHIP] section
 	if (Log.isSection("CHIP")) // chip on wafer
 	{
@@ -414,29 +421,33 @@ bool CChip::Read(CScanner &Log)
 	// read [PIXMAP] section if exist
 	if (Log.isSection("PIXMAP"))
 	{
+		pixmap.m_section[CChipPixMap::PIXMAP] = Log.getSectionNr();
 		Log.getNextLine();
-		if (!pixmap.ReadPixMap(Log)) ERROR_ABORT(ERROR_PIXEL)
+		if (!pmap.ReadPixMap(Log)) ERROR_ABORT(ERROR_PIXEL)
 		Log.getNextSection();
 	}
 
 	if (Log.isSection("PULSE"))
 	{
+		pixmap.m_section[CChipPixMap::PULSE] = Log.getSectionNr();
 		Log.getNextLine();
-		if (!pixmap.ReadPulseHeight(Log)) ERROR_ABORT(ERROR_PH)
+		if (!pmap.ReadPulseHeight(Log)) ERROR_ABORT(ERROR_PH)
 		Log.getNextSection();
 	}
 
 	if (Log.isSection("PH1"))
 	{
+		pixmap.m_section[CChipPixMap::PH1] = Log.getSectionNr();
 		Log.getNextLine();
-		if (!pixmap.ReadPulseHeight1(Log)) ERROR_ABORT(ERROR_PH1)
+		if (!pmap.ReadPulseHeight1(Log)) ERROR_ABORT(ERROR_PH1)
 		Log.getNextSection();
 	}
 
 	if (Log.isSection("PH2"))
 	{
+		pixmap.m_section[CChipPixMap::PH2] = Log.getSectionNr();
 		Log.getNextLine();
-		if (!pixmap.ReadPulseHeight2(Log)) ERROR_ABORT(ERROR_PH2)
+		if (!pmap.ReadPulseHeight2(Log)) ERROR_ABORT(ERROR_PH2)
 		Log.getNextSection();
 	}
 
@@ -444,34 +455,49 @@ bool CChip::Read(CScanner &Log)
 	if (Log.isSection("PUC1"))
 	{
 		// read [PUC1] section
+		pixmap.m_section[CChipPixMap::PUC1] = Log.getSectionNr();
 		Log.getNextLine();
-		if (!pixmap.ReadRefLevel(Log)) ERROR_ABORT(ERROR_PUC)
+		if (!pmap.ReadRefLevel(Log)) ERROR_ABORT(ERROR_PUC)
 		Log.getNextSection();
 
 		// read [PUC2] section
 		if (!Log.isSection("PUC2")) ERROR_ABORT(ERROR_PUC)
 		Log.getNextLine();
-		if (!pixmap.ReadLevel(Log,3)) ERROR_ABORT(ERROR_PUC)
+		if (!pmap.ReadLevel(Log,3)) ERROR_ABORT(ERROR_PUC)
 		Log.getNextSection();
 
 		// read [PUC3] section
 		if (!Log.isSection("PUC3")) ERROR_ABORT(ERROR_PUC)
 		Log.getNextLine();
-		if (!pixmap.ReadLevel(Log,2)) ERROR_ABORT(ERROR_PIXEL)
+		if (!pmap.ReadLevel(Log,2)) ERROR_ABORT(ERROR_PIXEL)
 		Log.getNextSection();
 
 		// read [PUC4] section
 		if (!Log.isSection("PUC4")) ERROR_ABORT(ERROR_PUC)
 		Log.getNextLine();
-		if (!pixmap.ReadLevel(Log,1)) ERROR_ABORT(ERROR_PUC)
+		if (!pmap.ReadLevel(Log,1)) ERROR_ABORT(ERROR_PUC)
 		Log.getNextSection();
 
 		// read [PUC5] section
 		if (!Log.isSection("PUC5")) ERROR_ABORT(ERROR_PUC)
 		Log.getNextLine();
-		if (!pixmap.ReadLevel(Log,0)) ERROR_ABORT(ERROR_PUC)
+		if (!pmap.ReadLevel(Log,0)) ERROR_ABORT(ERROR_PUC)
+		Log.getNextSection();
+		pmap.levelExist = true;
+	}
+
+	// read [TRIM] and [TRIMBITS] sections if exist
+	if (Log.isSection("TRIM"))
+	{
+		if (sscanf(Log.getNextLine(),"%i %i %i", &trimVcal, &trimVthrComp, &trimVtrim)!=3)
+			ERROR_ABORT(ERROR_TRIM)
+		Log.getNextSection();
+
+		if (!Log.isSection("TRIMBITS")) ERROR_ABORT(ERROR_TRIM)
+		pixmap.m_section[CChipPixMap::TRIMBITS] = Log.getSectionNr();
+		Log.getNextLine();
+		if (!pmap.ReadTrim(Log)) ERROR_ABORT(ERROR_TRIM)
 		Log.getNextSection();
-		pixmap.levelExist = true;
 	}
 
 	// read [CLASS] section
@@ -537,6 +563,9 @@ void CChip::SetAoutOffset(double offset)
 
 void CChip::Calculate()
 {
+	std::shared_ptr<CPixelMap> pixmapRef = pixmap.Get();
+	CPixelMap &map = *pixmapRef;
+
 	// set pic coordinates
 	if (mapX!=0 || mapY!=0)
 	{
@@ -557,55 +586,34 @@ void CChip::Calculate()
 	pmax = 0;
 
 	if (bin==13) bin = 0;
-	nPixDefect     = 0;
-	nPixNoSignal   = 0;
-	nPixNoisy      = 0;
-	nPixUnmaskable = 0;
-	nPixAddrDefect = 0;
-	nPixNoTrim     = 0;
 	nPixThrOr      = 0;
 
-	int col, row, sum = 0, sum2 = 0;
-	for (col=0; col<52; col++) for (row=0; row<80; row++)
-	{
-		if (pixmap.GetMaskedCount(col,row) > 0) nPixUnmaskable++;
-		if (pixmap.GetUnmaskedCount(col,row) == 0) nPixNoSignal++;
-		else if (pixmap.GetUnmaskedCount(col,row) > 1) nPixNoisy++;
-		if (pixmap.GetDefectAddrCode(col,row)) nPixAddrDefect++;
-		if (pixmap.GetDefectTrimBit(col,row)) nPixNoTrim++;
-		if (pixmap.IsDefect(col,row)) { nPixDefect++; continue; }
-
-		int y = pixmap.GetRefLevel(col,row);
-
-		if (y < 100)
-		{
-			n++;
-			sum  += y;
-			sum2 += y*y;
-			if (y<pmin) pmin = y;
-			if (y>pmax) pmax = y;
-		}
-	}
+	int col;
+	nPixUnmaskable = map.Count(CPixelMap::PL_UNMASKABLE);
+	nPixNoSignal   = map.Count(CPixelMap::PL_NOSIGNAL);
+	nPixNoisy      = map.Count(CPixelMap::PL_NOISY);
+	nPixAddrDefect = map.Count(CPixelMap::PL_ADDR);
+	nPixNoTrim     = map.Count(CPixelMap::PL_TRIM);
+	nPixDefect     = map.Count(CPixelMap::PL_DEFECT);
+
+	CRefLevelStats ref;
+	map.GetRefLevelStats(ref);
+	n    = ref.n;
+	pmin = ref.min;
+	pmax = ref.max;
 
 	if (n>0)
 	{
-		pm    = double(sum)/n;
-		pstd  = sqrt(double(sum2)/n - pm*pm);
+		pm    = double(ref.sum)/n;
+		pstd  = sqrt(double(ref.sum2)/n - pm*pm);
 
 		int n_col;
 		double pm_col[52];
 		for (col=0; col<52; col++)
 		{
-			n_col = 0;
+			n_col = ref.nCol[col];
 			pm_col[col] = 0.0;
-			int pcolsum = 0;
-			for (row=0; row<80; row++)
-				if (!pixmap.IsDefect(col,row))
-				{
-					n_col++;
-					pcolsum += pixmap.GetRefLevel(col,row);
-				}
-			if (n_col>0) pm_col[col] = (double)pcolsum/n_col; else break;
+			if (n_col>0) pm_col[col] = (double)ref.sumCol[col]/n_col; else break;
 		}
 		if (n_col>0)
 			for (col=1; col<52; col++)
@@ -616,12 +624,7 @@ void CChip::Calculate()
 			}
 
 #define PMAX 15
-		for (col=0; col<52; col++) for (row=0; row<80; row++)
-		{
-			int y = pixmap.GetRefLevel(col,row);
-			if (y == 100) nPixThrOr++;
-			else if (y < (pm-PMAX) || (pm+PMAX) < y) nPixThrOr++;
-		}
+		nPixThrOr = map.RefLevelOutside(int(ceil(pm-PMAX)), int(floor(pm+PMAX)));
 
 	}
 
@@ -633,40 +636,19 @@ void CChip::Calculate()
 #define PH21TOL  60
 	nPh = 0;
 	nPhFail = 0;
-	int sum1=0, sum1_2=0, sum21 = 0, sum21_2=0;
-	if (pixmap.pulseHeight1Exist && pixmap.pulseHeight2Exist)
+	if (map.pulseHeight1Exist && map.pulseHeight2Exist)
 	{
-		for (col=0; col<52; col++) for (row=0; row<80; row++)
-		{
-			int ph1 = pixmap.GetPulseHeight1(col,row);
-			int ph2 = pixmap.GetPulseHeight2(col,row);
-			if (ph1<10000 && ph2<10000)
-			{
-				nPh++;
-				sum1    += ph1;
-				sum1_2  += ph1*ph1;
-				sum21   += ph2-ph1;
-				sum21_2 += (ph2-ph1)*(ph2-ph1);
-			}
-		}
+		CPulseHeightStats ph;
+		map.GetPulseHeightStats(ph);
+		nPh = ph.n;
 		if (nPh>0)
-		ph1mean  = double(sum1)/nPh;
-		ph21mean = double(sum21)/nPh;
-		ph1std  = sqrt(double(sum1_2)/nPh  - ph1mean*ph1mean);
-		ph21std = sqrt(double(sum21_2)/nPh - ph21mean*ph21mean);
+		ph1mean  = double(ph.sum1)/nPh;
+		ph21mean = double(ph.sum21)/nPh;
+		ph1std  = sqrt(double(ph.sum1_2)/nPh  - ph1mean*ph1mean);
+		ph21std = sqrt(double(ph.sum21_2)/nPh - ph21mean*ph21mean);
 
-		for (col=0; col<52; col++) for (row=0; row<80; row++)
-		{
-			int ph1 = pixmap.GetPulseHeight1(col,row);
-			int ph2 = pixmap.GetPulseHeight2(col,row);
-			if (ph1<10000 && ph2<10000)
-			{
-				int phdiff = ph2-ph1;
-				if (ph1<(ph1mean-PH1TOL) || ph1>(ph1mean+PH1TOL) ||
-				    phdiff<(ph21mean-PH21TOL) || phdiff>(ph21mean+PH21TOL))
-					nPhFail++;
-			}
-		}
+		nPhFail = map.PulseHeightOutside(ph1mean-PH1TOL, ph1mean+PH1TOL,
+			ph21mean-PH21TOL, ph21mean+PH21TOL);
 	}
 
 	if (nPixThrOr > nPixDefect) nPixDefect = nPixThrOr;
@@ -844,6 +826,225 @@ bool CDcol::read(CScanner &Log)
 
 
 
+// === pixel maps ========================================================
+
+// a copy owns its map: it stays valid if the database is closed
+CChipPixMap::CChipPixMap(const CChipPixMap &src)
+	: m_cache(NULL), m_nr(0)
+{
+	memcpy(m_section, src.m_section, sizeof(m_section));
+	if (src.m_cache) m_map = std::make_shared<CPixelMap>(*src.m_cache->Get(src));
+	else if (src.m_map) m_map = std::make_shared<CPixelMap>(*src.m_map);
+}
+
+
+CChipPixMap& CChipPixMap::operator=(const CChipPixMap &src)
+{
+	if (this == &src) return *this;
+	std::shared_ptr<CPixelMap> map = src.m_cache ? src.m_cache->Get(src) : src.m_map;
+	m_cache = NULL;
+	m_nr = 0;
+	memcpy(m_section, src.m_section, sizeof(m_section));
+	if (!map) m_map.reset();
+	else if (m_map && m_map.use_count() == 1) *m_map = *map;
+	else m_map = std::make_shared<CPixelMap>(*map);
+	return *this;
+}
+
+
+void CChipPixMap::Init()
+{
+	m_cache = NULL;
+	for (int i=0; i<NSECTIONS; i++) m_section[i] = -1;
+	if (m_map)
+	{
+		if (m_map.use_count() == 1) m_map->Init();
+		else m_map.reset();
+	}
+}
+
+
+std::shared_ptr<CPixelMap> CChipPixMap::Get()
+{
+	if (m_cache) return m_cache->Get(*this);
+	if (!m_map) m_map = std::make_shared<CPixelMap>();
+	return m_map;
+}
+
+
+void CChipPixMap::Detach()
+{
+	if (m_cache)
+	{
+		m_map = std::make_shared<CPixelMap>(*m_cache->Get(*this));
+		m_cache = NULL;
+	}
+	else m_map = std::make_shared<CPixelMap>();
+}
+
+
+void CPixMapCache::Open(CScanner &log, unsigned int nchips)
+{
+	Close();
+	m_log = &log;
+	m_map.resize(nchips);
+	m_lruPos.resize(nchips);
+}
+
+
+void CPixMapCache::Close()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_scanner.clear();
+	m_free.clear();
+	std::vector<std::shared_ptr<CPixelMap> >().swap(m_map);
+	std::vector<std::list<unsigned int>::iterator>().swap(m_lruPos);
+	m_lru.clear();
+	m_log = NULL;
+	m_count = 0;
+	m_hits = m_loads = 0;
+}
+
+
+void CPixMapCache::SetBudget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_budget = bytes;
+	while (m_count > 0 && m_count*sizeof(CPixelMap) > m_budget)
+	{
+		m_map[m_lru.back()].reset();
+		m_lru.pop_back();
+		m_count--;
+	}
+}
+
+
+// m_mutex locked
+void CPixMapCache::Insert(unsigned int nr, const std::shared_ptr<CPixelMap> &map)
+{
+	if (m_map[nr]) m_lru.erase(m_lruPos[nr]);
+	else m_count++;
+	m_map[nr] = map;
+	m_lru.push_front(nr);
+	m_lruPos[nr] = m_lru.begin();
+	while (m_count > 1 && m_count*sizeof(CPixelMap) > m_budget)
+	{
+		m_map[m_lru.back()].reset();
+		m_lru.pop_back();
+		m_count--;
+	}
+}
+
+
+// a slot only if there is room: with a sequential scan of all chips the
+// maps put first are used first
+bool CPixMapCache::Reserve()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if ((m_count+1)*sizeof(CPixelMap) > m_budget) return false;
+	m_count++;
+	return true;
+}
+
+
+void CPixMapCache::Put(unsigned int nr, const std::shared_ptr<CPixelMap> &map)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_count--;
+	if (map && nr < m_map.size()) Insert(nr, map);
+}
+
+
+// same section order as CChip::Read
+bool CPixMapCache::Load(CScanner &Log, const CChipPixMap &chip, CPixelMap &map)
+{
+	const int *sec = chip.m_section;
+	if (sec[CChipPixMap::PIXMAP] >= 0)
+	{
+		Log.gotoSection(sec[CChipPixMap::PIXMAP]);
+		Log.getNextLine();
+		if (!map.ReadPixMap(Log)) ERROR_ABORT(ERROR_PIXEL)
+	}
+	if (sec[CChipPixMap::PULSE] >= 0)
+	{
+		Log.gotoSection(sec[CChipPixMap::PULSE]);
+		Log.getNextLine();
+		if (!map.ReadPulseHeight(Log)) ERROR_ABORT(ERROR_PH)
+	}
+	if (sec[CChipPixMap::PH1] >= 0)
+	{
+		Log.gotoSection(sec[CChipPixMap::PH1]);
+		Log.getNextLine();
+		if (!map.ReadPulseHeight1(Log)) ERROR_ABORT(ERROR_PH1)
+	}
+	if (sec[CChipPixMap::PH2] >= 0)
+	{
+		Log.gotoSection(sec[CChipPixMap::PH2]);
+		Log.getNextLine();
+		if (!map.ReadPulseHeight2(Log)) ERROR_ABORT(ERROR_PH2)
+	}
+	if (sec[CChipPixMap::PUC1] >= 0)
+	{
+		// [PUC1] .. [PUC5]
+		Log.gotoSection(sec[CChipPixMap::PUC1]);
+		Log.getNextLine();
+		if (!map.ReadRefLevel(Log)) ERROR_ABORT(ERROR_PUC)
+		for (int bit=3; bit>=0; bit--)
+		{
+			Log.gotoSection(sec[CChipPixMap::PUC1] + 4 - bit);
+			Log.getNextLine();
+			if (!map.ReadLevel(Log, bit)) ERROR_ABORT(ERROR_PUC)
+		}
+		map.levelExist = true;
+	}
+	if (sec[CChipPixMap::TRIMBITS] >= 0)
+	{
+		Log.gotoSection(sec[CChipPixMap::TRIMBITS]);
+		Log.getNextLine();
+		if (!map.ReadTrim(Log)) ERROR_ABORT(ERROR_TRIM)
+	}
+	return true;
+}
+
+
+std::shared_ptr<CPixelMap> CPixMapCache::Get(const CChipPixMap &chip)
+{
+	CScanner *s;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::shared_ptr<CPixelMap> map = m_map[chip.m_nr];
+		if (map)
+		{
+			m_hits++;
+			m_lru.splice(m_lru.begin(), m_lru, m_lruPos[chip.m_nr]);
+			return map;
+		}
+		if (m_free.empty())
+		{
+			m_scanner.push_back(std::unique_ptr<CScanner>(new CScanner));
+			m_scanner.back()->open(*m_log);
+			m_free.push_back(m_scanner.back().get());
+		}
+		s = m_free.back();
+		m_free.pop_back();
+	}
+
+	// parse without lock (a map loaded twice by two threads is no error)
+	std::shared_ptr<CPixelMap> map = std::make_shared<CPixelMap>();
+	bool ok = Load(*s, chip, *map);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_free.push_back(s);
+	m_loads++;
+	if (!ok) { map->Init(); return map; } // errnr is set, the map does not exist
+	if (m_map[chip.m_nr]) return m_map[chip.m_nr];
+	Insert(chip.m_nr, map);
+	return map;
+}
+
+
+// -----------------------------------------------------------------------
+
 CChip* CWaferDataBase::GetFirst()
 {
 	CChip *p = first;
@@ -881,6 +1082,8 @@ CChip* CWaferDataBase::GetNext(CChip *chip)
 
 bool CWaferDataBase::Add(CChip *chip)
 {
+	added.push_back(chip);
+	order.push_back(chip);
 	chip->prev = last;
 	chip->next = NULL;
 	if (last) last->next = chip;
@@ -892,98 +1095,211 @@ bool CWaferDataBase::Add(CChip *chip)
 
 void CWaferDataBase::DeleteAll()
 {
-	CChip *p = first;
-	while (p)
-	{
-		CChip *q = p;
-		p = p->next;
-		delete q;
-	}
+	pixmapCache.Close();
+	for (unsigned int i=0; i<added.size(); i++) delete added[i];
+	std::vector<CChip*>().swap(added);
+	std::vector<CChip>().swap(chips);
+	std::vector<CChip*>().swap(order);
+	posIndex.clear();
+	for (int i=0; i<5; i++) classIndex[i].clear();
+	for (int i=0; i<=CChip::FAIL_NOFAIL; i++) failIndex[i].clear();
 	first = last = NULL;
+	log.close();
 }
 
 
-void CWaferDataBase::Swap(CChip *entry)
+void CWaferDataBase::Link()
 {
-	if (entry->next == NULL) return;
-
-	CChip *p = entry->next;
-	if (entry->prev) entry->prev->next = p; else first = p;
-	if (p->next) p->next->prev = entry; else last = entry;
-	entry->next = p->next;
-	p->prev = entry->prev;
-	entry->prev = p;
-	p->next = entry;
+	unsigned int i, n = order.size();
+	for (i=0; i<n; i++)
+	{
+		order[i]->prev = i ? order[i-1] : NULL;
+		order[i]->next = (i+1 < n) ? order[i+1] : NULL;
+	}
+	first = n ? order[0] : NULL;
+	last  = n ? order[n-1] : NULL;
 }
 
 
-void CWaferDataBase::SortPicOrder()
+bool CWaferDataBase::Read(char logFileName[], unsigned int nthreads)
 {
-	if (first == last) return;
-	bool swapped;
-	do
+	struct Record
 	{
-		swapped = false;
-		CChip *p = first;
-		while (p && p->next)
+		unsigned int section; // [CHIP] or [CHIP1]
+		unsigned int begin;   // [WAFER] in front or section
+		unsigned int end;     // section after the record
+		int error;            // ERROR_OK: no wafer id error
+		char productId[40], waferId[40], waferNr[10];
+		bool ok;
+	};
+
+	DeleteAll();
+	errnr = ERROR_OK;
+	if (!log.open(logFileName)) return false;
+	CScanner &Log = log.Log;
+
+	// chip boundary scan (up to [CLOSE]), [WAFER] is valid for all following chips
+	std::vector<Record> rec;
+	Record r;
+	r.error = ERROR_OK;
+	r.productId[0] = r.waferId[0] = r.waferNr[0] = 0;
+	unsigned int start = Log.getSectionNr(), i;
+	for (i = start; i < Log.getSectionCount(); i++)
+	{
+		const char *name = Log.getSectionName(i);
+		if (strcmp(name, "CLOSE") == 0) break;
+		if (strcmp(name, "WAFER") == 0)
 		{
-			if (*p > *(p->next)) { Swap(p); swapped = true; }
-			p = p->next;
+			Log.gotoSection(i);
+			r.error = (sscanf(Log.getNextLine(), "%39s%39s%9s",
+				r.productId, r.waferId, r.waferNr) == 3) ? ERROR_OK : ERROR_WAFERID;
 		}
-	} while (swapped);
-}
-
-
-// chips must be sorted
-void CWaferDataBase::CalculateMulti()
-{
-	CChip *p, *s, *best;
-	p = first;
-	while (p)
-	{
-		best = p;
-		s = p->next;
-		while (s)
+		else if (strcmp(name, "CHIP") == 0 || strcmp(name, "CHIP1") == 0)
 		{
-			if (!(*s == *p)) break;
-			if (s->failCode > best->failCode) best = s;
-			s = s->next;
+			r.section = i;
+			r.begin = (i > start && strcmp(Log.getSectionName(i-1), "WAFER") == 0) ? i-1 : i;
+			r.end = i;
+			r.ok = false;
+			rec.push_back(r);
+			r.error = ERROR_OK;
 		}
-		while(p != s && p)
+	}
+
+	// parse and check the chips in parallel, the pixel maps into the cache
+	// as far as there is room (the others are parsed again on demand)
+	chips.resize(rec.size());
+	pixmapCache.Open(Log, rec.size());
+	ParallelFor(rec.size(), [&](unsigned int k0, unsigned int k1)
+	{
+		CScanner s;
+		if (!s.open(Log)) return;
+		std::unique_ptr<CPixelMap> scratch; // maps without room in the cache
+		for (unsigned int k = k0; k < k1; k++)
 		{
-			p->multi = (p == best) ? 0 : 2;
-			p = p->next;
+			Record &r = rec[k];
+			if (r.error != ERROR_OK) continue;
+			CChip &chip = chips[k];
+			strcpy(chip.productId, r.productId);
+			strcpy(chip.waferId, r.waferId);
+			strcpy(chip.waferNr, r.waferNr);
+			errnr = ERROR_OK;
+			s.gotoSection(r.section);
+			std::shared_ptr<CPixelMap> map;
+			CPixelMap *pmap;
+			if (pixmapCache.Reserve())
+			{
+				map = std::make_shared<CPixelMap>();
+				pmap = map.get();
+			}
+			else
+			{
+				if (scratch) scratch->Init(); else scratch.reset(new CPixelMap);
+				pmap = scratch.get();
+			}
+			r.ok = chip.Read(s, pmap);
+			r.error = errnr;
+			r.end = s.getSectionNr();
+			pixmapCache.Attach(chip.pixmap, k);
+			if (map) pixmapCache.Put(k, r.ok ? map : NULL);
 		}
+	}, nthreads);
+
+	// accept the chips in file order as far as the sequential reading would get
+	// (errnr of this thread may still hold the error of a chip behind a gap)
+	errnr = ERROR_OK;
+	unsigned int n = 0, next = start;
+	for (n = 0; n < rec.size(); n++)
+	{
+		if (rec[n].begin != next) break;
+		if (!rec[n].ok) { errnr = rec[n].error; break; }
+		next = rec[n].end;
 	}
+	chips.resize(n);
+	order.resize(n);
+	for (i = 0; i < n; i++) order[i] = &chips[i];
+	Link();
+	return !isError();
 }
 
 
-void CWaferDataBase::SetPicGroups()
+bool CWaferDataBase::ReadStore(const char dir[], bool pixmaps)
 {
-	if (first == NULL) return;
+	DeleteAll();
+	CResultStore store;
+	if (!store.Open(dir)) return false;
+	bool ok = store.GetChips(chips, pixmaps);
+	order.resize(chips.size());
+	for (unsigned int i = 0; i < chips.size(); i++) order[i] = &chips[i];
+	Link();
+	return ok;
+}
 
-	// count groups
-	int nGroups = 0;
-	int nClass;
-	for (nClass=1; nClass<=5; nClass++)
+
+void CWaferDataBase::SortPicOrder()
+{
+	std::stable_sort(order.begin(), order.end(),
+		[](CChip *a, CChip *b) { return *b > *a; });
+	Link();
+}
+
+
+// chips must be sorted
+void CWaferDataBase::CalculateMulti()
+{
+	int nClass, count[5] = { 0 };
+	unsigned int i, k, n = order.size();
+
+	posIndex.clear();
+	for (nClass=0; nClass<5; nClass++) classIndex[nClass].clear();
+	for (i=0; i<=CChip::FAIL_NOFAIL; i++) failIndex[i].clear();
+
+	for (i=0; i<n; i = k)
 	{
-		int gchip = 0;
-		CChip *p = first;
-		while (p)
+		// chips at the same position: the first with the highest fail code
+		CChip *best = order[i];
+		for (k=i+1; k<n && *order[k] == *order[i]; k++)
+			if (order[k]->failCode > best->failCode) best = order[k];
+
+		for (; i<k; i++)
 		{
-			if (p->pickClass == nClass)
+			CChip *p = order[i];
+			p->multi = (p == best) ? 0 : 2;
+			if (1 <= p->pickClass && p->pickClass <= 5)
 			{
-				p->pickGroup = nGroups+1;
-				gchip++;
-				if (gchip>=16) { nGroups++;	gchip = 0; }
+				p->pickGroup = count[p->pickClass-1]++/16; // group in class
+				if (p == best) classIndex[p->pickClass-1].push_back(p);
+			}
+			if (p == best)
+			{
+				posIndex[PosKey(p->mapX, p->mapY, p->mapPos)] = p;
+				if (0 <= p->failCode && p->failCode <= CChip::FAIL_NOFAIL)
+					failIndex[p->failCode].push_back(p);
 			}
-			p = p->next;
 		}
-		if (gchip > 0) nGroups++;
+	}
+
+	// pick groups: 16 chips of the same class (all chips), numbered by class
+	int groupOffset[5], nGroups = 1;
+	for (nClass=0; nClass<5; nClass++)
+	{
+		groupOffset[nClass] = nGroups;
+		nGroups += (count[nClass] + 15)/16;
+	}
+	for (i=0; i<n; i++)
+	{
+		CChip *p = order[i];
+		if (1 <= p->pickClass && p->pickClass <= 5) p->pickGroup += groupOffset[p->pickClass-1];
 	}
 }
 
 
+CChip* CWaferDataBase::Find(int mapX, int mapY, int mapPos)
+{
+	std::map<int, CChip*>::iterator it = posIndex.find(PosKey(mapX, mapY, mapPos));
+	return (it != posIndex.end()) ? it->second : NULL;
+}
+
+
 double CWaferDataBase::CorrectAoutOffset()
 {
 	int n = 0;
@@ -1012,14 +1328,12 @@ double CWaferDataBase::CorrectAoutOffset()
 }
 
 
-void CWaferDataBase::Calculate()
+void CWaferDataBase::Calculate(unsigned int nthreads)
 {
-	CChip *p = GetFirstM();
-	while (p)
+	ParallelFor(order.size(), [this](unsigned int i0, unsigned int i1)
 	{
-		p->Calculate();
-		p = GetNextM(p);
-	}
+		for (unsigned int i = i0; i < i1; i++) order[i]->Calculate();
+	}, nthreads);
 }
 
 
@@ -1102,17 +1416,29 @@ bool CWaferDataBase::GeneratePickFile(char filename[])
 }
 
 
-bool CWaferDataBase::WriteXML_File(char path[], CChip &chip)
+std::string PathJoin(const char dir[], const char name[])
 {
-	char filename[80];
+	std::string s(dir);
+#ifdef _WIN32
+	if (!s.empty() && s[s.size()-1] != '\\' && s[s.size()-1] != '/' && s[s.size()-1] != ':') s += '\\';
+#else
+	if (!s.empty() && s[s.size()-1] != '/') s += '/';
+#endif
+	return s + name;
+}
+
+
+bool CWaferDataBase::WriteXML_File(char path[], CChip &chip, CTextBuffer &b)
+{
+	char name[80];
+	char id[32];
 	char datetime[24];
 	if (!chip.ConvertDate(datetime)) return false;
-	sprintf(filename, "%s\\%s_%i%i%c.xml", path, chip.waferId,
-		chip.mapY, chip.mapX, "ABCD"[chip.mapPos]);
-	FILE *f = fopen(filename,"wt");
-	if (f==NULL) return false;
+	sprintf(id, "%i%i%c", chip.mapY, chip.mapX, "ABCD"[chip.mapPos]);
+	sprintf(name, "%s_%s.xml", chip.waferId, id);
 
-	fputs(
+	b.Clear();
+	b.Put(
 		"<?xml version='1.0' encoding='UTF-8'?>\n"
 		"<!DOCTYPE root []>\n"
 		" <ROOT>\n"
@@ -1121,34 +1447,32 @@ bool CWaferDataBase::WriteXML_File(char path[], CChip &chip)
 		"   <EXTENSION_TABLE_NAME>BRL_ROC_ON_WAFER_TEST</EXTENSION_TABLE_NAME>\n"
 		"   <NAME>BRL ROC On-Wafer Test</NAME>\n"
 		"  </TYPE>\n"
-		"  <RUN>\n", f);
-	fprintf(f,
-		"   <RUN_NAME>PSI46V2 %s</RUN_NAME>\n"
-		"   <RUN_BEGIN_TIMESTAMP>%s</RUN_BEGIN_TIMESTAMP>\n",
-		chip.waferId, datetime);
-	fputs(
+		"  <RUN>\n");
+	b.Put("   <RUN_NAME>PSI46V2 ").Put(chip.waferId).Put("</RUN_NAME>\n");
+	b.Put("   <RUN_BEGIN_TIMESTAMP>").Put(datetime).Put("</RUN_BEGIN_TIMESTAMP>\n");
+	b.Put(
 		"   <COMMENT_DESCRIPTION>ROC On-Wafer Test</COMMENT_DESCRIPTION>\n"
 		"   <INITIATED_BY_USER>Beat Meier</INITIATED_BY_USER>\n"
 		"  </RUN>\n"
 		" </HEADER>\n"
-		" <DATA_SET>\n", f);
-	fprintf(f,
-		"  <COMMENT_DESCRIPTION>Test results from PSI for %s</COMMENT_DESCRIPTION>\n"
-		"  <DATA_FILE_NAME>%s.txt</DATA_FILE_NAME>\n"
+		" <DATA_SET>\n");
+	b.Put("  <COMMENT_DESCRIPTION>Test results from PSI for ").Put(chip.waferId).Put("</COMMENT_DESCRIPTION>\n");
+	b.Put("  <DATA_FILE_NAME>").Put(chip.waferId).Put(".txt</DATA_FILE_NAME>\n");
+	b.Put(
 		"  <PART_ASSEMBLY>\n"
 		"   <PARENT_PART>\n"
-		"    <NAME_LABEL>%s</NAME_LABEL>\n"
+		"    <NAME_LABEL>").Put(chip.waferId).Put("</NAME_LABEL>\n");
+	b.Put(
 		"  </PARENT_PART>\n"
 		"   <CHILD_UNIQUELY_IDENTIFIED_BY>\n"
 		"     <ATTRIBUTE>\n"
 		"      <NAME>BRL ROC Number</NAME>\n"
-		"      <VALUE>%i%i%c</VALUE>\n"
+		"      <VALUE>").Put(id).Put("</VALUE>\n");
+	b.Put(
 		"     </ATTRIBUTE>\n"
 		"    </CHILD_UNIQUELY_IDENTIFIED_BY>\n"
-		"  </PART_ASSEMBLY>\n", chip.waferId, chip.waferId, chip.waferId,
-			chip.mapY, chip.mapX, "ABCD"[chip.mapPos]);
-	fputs(
-		"  <DATA>\n",f);
+		"  </PART_ASSEMBLY>\n"
+		"  <DATA>\n");
 
 	// limit values for data base
 	if (chip.chipClass < 0) chip.chipClass = 0;
@@ -1185,39 +1509,44 @@ bool CWaferDataBase::WriteXML_File(char path[], CChip &chip)
 
 	if (chip.bin<0) chip.bin = 0; else if (chip.bin>99) chip.bin=99;
 
-	// begin of data set
-	fprintf(f,"   <CHIPCLASS>%u</CHIPCLASS>\n",             chip.chipClass);
-	fprintf(f,"   <CURRENT_DIG>%0.1f</CURRENT_DIG>\n",      chip.IdigInit>=0 ? chip.IdigInit : 0.0);
-	fprintf(f,"   <CURRENT_ANA>%0.1f</CURRENT_ANA>\n",      chip.IanaInit>=0 ? chip.IanaInit : 0.0);
-	fprintf(f,"   <VOLTAGE_ANA>%u</VOLTAGE_ANA>\n",         chip.InitVana>=0 ? chip.InitVana : 0);
-	fprintf(f,"   <AOUT_OFFSET>%0.2f</AOUT_OFFSET>\n",      chip.black.exist ? double(chip.black.mean/8) : 0.0);
-	fprintf(f,"   <PIXEL_DEFECT>%u</PIXEL_DEFECT>\n",       chip.nPixDefect);
-	fprintf(f,"   <NO_SIGNAL>%i</NO_SIGNAL>\n",             chip.nPixNoSignal);
-	fprintf(f,"   <MASK_DEFECT>%i</MASK_DEFECT>\n",         chip.nPixUnmaskable);
-	fprintf(f,"   <NOISY>%i</NOISY>\n",                     chip.nPixNoisy);
-	fprintf(f,"   <TRIM_BIT_DEFECT>%i</TRIM_BIT_DEFECT>\n", chip.nPixNoTrim);
-	fprintf(f,"   <ADDRESS_DEFECT>%u</ADDRESS_DEFECT>\n",   chip.nPixAddrDefect);
-	fprintf(f,"   <FLAG>%u</FLAG>\n",                       chip.bin);
+	// begin of data set (all values >= 0)
+	b.Put("   <CHIPCLASS>").PutInt(chip.chipClass).Put("</CHIPCLASS>\n");
+	b.Put("   <CURRENT_DIG>").PutFixed(chip.IdigInit>=0 ? chip.IdigInit : 0.0, 1).Put("</CURRENT_DIG>\n");
+	b.Put("   <CURRENT_ANA>").PutFixed(chip.IanaInit>=0 ? chip.IanaInit : 0.0, 1).Put("</CURRENT_ANA>\n");
+	b.Put("   <VOLTAGE_ANA>").PutInt(chip.InitVana>=0 ? chip.InitVana : 0).Put("</VOLTAGE_ANA>\n");
+	b.Put("   <AOUT_OFFSET>").PutFixed(chip.black.exist ? double(chip.black.mean/8) : 0.0, 2).Put("</AOUT_OFFSET>\n");
+	b.Put("   <PIXEL_DEFECT>").PutInt(chip.nPixDefect).Put("</PIXEL_DEFECT>\n");
+	b.Put("   <NO_SIGNAL>").PutInt(chip.nPixNoSignal).Put("</NO_SIGNAL>\n");
+	b.Put("   <MASK_DEFECT>").PutInt(chip.nPixUnmaskable).Put("</MASK_DEFECT>\n");
+	b.Put("   <NOISY>").PutInt(chip.nPixNoisy).Put("</NOISY>\n");
+	b.Put("   <TRIM_BIT_DEFECT>").PutInt(chip.nPixNoTrim).Put("</TRIM_BIT_DEFECT>\n");
+	b.Put("   <ADDRESS_DEFECT>").PutInt(chip.nPixAddrDefect).Put("</ADDRESS_DEFECT>\n");
+	b.Put("   <FLAG>").PutInt(chip.bin).Put("</FLAG>\n");
 	// end of data set
 
-	fputs(
+	b.Put(
 		"  </DATA>\n"
 		" </DATA_SET>\n"
-		"</ROOT>\n", f);
+		"</ROOT>\n");
 
-	fclose(f);
-	return true;
+	return b.Write(PathJoin(path, name).c_str());
 }
 
 
-bool CWaferDataBase::GenerateXML(char path[])
+bool CWaferDataBase::GenerateXML(char path[], unsigned int nthreads)
 {
-	CChip *p = GetFirst();
-	while (p)
+	std::vector<CChip*> list;
+	for (CChip *p = GetFirst(); p; p = GetNext(p)) list.push_back(p);
+
+	// one text buffer per thread, one file per chip
+	std::vector<char> ok(list.size(), 0);
+	ParallelFor(list.size(), [&](unsigned int i0, unsigned int i1)
 	{
-		if (!WriteXML_File(path, *p)) return false;
-		p = GetNext(p);
-	}
+		CTextBuffer buffer;
+		for (unsigned int i = i0; i < i1; i++) ok[i] = WriteXML_File(path, *list[i], buffer);
+	}, nthreads);
+
+	for (unsigned int i = 0; i < ok.size(); i++) if (!ok[i]) return false;
 	return true;
 }
 
@@ -4,11 +4,22 @@
 #define CHIPDATABASE_H
 
 #include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
 #include "config.h"
 #include "error.h"
 #include "pixelmap.h"
 
 
+class CTextBuffer;
+
+// dir/name with the separator of the system ('/' or '\' on Windows)
+std::string PathJoin(const char dir[], const char name[]);
+
 
 // --- parser ------------------------------------------------------------
 
@@ -67,6 +78,40 @@ struct CProbeCardData
 
 struct CLogFile;
 class CWaferDataBase;
+class CPixMapCache;
+
+
+// Pixel map of a chip: owned by the chip (test, Add, result store) or
+// in the log file of a wafer database (CWaferDataBase::Read). A map of
+// the log is parsed on demand from the recorded sections and kept in
+// the pixel map cache of the database.
+//   Get           read access (a map of the log stays in the cache)
+//   ->, *         write access: a map of the log is copied to the chip
+// Copies of a chip own a copy of the map (also of a map of the log).
+
+class CChipPixMap
+{
+public:
+	enum { PIXMAP, PULSE, PH1, PH2, PUC1, TRIMBITS, NSECTIONS };
+private:
+	std::shared_ptr<CPixelMap> m_map; // owned map
+	CPixMapCache *m_cache; // != NULL: map in the log file
+	unsigned int m_nr;     // chip number in the cache
+	int m_section[NSECTIONS]; // section numbers in the log (-1 = not existing)
+	void Detach();
+	friend class CChip;
+	friend class CPixMapCache;
+public:
+	CChipPixMap() : m_cache(NULL), m_nr(0) { for (int i=0; i<NSECTIONS; i++) m_section[i] = -1; }
+	CChipPixMap(const CChipPixMap &src);
+	CChipPixMap& operator=(const CChipPixMap &src);
+	void Init();
+	bool InLog() { return m_cache != NULL; }
+
+	std::shared_ptr<CPixelMap> Get();
+	CPixelMap& operator*() { if (!m_map || m_cache) Detach(); return *m_map; }
+	CPixelMap* operator->() { return &**this; }
+};
 
 
 class CChip
@@ -139,10 +184,12 @@ public:
 	int i2c; // <0=not existing, 0=error, 1=ok
 	int bin;
 	int pixtest2; // 256*nFailed * nPassed
-	//	[PIXMAP][PUCn]
-	CPixelMap pixmap;
+	//	[PIXMAP][PULSE][PH1][PH2][PUCn][TRIMBITS]
+	CChipPixMap pixmap;
 //	[DCOL]
 	CDcol dcol;
+//	[TRIM][TRIMBITS]
+	int trimVcal, trimVthrComp, trimVtrim; // trim target and DACs (<0 = not existing)
 //  [CLASS]
 	int logChipClass; // <0=not existing
 
@@ -187,7 +234,7 @@ public:
 	void Invalidate();
 	void Save(FILE *f);
 protected:
-	bool Read(CScanner &Log);
+	bool Read(CScanner &Log, CPixelMap *map = NULL); // map: pixel maps (NULL: own map)
 private:
 	void getCurrent(CScanner &Log, double *Idig,double *Iana);
 	void PrintFailString(FILE *f);
@@ -197,18 +244,104 @@ private:
 };
 
 
+// Cache of the pixel maps in the log file of a database. The least
+// recently used maps are dropped if the maps need more memory than the
+// budget. A map in use (Get) stays valid until it is released. A map
+// that cannot be parsed is returned empty (no ...Exist flag set, errnr
+// set) and not cached.
+
+class CPixMapCache
+{
+	CScanner *m_log; // log file with section index
+	std::vector<std::unique_ptr<CScanner> > m_scanner;
+	std::vector<CScanner*> m_free; // scanners not in use
+	std::vector<std::shared_ptr<CPixelMap> > m_map; // chip number -> map
+	std::list<unsigned int> m_lru; // cached chips, most recent first
+	std::vector<std::list<unsigned int>::iterator> m_lruPos;
+	size_t m_budget; // bytes
+	unsigned int m_count;
+	unsigned long m_hits, m_loads;
+	std::mutex m_mutex;
+
+	void Insert(unsigned int nr, const std::shared_ptr<CPixelMap> &map);
+	bool Load(CScanner &Log, const CChipPixMap &chip, CPixelMap &map);
+public:
+	CPixMapCache() : m_log(NULL), m_budget(size_t(256) << 20), m_count(0), m_hits(0), m_loads(0) {}
+	void Open(CScanner &log, unsigned int nchips);
+	void Close();
+	void Attach(CChipPixMap &chip, unsigned int nr) { chip.m_cache = this; chip.m_nr = nr; }
+	bool Reserve(); // a slot for Put if there is room
+	void Put(unsigned int nr, const std::shared_ptr<CPixelMap> &map); // into the reserved slot (NULL: release it)
+	std::shared_ptr<CPixelMap> Get(const CChipPixMap &chip);
+
+	void SetBudget(size_t bytes);
+	size_t Budget() { return m_budget; }
+	unsigned int Count() { return m_count; }
+	unsigned long Hits() { return m_hits; }
+	unsigned long Loads() { return m_loads; }
+};
+
+
+struct CLogFile
+{
+	CScanner Log;
+	char logTime[28];
+	char logVersion[44];
+	char productId[40];
+	char waferId[40];
+	char waferNr[10];
+
+	void Init();
+	bool readHeader();
+public:
+	CLogFile() { Init(); logTime[0]=logVersion[0]=0; }
+	bool open(char logFilename[]);
+	bool rewind();
+	void close() { Log.close(); }
+	bool readChip(CChip &chip);
+	bool checkFileEnd();
+};
+
+
+// Read loads a log file: a scan of the section index finds the chip
+// records, the chips are parsed in parallel into contiguous storage.
+// Like the sequential reading (CLogFile::readChip) it stops at the
+// first defective chip record (errnr is set) and links the chips in
+// file order. The pixel maps stay in the log file (pixmapCache).
+// The list order is kept in a vector of chip handles (prev/next are
+// relinked from it). CalculateMulti builds the indexes of the chips
+// with multi <= 1 (position, pick class, fail code) in list order.
+// ReadStore loads the chips of a result store: without pixel maps the
+// stored evaluation is used (no Calculate), with pixel maps the chips
+// can be evaluated like those of a log file.
+
 class CWaferDataBase
 {
+	CLogFile log;               // log file of Read
+	std::vector<CChip> chips;   // chips of Read
+	std::vector<CChip*> added;  // chips of Add
+	std::vector<CChip*> order;  // all chips in list order
 	CChip *first;
 	CChip *last;
-	void Swap(CChip *entry);
-	bool WriteXML_File(char path[], CChip &chip);
+
+	std::map<int, CChip*> posIndex;
+	std::vector<CChip*> classIndex[5];
+	std::vector<CChip*> failIndex[CChip::FAIL_NOFAIL+1];
+	static int PosKey(int mapX, int mapY, int mapPos) { return (mapY*1024 + mapX)*4 + mapPos; }
+
+	void Link();
+	bool WriteXML_File(char path[], CChip &chip, CTextBuffer &buffer);
 public:
 	double aoutOffset;
+	CPixMapCache pixmapCache;
 
 	CWaferDataBase() { first = last = NULL; aoutOffset = 0; }
 	~CWaferDataBase() { DeleteAll(); }
 
+	bool Read(char logFileName[], unsigned int nthreads = 0);
+	bool ReadStore(const char dir[], bool pixmaps = false); // see resultstore.h
+	unsigned int Count() { return chips.size() + added.size(); }
+
 	CChip* GetFirstM() { return first; }
 	static CChip* GetPrevM(CChip *chip) { return chip ? chip->prev : NULL; }
 	static CChip* GetNextM(CChip *chip) { return chip ? chip->next : NULL; }
@@ -217,17 +350,22 @@ public:
 	static CChip* GetPrev(CChip *chip);
 	static CChip* GetNext(CChip *chip);
 
+	// indexes (after CalculateMulti)
+	CChip* Find(int mapX, int mapY, int mapPos);
+	const std::vector<CChip*>& GetClass(int pickClass) { return classIndex[pickClass-1]; } // 1..5
+	const std::vector<CChip*>& GetFail(int failCode) { return failIndex[failCode]; }
+
 	bool Add(CChip *chip);
 	void DeleteAll();
 
 	double CorrectAoutOffset();
-	void Calculate();
-	void SortPicOrder();
-	void CalculateMulti();
-	void SetPicGroups();
+	void Calculate(unsigned int nthreads = 0);
+	void SortPicOrder();   // stable
+	void CalculateMulti(); // chips must be sorted, also sets the pick groups
+	void SetPicGroups() { CalculateMulti(); }
 
 	bool GeneratePickFile(char filename[]);
-	bool GenerateXML(char path[]);
+	bool GenerateXML(char path[], unsigned int nthreads = 0);
 	bool GenerateErrorReport(char filename[]);
 	bool GenerateDataTable(char filename[]);
 	bool GenerateStatistics(const char filename[]);
@@ -235,25 +373,4 @@ public:
 };
 
 
-struct CLogFile
-{
-	CScanner Log;
-	char logTime[28];
-	char logVersion[44];
-	char productId[40];
-	char waferId[40];
-	char waferNr[10];
-
-	void Init();
-	bool readHeader();
-public:
-	CLogFile() { Init(); logTime[0]=logVersion[0]=0; }
-	bool open(char logFilename[]);
-	bool rewind();
-	void close() { Log.close(); }
-	bool readChip(CChip &chip);
-	bool checkFileEnd();
-};
-
-
 #endif
@@ -14,6 +14,7 @@
 
 
 #include <math.h>
+#include <string.h>
 #include <time.h>
 #include <fstream>
 #include <utility>
@@ -24,6 +25,17 @@
 #include "command.h"
 #include "defectlist.h"
 #include "rpc.h"
+#include "trace.h"
+#include "rpc_session.h"
+#include "dtbsim.h"
+#include "scurve.h"
+#include "shmoo.h"
+#include "phcal.h"
+#include "testflow.h"
+#include "module.h"
+#include "resultstore.h"
+#include "waferstat.h"
+#include "waferimage.h"
 
 
 using namespace std;
@@ -168,6 +180,14 @@ CMD_PROC(log)
 	return true;
 }
 
+CMD_PROC(logasync)
+{
+	int on;
+	if (PAR_IS_INT(on, 0, 1)) Log.setAsync(on != 0);
+	printf("log file writing %s\n", Log.isAsync() ? "asynchronous" : "synchronous");
+	return true;
+}
+
 bool UpdateDTB(const char *filename)
 {
 	fstream src;
@@ -275,6 +295,195 @@ CMD_PROC(rpcinfo)
 	return true;
 }
 
+// RPC message throughput through a memory loopback (no DTB needed)
+void RpcReplyCallId(CRpcIoLoopback &io, int32_t id)
+{ // answer to GetRpcCallId (call id 1)
+	uint8_t reply[8] = { RPC_TYPE_DTB, 1, 0, 4 };
+	rpc_Put_INT32(reply+4, id);
+	io.Reply(reply, 8);
+}
+
+
+CMD_PROC(rpcbench)
+{
+	int n;
+	if (!PAR_IS_INT(n, 1000, 100000000)) n = 1000000;
+
+	// message round trip: serialize, send, receive, check, deserialize
+	CRpcIoLoopback echo(true);
+	rpcMessage msg;
+	unsigned int sum = 0;
+	clock_t t = clock();
+	for (int i=0; i<n; i++)
+	{
+		uint8_t *p = msg.Create(17, 3);
+		rpc_Put_UINT8(p, uint8_t(i));
+		rpc_Put_UINT16(p+1, uint16_t(i));
+		msg.Send(echo);
+		msg.Receive(echo);
+		msg.Check(17, 3);
+		p = msg.GetPar();
+		sum += rpc_Get_UINT8(p) + rpc_Get_UINT16(p+1);
+	}
+	double dt = double(clock() - t)/CLOCKS_PER_SEC;
+	printf("message round trip: %9.0f msg/s (%i messages, %0.3f s, check %u)\n",
+		dt > 0.0 ? n/dt : 0.0, n, dt, sum);
+
+	// generated stubs roc_SetDAC and roc_Pix_Trim into the loopback
+	CRpcIoLoopback sink;
+	CTestboard bench;
+	bench.SetIo(sink);
+	RpcReplyCallId(sink, 20);
+	bench.roc_SetDAC(0, 0);
+	RpcReplyCallId(sink, 21);
+	bench.roc_Pix_Trim(0, 0, 0);
+	t = clock();
+	for (int i=0; i<n; i += 2)
+	{
+		bench.roc_SetDAC(uint8_t(i), uint8_t(i>>8));
+		bench.roc_Pix_Trim(uint8_t(i%52), uint8_t(i%80), uint8_t(i&15));
+		if (sink.TxSize() >= 1024) sink.Flush();
+	}
+	dt = double(clock() - t)/CLOCKS_PER_SEC;
+	printf("roc_SetDAC/roc_Pix_Trim: %9.0f msg/s (%i messages, %0.3f s)\n",
+		dt > 0.0 ? n/dt : 0.0, n, dt);
+	return true;
+}
+
+
+CMD_PROC(trace)
+{
+#ifdef ENABLE_TRACING
+	char filename[256];
+	if (PAR_IS_STRING(filename, 255))
+	{
+		CTrace::Stop();
+		if (CTrace::Start(filename)) printf("trace recording started (%s)\n", filename);
+		else printf("ERROR: could not create \"%s\"\n", filename);
+	}
+	else if (CTrace::Stop()) printf("trace written\n");
+	else printf("no trace recording active\n");
+#else
+	printf("tracing not available (define ENABLE_TRACING in config.h)\n");
+#endif
+	return true;
+}
+
+
+// record the RPC traffic of a real run / replay it without DTB
+CRpcIoRecorder rpcRecorder;
+CRpcIoReplay rpcReplay;
+
+CMD_PROC(record)
+{
+	char filename[256];
+	if (PAR_IS_STRING(filename, 255))
+	{
+		if (rpcRecorder.IsRecording()) { printf("recording already active\n"); return true; }
+		if (!rpcRecorder.Start(filename, tb.GetIo()))
+		{
+			printf("ERROR: could not create \"%s\"\n", filename);
+			return true;
+		}
+		tb.SetIo(rpcRecorder);
+		printf("RPC recording started (%s)\n", filename);
+		return true;
+	}
+
+	if (!rpcRecorder.IsRecording()) { printf("no recording active\n"); return true; }
+	tb.SetIo(*rpcRecorder.Stop());
+	printf("RPC recording stopped: %llu bytes sent, %llu bytes received\n",
+		rpcRecorder.BytesWritten(), rpcRecorder.BytesRead());
+	return true;
+}
+
+
+CMD_PROC(replay)
+{
+	static CRpcIo *io = 0; // connection before replay
+	char filename[256];
+	if (PAR_IS_STRING(filename, 255))
+	{
+		if (io) { printf("replay already active\n"); return true; }
+		if (!rpcReplay.Load(filename))
+		{
+			printf("ERROR: could not read session \"%s\"\n", filename);
+			return true;
+		}
+		io = &tb.GetIo();
+		tb.SetIo(rpcReplay);
+		CPhaseTimer::Start();
+		printf("RPC replay of %s active\n", filename);
+		return true;
+	}
+
+	if (!io) { printf("no replay active\n"); return true; }
+	CPhaseTimer::Stop();
+	tb.SetIo(*io);
+	io = 0;
+	printf("--- RPC replay ------------------------------------\n");
+	rpcReplay.Report();
+	CPhaseTimer::Report();
+	printf("---------------------------------------------------\n");
+	return true;
+}
+
+
+// offline DTB with simulated ROC
+CDtbSim dtbSim;
+
+CMD_PROC(sim)
+{
+	static CRpcIo *io = 0; // connection before simulation
+	int seed, nroc;
+	if (PAR_IS_INT(seed, 0, 0x7fffffff))
+	{
+		if (!PAR_IS_INT(nroc, 1, 16)) nroc = 1;
+		dtbSim.Reset(seed, nroc);
+		if (!io) io = &tb.GetIo();
+		tb.SetIo(dtbSim);
+		if (nroc > 1) printf("DTB simulation active (seed %i, %i ROCs)\n", seed, nroc);
+		else printf("DTB simulation active (seed %i)\n", seed);
+		return true;
+	}
+
+	if (!io) { printf("no simulation active\n"); return true; }
+	tb.SetIo(*io);
+	io = 0;
+	printf("DTB simulation stopped (%lu Pg_Single)\n", dtbSim.PgSingleCount());
+	return true;
+}
+
+
+CMD_PROC(shadow)
+{
+	CRocShadow &shadow = tb.Shadow();
+	char s[8];
+	if (PAR_IS_STRING(s, 6))
+	{
+		if      (strcmp(s, "on")    == 0) shadow.Enable(true);
+		else if (strcmp(s, "off")   == 0) shadow.Enable(false);
+		else if (strcmp(s, "clear") == 0) shadow.ResetCounters();
+		else { printf("on, off or clear expected\n"); return true; }
+	}
+
+	printf("ROC register shadow %s\n", shadow.IsEnabled() ? "on" : "off");
+	printf(" call                calls    skipped\n");
+	unsigned long calls = 0, skipped = 0;
+	for (int i=0; i<CRocShadow::NCALLS; i++)
+	{
+		CRocShadow::Call call = CRocShadow::Call(i);
+		printf(" %-15s %9lu  %9lu\n", CRocShadow::Name(call),
+			shadow.Calls(call), shadow.Skipped(call));
+		calls += shadow.Calls(call);
+		skipped += shadow.Skipped(call);
+	}
+	printf(" %-15s %9lu  %9lu (%0.1f%%)\n", "total", calls, skipped,
+		calls ? 100.0*skipped/calls : 0.0);
+	return true;
+}
+
+
 CMD_PROC(info)
 {
 	string s;
@@ -1931,8 +2140,108 @@ CMD_PROC(shmoo)
 }
 
 
+class CShmooDtb : public CShmoo
+{
+	int m_vx, m_vy;
+	bool Measure(const vector<Point> &p, vector<int> &count)
+	{
+		unsigned int i, k;
+		int y = -1;
+
+		// --- take data
+		tb.Daq_Start();
+		for (i=0; i<p.size(); i++)
+		{
+			if (p[i].y != y) { y = p[i].y; tb.roc_SetDAC(m_vy, y); }
+			tb.roc_SetDAC(m_vx, p[i].x);
+			tb.uDelay(100);
+			for (k=0; k<Triggers(); k++)
+			{
+				tb.Pg_Single();
+				tb.uDelay(5);
+			}
+		}
+		tb.Daq_Stop();
+		vector<uint16_t> data;
+		tb.Daq_Read(data, 30000);
+
+		// --- analyze data
+		int pos = 0;
+		PixelReadoutData pix;
+		count.assign(p.size(), 0);
+		try
+		{
+			for (i=0; i<p.size(); i++) for (k=0; k<Triggers(); k++)
+			{
+				DecodePixel(data, pos, pix);
+				if (pix.n > 0) count[i]++;
+			}
+		} catch (int) { return false; }
+		return true;
+	}
+public:
+	CShmooDtb(int vx, int vy) : m_vx(vx), m_vy(vy) {}
+};
+
+
+CMD_PROC(ashmoo)
+{
+	int vx, xmin, xmax, vy, ymin, ymax, step;
+	char filename[256];
+	PAR_INT(vx, 0, 0xff);
+	PAR_RANGE(xmin,xmax, 0,255);
+	PAR_INT(vy, 0, 0xff);
+	PAR_RANGE(ymin,ymax, 0,255);
+	if (!PAR_IS_INT(step, 1, 128)) step = 8;
+	if (!PAR_IS_STRING(filename, 255)) filename[0] = 0;
+
+	int count = xmax-xmin;
+	if (count < 1 || count > 256) return true;
+
+	tb.Daq_Open(50000);
+	tb.Daq_Select_Deser160(deserAdjust);
+
+	CShmooDtb shmoo(vx, vy);
+	double t = CPhaseTimer::WallTime();
+	bool ok = shmoo.Scan(xmin, xmax, ymin, ymax, 10, step);
+	t = CPhaseTimer::WallTime() - t;
+	tb.Daq_Close();
+	if (!ok) { printf("readout error\n"); return true; }
+
+	Log.section("SHMOO",false);
+	Log.printf("regX(%i)=%i:%i;  regY(%i)=%i:%i\n",
+		vx, xmin, xmax, vy, ymin, ymax);
+	PrintScale(xmin, xmax);
+	string s;
+	for (int y=ymin; y<=ymax; y++)
+	{
+		s.clear();
+		for (int x=xmin; x<=xmax; x++)
+		{
+			int n = shmoo.Get(x, y);
+			if (n <= 0) s += '.';
+			else if (n >= 10) s += '*';
+			else s += char(n + '0');
+		}
+		Log.printf("%5i|%s\n", y, s.c_str());
+	}
+	Log.flush();
+
+	if (filename[0] && !shmoo.Save(filename, vx, vy))
+		printf("ERROR: could not write \"%s\"\n", filename);
+
+	unsigned int points = (xmax-xmin+1)*(ymax-ymin+1);
+	printf("%lu of %u points measured (%0.1f%%), %0.2f s\n",
+		shmoo.Points(), points, 100.0*shmoo.Points()/points, t);
+	return true;
+}
+
+
 
 
+// PH calibration of the current chip (commands phcal, phcalload)
+CPhCalibration phCal;
+
 CMD_PROC(phscan)
 {
 	int col, row;
@@ -2008,6 +2317,20 @@ CMD_PROC(phscan)
 		return true;
 	}
 
+	if (phCal.IsCalibrated(col, row))
+	{ // PH converted back to Vcal with the lookup table of the calibration
+		double sr = 0.0;
+		int nr = 0;
+		for (int cal = vcalmin; cal < vcalmax; cal++)
+		{
+			double ph = y[cal-vcalmin];
+			if (ph <= 0.0 || ph >= 255.0) continue;
+			sr += fabs(double(phCal.ToVcal(col, row, int(ph + 0.5))) - cal);
+			nr++;
+		}
+		if (nr) printf("PH calibration: Vcal residual %0.2f (%i points)\n", sr/nr, nr);
+	}
+
 	PlotData("ADC scan", "Vcal", "ADC value", double(vcalmin), double(vcalmax), y);
 
 	return true;
@@ -2281,6 +2604,36 @@ CMD_PROC(contact)
 }
 
 
+// result store of the tested chips (command store)
+CResultStore resultStore;
+
+void StoreResult()
+{
+	if (!resultStore.IsWritable()) return;
+	static CChip chip;
+	chip = g_chipdata;
+	chip.Calculate();
+	if (!resultStore.Append(chip)) printf(" result store write error, store closed\n");
+}
+
+
+// running statistics of the current wafer (command wstat)
+CWaferStatistics waferStat;
+
+
+// end of a chip test, for all test paths (test, go)
+void EndOfChip(int bin)
+{
+	GetTimeStamp(g_chipdata.endTime);
+	Log.timestamp("END");
+	Log.puts("\n");
+	if (!Log.sync()) printf(" log file write error: %s\n", strerror(Log.error()));
+	printf("%3i\n", bin);
+	StoreResult();
+	waferStat.Add(g_chipdata, bin);
+}
+
+
 bool test_wafer()
 {
 	int x, y;
@@ -2298,11 +2651,7 @@ bool test_wafer()
 	int bin = test_roc_dig(repeat);
 	tb.SetLed(0x00);
 	tb.Flush();
-	GetTimeStamp(g_chipdata.endTime);
-	Log.timestamp("END");
-	Log.puts("\n");
-	Log.flush();
-	printf("%3i\n", bin);
+	EndOfChip(bin);
 
 	printf(" RSP %s\n", prober.printf("BinMapDie %i", bin));
 
@@ -2331,12 +2680,7 @@ bool test_chip(char chipid[])
 	tb.SetLed(0x00);
 	tb.Flush();
 
-	GetTimeStamp(g_chipdata.endTime);
-	Log.timestamp("END");
-	Log.puts("\n");
-	Log.flush();
-
-	printf("%3i\n", bin);
+	EndOfChip(bin);
 
 	return true;
 }
@@ -2363,6 +2707,511 @@ CMD_PROC(test)
 }
 
 
+CMD_PROC(search)
+{
+	char test[8], mode[10];
+	if (!PAR_IS_STRING(test, 6)) { PrintThresholdSearch(); return true; }
+	PAR_STRING(mode, 8);
+	if (!SetThresholdSearch(test, mode))
+		printf("usage: search puc linear|binary|bracket|parallel\n"
+		       "       search pucc linear|binary|bracket|parallel|dtb\n");
+	return true;
+}
+
+
+CMD_PROC(vote)
+{
+	int batch;
+	char s[16];
+	if (!PAR_IS_INT(batch, 0, 20)) { PrintThresholdSearch(); return true; }
+	double alpha = PAR_IS_STRING(s, 15) ? atof(s) : 0.01;
+	SetTriggerVote(batch, alpha);
+	return true;
+}
+
+
+CMD_PROC(scurve)
+{
+	char s[8];
+	int xmin, xmax, ntrig;
+	unsigned char dac = Vcal;
+	if (PAR_IS_STRING(s, 6))
+	{
+		if (strcmp(s, "vthr") == 0) dac = VthrComp;
+		else if (strcmp(s, "vcal") != 0) { printf("vcal or vthr expected\n"); return true; }
+	}
+	if (!PAR_IS_INT(xmin, 0, 255)) xmin = (dac == Vcal) ? 20 : 10;
+	if (!PAR_IS_INT(xmax, xmin, 255)) xmax = (dac == Vcal) ? 99 : 69;
+	if (!PAR_IS_INT(ntrig, 1, 100)) ntrig = 10;
+
+	static CSCurves sc;
+	double t = CPhaseTimer::WallTime();
+	if (!GetSCurves(dac, xmin, xmax, ntrig, sc)) { printf("readout error\n"); return true; }
+	double tScan = CPhaseTimer::WallTime() - t;
+	t = CPhaseTimer::WallTime();
+	SetSCurveMaps(sc);
+	double tFit = CPhaseTimer::WallTime() - t;
+
+	Log.section("SCURVE", false);
+	Log.printf(" %s %i %i %i\n", (dac == Vcal) ? "vcal" : "vthr", xmin, xmax, ntrig);
+	g_chipdata.pixmap->PrintThreshold(Log);
+	g_chipdata.pixmap->PrintNoise(Log);
+	Log.flush();
+
+	int n = 0;
+	double st = 0.0, st2 = 0.0, sn = 0.0, sn2 = 0.0;
+	for (int col=0; col<ROC_NUMCOLS; col++) for (int row=0; row<ROC_NUMROWS; row++)
+	{
+		double thr = g_chipdata.pixmap->GetThreshold(col, row);
+		double noise = g_chipdata.pixmap->GetNoise(col, row);
+		if (thr < 0.0) continue;
+		n++; st += thr; st2 += thr*thr; sn += noise; sn2 += noise*noise;
+	}
+	if (n)
+	{
+		st /= n; sn /= n;
+		printf("threshold %0.2f (rms %0.2f), noise %0.2f (rms %0.2f), %i pixel\n",
+			st, sqrt(st2/n - st*st), sn, sqrt(sn2/n - sn*sn), n);
+	}
+	printf("scan %0.2f s, fit %0.3f ms\n", tScan, tFit*1000.0);
+	return true;
+}
+
+
+// chip id of the calibration file: single chip id or wafer position
+void GetChipKey(char *key, int size)
+{
+	if (g_chipdata.chipId[0]) snprintf(key, size, "%s", g_chipdata.chipId);
+	else if (g_chipdata.waferId[0])
+		snprintf(key, size, "%s %i%i%c", g_chipdata.waferId,
+			g_chipdata.mapY, g_chipdata.mapX, chipPosChar[g_chipdata.mapPos]);
+	else key[0] = 0;
+}
+
+
+CMD_PROC(phcal)
+{
+	int xmin, xmax, step, ntrig;
+	char filename[256];
+	if (!PAR_IS_INT(xmin, 0, 255)) xmin = 0;
+	if (!PAR_IS_INT(xmax, xmin, 255)) xmax = 140;
+	if (!PAR_IS_INT(step, 1, 64)) step = 5;
+	if (!PAR_IS_INT(ntrig, 1, 100)) ntrig = 5;
+	if (!PAR_IS_STRING(filename, 255)) filename[0] = 0;
+
+	double t = CPhaseTimer::WallTime();
+	if (!GetPhCalibration(xmin, xmax, step, ntrig, phCal)) { printf("readout error\n"); return true; }
+	double tScan = CPhaseTimer::WallTime() - t;
+	t = CPhaseTimer::WallTime();
+	phCal.Fit(CPhCalibration::TANH);
+	double tFit = CPhaseTimer::WallTime() - t;
+
+	// statistics and Vcal residual of the lookup table
+	int n = 0, nr = 0;
+	double sg = 0.0, sg2 = 0.0, sp = 0.0, sp2 = 0.0, sr = 0.0;
+	for (int col=0; col<ROC_NUMCOLS; col++) for (int row=0; row<ROC_NUMROWS; row++)
+	{
+		if (!phCal.IsCalibrated(col, row)) continue;
+		double g = phCal.Gain(col, row), p = phCal.Pedestal(col, row);
+		n++; sg += g; sg2 += g*g; sp += p; sp2 += p*p;
+		for (unsigned int k=0; k<phCal.Steps(); k++)
+		{
+			float ph = phCal.GetPh(k, col, row);
+			if (ph < 0.0f || ph >= 255.0f) continue;
+			int vcal = phCal.X0() + k*phCal.StepSize();
+			sr += fabs(double(phCal.ToVcal(col, row, int(ph + 0.5f))) - vcal);
+			nr++;
+		}
+	}
+	if (n)
+	{
+		sg /= n; sp /= n;
+		printf("gain %0.3f (rms %0.3f), pedestal %0.1f (rms %0.1f), %i pixel\n",
+			sg, sqrt(sg2/n - sg*sg), sp, sqrt(sp2/n - sp*sp), n);
+	}
+	if (nr) printf("Vcal lookup residual %0.2f\n", sr/nr);
+	printf("scan %0.2f s, fit %0.3f ms\n", tScan, tFit*1000.0);
+
+	if (filename[0])
+	{
+		char key[CPhCalibration::IDSIZE];
+		GetChipKey(key, sizeof(key));
+		if (!phCal.Save(filename, key)) printf("error writing %s\n", filename);
+	}
+	return true;
+}
+
+
+CMD_PROC(phcalload)
+{
+	char filename[256];
+	PAR_STRING(filename, 255);
+	char key[CPhCalibration::IDSIZE];
+	GetChipKey(key, sizeof(key));
+	if (!phCal.Load(filename, key[0] ? key : 0))
+		printf("could not load %s (missing or other chip)\n", filename);
+	return true;
+}
+
+
+CModule module;
+
+CMD_PROC(modconfig)
+{
+	char filename[256];
+	if (PAR_IS_STRING(filename, 255))
+	{
+		module.Clear();
+		if (!module.Load(filename)) return true;
+	}
+
+	CRocShadow &shadow = tb.Shadow();
+	unsigned long skipped[2] = { 0, 0 };
+	for (int i=0; i<CRocShadow::NCALLS; i++) skipped[0] += shadow.Skipped(CRocShadow::Call(i));
+	double t = CPhaseTimer::WallTime();
+	module.Configure(roclist);
+	t = CPhaseTimer::WallTime() - t;
+	for (int i=0; i<CRocShadow::NCALLS; i++) skipped[1] += shadow.Skipped(CRocShadow::Call(i));
+	printf("%lu calls, %lu unchanged, %0.3f s\n", module.Calls(), skipped[1] - skipped[0], t);
+	return true;
+}
+
+
+CMD_PROC(modscurve)
+{
+	char s[8];
+	int xmin, xmax, ntrig;
+	unsigned char dac = Vcal;
+	if (PAR_IS_STRING(s, 6))
+	{
+		if (strcmp(s, "vthr") == 0) dac = VthrComp;
+		else if (strcmp(s, "vcal") != 0) { printf("vcal or vthr expected\n"); return true; }
+	}
+	if (!PAR_IS_INT(xmin, 0, 255)) xmin = (dac == Vcal) ? 20 : 10;
+	if (!PAR_IS_INT(xmax, xmin, 255)) xmax = (dac == Vcal) ? 99 : 69;
+	if (!PAR_IS_INT(ntrig, 1, 50)) ntrig = 10;
+
+	// selected ROCs
+	unsigned int nroc = 0, roc;
+	for (roc=0; roc<16; roc++) if (roclist[roc]) nroc++;
+	if (nroc == 0) return true;
+
+	vector<CSCurves> sc;
+	double t = CPhaseTimer::WallTime();
+	if (!GetModuleSCurves(roclist, dac, xmin, xmax, ntrig, sc)) { printf("readout error\n"); return true; }
+	double tScan = CPhaseTimer::WallTime() - t;
+
+	Log.section("MODSCURVE", false);
+	Log.printf(" %s %i %i %i %u\n", (dac == Vcal) ? "vcal" : "vthr", xmin, xmax, ntrig, nroc);
+	printf(" roc  threshold (rms)   noise (rms)  pixel\n");
+	vector<float> thr(CSCurves::NPIXEL), noise(CSCurves::NPIXEL);
+	for (roc=0; roc<sc.size(); roc++)
+	{
+		if (!roclist[roc]) continue;
+		sc[roc].Fit(&thr[0], &noise[0]);
+		int n = 0;
+		double st = 0.0, st2 = 0.0, sn = 0.0, sn2 = 0.0;
+		for (unsigned int p=0; p<CSCurves::NPIXEL; p++)
+		{
+			if (thr[p] < 0.0f) continue;
+			n++; st += thr[p]; st2 += thr[p]*thr[p]; sn += noise[p]; sn2 += noise[p]*noise[p];
+		}
+		if (n) { st /= n; st2 = sqrt(st2/n - st*st); sn /= n; sn2 = sqrt(sn2/n - sn*sn); }
+		printf(" %3u %9.2f %6.2f %7.2f %6.2f %6i\n", roc, st, st2, sn, sn2, n);
+		Log.printf("%2u %0.2f %0.2f %0.2f %0.2f %i\n", roc, st, st2, sn, sn2, n);
+	}
+	Log.flush();
+	printf("scan %0.2f s, %u ROCs\n", tScan, nroc);
+	return true;
+}
+
+
+CWaferDataBase waferDb;
+
+CMD_PROC(readlog)
+{
+	char filename[256];
+	int nthreads;
+	PAR_STRING(filename, 255);
+	if (!PAR_IS_INT(nthreads, 1, 256)) nthreads = 0;
+
+	double t = CPhaseTimer::WallTime();
+	if (!waferDb.Read(filename, nthreads))
+	{
+		if (errnr == ERROR_OPEN || errnr == ERROR_NO_LOGFILE) { printf("%s\n", errormsg()); return true; }
+		printf("chip %u: %s\n", waferDb.Count()+1, errormsg());
+	}
+	double tRead = CPhaseTimer::WallTime() - t;
+
+	t = CPhaseTimer::WallTime();
+	waferDb.CorrectAoutOffset();
+	waferDb.Calculate(nthreads);
+	waferDb.SortPicOrder();
+	waferDb.CalculateMulti();
+	waferDb.SetPicGroups();
+	double tCalc = CPhaseTimer::WallTime() - t;
+	printf("%u chips, read %0.3f s, evaluation %0.3f s\n", waferDb.Count(), tRead, tCalc);
+	return true;
+}
+
+
+CMD_PROC(store)
+{
+	char dir[256];
+	if (PAR_IS_STRING(dir, 255))
+	{
+		if (strcmp(dir, "close") == 0) { resultStore.Close(); return true; }
+		if (!resultStore.Open(dir, true)) { printf("could not open result store %s\n", dir); return true; }
+	}
+	if (resultStore.IsWritable())
+		printf("result store %s: %u chips\n", resultStore.Dir(), resultStore.Rows());
+	else printf("no result store\n");
+	return true;
+}
+
+
+CMD_PROC(wstat)
+{
+	char s[256];
+	int x;
+	if (PAR_IS_STRING(s, 255))
+	{
+		if (strcmp(s, "reset") == 0) waferStat.Reset();
+		else if (strcmp(s, "alarm") == 0)
+		{
+			PAR_INT(x, 0, 100);
+			waferStat.SetAlarm(x);
+		}
+		else if (strcmp(s, "file") == 0)
+		{
+			PAR_STRING(s, 255);
+			if (!PAR_IS_INT(x, 1, 10000)) x = 10;
+			if (strcmp(s, "off") == 0) waferStat.SetFile("", x);
+			else if (!waferStat.SetFile(s, x)) printf("could not write %s\n", s);
+		}
+		else { printf("wstat [reset | alarm <%%> | file <name>|off [period]]\n"); return true; }
+		return true;
+	}
+	waferStat.Print(stdout);
+	if (*waferStat.File()) printf("summary file: %s (every %u chips)\n", waferStat.File(), waferStat.Period());
+	if (waferStat.Alarm() > 0.0) printf("yield alarm: < %0.0f%%\n", waferStat.Alarm());
+	return true;
+}
+
+
+CMD_PROC(logstore)
+{
+	char filename[256], dir[256];
+	PAR_STRING(filename, 255);
+	PAR_STRING(dir, 255);
+
+	CWaferDataBase db;
+	if (!db.Read(filename))
+	{
+		if (errnr == ERROR_OPEN || errnr == ERROR_NO_LOGFILE) { printf("%s\n", errormsg()); return true; }
+		printf("chip %u: %s\n", db.Count()+1, errormsg());
+	}
+	db.Calculate();
+
+	CResultStore store;
+	if (!store.Open(dir, true)) { printf("could not open result store %s\n", dir); return true; }
+	for (CChip *p = db.GetFirstM(); p; p = db.GetNextM(p))
+		if (!store.Append(*p)) { printf("result store write error\n"); break; }
+	printf("%u chips, result store %s: %u chips\n", db.Count(), dir, store.Rows());
+	return true;
+}
+
+
+CMD_PROC(readstore)
+{
+	char dir[256];
+	int pixmaps;
+	PAR_STRING(dir, 255);
+	if (!PAR_IS_INT(pixmaps, 0, 1)) pixmaps = 0;
+
+	double t = CPhaseTimer::WallTime();
+	if (!waferDb.ReadStore(dir, pixmaps != 0)) printf("could not read result store %s\n", dir);
+	double tRead = CPhaseTimer::WallTime() - t;
+
+	t = CPhaseTimer::WallTime();
+	if (pixmaps)
+	{
+		waferDb.CorrectAoutOffset();
+		waferDb.Calculate();
+	}
+	waferDb.SortPicOrder();
+	waferDb.CalculateMulti();
+	double tCalc = CPhaseTimer::WallTime() - t;
+	printf("%u chips, read %0.3f s, evaluation %0.3f s\n", waferDb.Count(), tRead, tCalc);
+	return true;
+}
+
+
+CMD_PROC(storestat)
+{
+	char dir[256], filename[256];
+	PAR_STRING(dir, 255);
+
+	CResultStore store;
+	if (!store.Open(dir)) { printf("could not open result store %s\n", dir); return true; }
+	FILE *f = stdout;
+	if (PAR_IS_STRING(filename, 255) && (f = fopen(filename, "wt")) == NULL)
+	{
+		printf("could not write %s\n", filename);
+		return true;
+	}
+	if (!store.Statistics(f)) printf("result store %s: columns missing\n", dir);
+	if (f != stdout) fclose(f);
+	return true;
+}
+
+
+CMD_PROC(logwmap)
+{
+	static const char *modes[3] = { "bin", "fail", "class" };
+	char filename[256], s[16];
+	PAR_STRING(filename, 255);
+	unsigned int mode = 0;
+	if (PAR_IS_STRING(s, 15))
+	{
+		while (mode < 3 && strcmp(s, modes[mode]) != 0) mode++;
+		if (mode >= 3) { printf("map type: bin, fail or class\n"); return true; }
+	}
+	if (!WaferImage(waferDb, filename, mode)) printf("could not write %s\n", filename);
+	return true;
+}
+
+
+CMD_PROC(logpiximg)
+{
+	char dir[256], s[16], ext[8];
+	int nthreads;
+	PAR_STRING(dir, 255);
+	unsigned int type = NPIXIMG; // all
+	if (PAR_IS_STRING(s, 15) && strcmp(s, "all") != 0)
+	{
+		for (type = 0; type < NPIXIMG && strcmp(s, PIXIMG_NAME[type]) != 0; type++);
+		if (type >= NPIXIMG) { printf("map type: defect, thr, ph1, phgain, ref or all\n"); return true; }
+	}
+	if (!PAR_IS_STRING(ext, 7)) strcpy(ext, "png");
+	if (!PAR_IS_INT(nthreads, 1, 256)) nthreads = 0;
+
+	double t = CPhaseTimer::WallTime();
+	unsigned int n = 0;
+	for (unsigned int i = (type < NPIXIMG) ? type : 0; i < ((type < NPIXIMG) ? type+1 : NPIXIMG); i++)
+		n += PixelImages(waferDb, i, dir, ext, nthreads);
+	printf("%u images, %0.3f s\n", n, CPhaseTimer::WallTime() - t);
+	return true;
+}
+
+
+CMD_PROC(pixcache)
+{
+	int mb;
+	if (PAR_IS_INT(mb, 1, 1000000)) waferDb.pixmapCache.SetBudget(size_t(mb) << 20);
+	CPixMapCache &c = waferDb.pixmapCache;
+	printf("pixel map cache: %u MB, %u maps, %lu loads, %lu hits\n",
+		(unsigned int)(c.Budget() >> 20), c.Count(), c.Loads(), c.Hits());
+	return true;
+}
+
+
+CMD_PROC(logreport)
+{
+	char name[240], filename[256];
+	PAR_STRING(name, 239);
+
+	sprintf(filename, "%s_table.txt", name);
+	if (!waferDb.GenerateDataTable(filename)) printf("could not write %s\n", filename);
+	sprintf(filename, "%s_stat.txt", name);
+	if (!waferDb.GenerateStatistics(filename)) printf("could not write %s\n", filename);
+	sprintf(filename, "%s_error.txt", name);
+	if (!waferDb.GenerateErrorReport(filename)) printf("could not write %s\n", filename);
+	sprintf(filename, "%s_pick.txt", name);
+	if (!waferDb.GeneratePickFile(filename)) printf("could not write %s\n", filename);
+	return true;
+}
+
+
+CMD_PROC(logxml)
+{
+	char path[256];
+	int nthreads;
+	PAR_STRING(path, 255);
+	if (!PAR_IS_INT(nthreads, 1, 256)) nthreads = 0;
+
+	double t = CPhaseTimer::WallTime();
+	if (!waferDb.GenerateXML(path, nthreads)) printf("could not write all XML files to %s\n", path);
+	printf("XML export %0.3f s\n", CPhaseTimer::WallTime() - t);
+	return true;
+}
+
+
+CMD_PROC(trim)
+{
+	int vcal, ntrig;
+	if (!PAR_IS_INT(vcal, 1, 252)) vcal = 40;
+	if (!PAR_IS_INT(ntrig, 1, 100)) ntrig = 10;
+
+	vector<int> level;
+	unsigned long steps = parallelSteps;
+	double t = CPhaseTimer::WallTime();
+	bool ok = TrimChip(vcal, ntrig, level);
+	t = CPhaseTimer::WallTime() - t;
+	if (!ok) { printf("trimming failed\n"); return true; }
+
+	LogTrim();
+	Log.flush();
+
+	int n = 0, nOut = 0;
+	double s1 = 0.0, s2 = 0.0;
+	for (unsigned int i=0; i<level.size(); i++)
+	{
+		if (level[i] >= 253) continue;
+		n++; s1 += level[i]; s2 += level[i]*level[i];
+		if (abs(level[i] - vcal) > 2) nOut++;
+	}
+	printf("VthrComp %i, Vtrim %i\n", g_chipdata.trimVthrComp, g_chipdata.trimVtrim);
+	if (n)
+	{
+		s1 /= n;
+		printf("threshold %0.2f (rms %0.2f), %i pixel, %i pixel > 2 from %i\n",
+			s1, sqrt(s2/n - s1*s1), n, nOut, vcal);
+	}
+	printf("%lu DAC steps, %0.2f s\n", parallelSteps - steps, t);
+	return true;
+}
+
+
+CMD_PROC(trimtest)
+{
+	int vcal;
+	if (PAR_IS_INT(vcal, 0, 252)) trimTest = vcal;
+	if (trimTest > 0) printf("trimming in chip test to Vcal %i\n", trimTest);
+	else printf("no trimming in chip test\n");
+	return true;
+}
+
+
+CMD_PROC(flow)
+{
+	char s[256];
+	if (!PAR_IS_STRING(s, 255)) { testFlow.Print(); return true; }
+	if (strcmp(s, "time") == 0) { testFlow.PrintTiming(); return true; }
+	if (LoadTestFlow(strcmp(s, "default") == 0 ? 0 : s)) testFlow.Print();
+	return true;
+}
+
+
+CMD_PROC(searchcheck)
+{
+	int ncol;
+	if (!PAR_IS_INT(ncol, 1, ROC_NUMCOLS)) ncol = 4;
+	CheckThresholdSearch(ncol);
+	return true;
+}
+
+
 #define CSX   8050
 #define CSY  10451
 
@@ -2456,11 +3305,7 @@ bool go_TestDefects()
 		Log.timestamp("BEGIN");
 		bool repeat;
 		int bin = test_roc_dig(repeat);
-		GetTimeStamp(g_chipdata.endTime);
-		Log.timestamp("END");
-		Log.puts("\n");
-		Log.flush();
-		printf("%3i\n", bin);
+		EndOfChip(bin);
 		prober.printf("BinMapDie %i", bin);
 
 		if (keypressed())
@@ -2493,11 +3338,7 @@ bool TestSingleChip(int &bin, bool &repeat)
 	tb.Flush();
 
 	//		if (0<bin && bin<13) deflist[chipPos].add(x,y);
-	GetTimeStamp(g_chipdata.endTime);
-	Log.timestamp("END");
-	Log.puts("\n");
-	Log.flush();
-	printf("%3i\n", bin);
+	EndOfChip(bin);
 	return true;
 }
 
@@ -2617,6 +3458,7 @@ CMD_PROC(go)
 			break;
 		}
 	}
+	if (!waferStat.Save()) printf(" could not write %s\n", waferStat.File());
 	return true;
 }
 
@@ -2704,8 +3546,15 @@ void cmd()
 	CMD_REG(welcome,  "welcome                       blinks with LEDs");
 	CMD_REG(setled,   "setled                        set atb LEDs"); //give 0-15 as parameter for four LEDs
 	CMD_REG(log,      "log <text>                    writes text to log file");
+	CMD_REG(logasync, "logasync [0|1]                log file written by a separate thread");
 	CMD_REG(upgrade,  "upgrade <filename>            upgrade DTB");
 	CMD_REG(rpcinfo,  "rpcinfo                       lists DTB functions");
+	CMD_REG(rpcbench, "rpcbench [n]                  RPC message throughput (loopback)");
+	CMD_REG(trace,    "trace [<file>]                start timeline trace / write it");
+	CMD_REG(record,   "record [<file>]               start/stop recording of RPC session");
+	CMD_REG(replay,   "replay [<file>]               start/stop offline replay of RPC session");
+	CMD_REG(sim,      "sim [<seed> [<nroc>]]         start/stop offline DTB with simulated ROC");
+	CMD_REG(shadow,   "shadow [on|off|clear]         ROC register shadow and saved calls");
 	CMD_REG(ver,      "ver                           shows DTB software version number");
 	CMD_REG(version,  "version                       shows DTB software version");
 	CMD_REG(info,     "info                          shows detailed DTB info");
@@ -2806,6 +3655,7 @@ void cmd()
 	CMD_REG(ethsend,  "ethsend <string>              send <string> in a Ethernet packet");
 	CMD_REG(ethrx,    "ethrx                         shows number of received packets");
 	CMD_REG(shmoo,    "shmoo vx xrange vy ymin yrange");
+	CMD_REG(ashmoo,   "ashmoo vx xrange vy yrange [step [file]]");
 	CMD_REG(phscan,   "phscan                        ROC pulse height scan");
 	CMD_REG(readback, "readback                      read out ROC data");
 	CMD_REG(deser160, "deser160                      allign deser160");
@@ -2816,6 +3666,28 @@ void cmd()
 	CMD_REG(test,     "test                          run chip test");
 	else
 	CMD_REG(test,     "test <chip id>                run chip test");
+	CMD_REG(search,   "search [puc|pucc <mode>]      threshold search mode of PUC tests");
+	CMD_REG(vote,     "vote [<batch> [<alpha>]]      trigger majority early stop (0 = off)");
+	CMD_REG(scurve,   "scurve [vcal|vthr] [x0 x1 n]  S-curves, threshold and noise map");
+	CMD_REG(modconfig,"modconfig [file]              configure all selected ROCs in one batch");
+	CMD_REG(modscurve,"modscurve [...]               scurve on all ROCs 0..n in parallel");
+	CMD_REG(phcal,    "phcal [x0 x1 step n [file]]   PH calibration, gain and pedestal map");
+	CMD_REG(phcalload,"phcalload <file>              PH calibration of the current chip for phscan");
+	CMD_REG(trim,     "trim [vcal [ntrig]]           trim bits to the Vcal threshold");
+	CMD_REG(trimtest, "trimtest [vcal]               trimming in chip test (0 = off)");
+	CMD_REG(flow,     "flow [file|default|time]      chip test flow, step timing");
+	CMD_REG(searchcheck,"searchcheck [ncol]            compare threshold search modes");
+	CMD_REG(readlog,  "readlog <file> [threads]      read and evaluate chip test log (wafer database)");
+	CMD_REG(logreport,"logreport <name>              data table, statistics, errors, pick file");
+	CMD_REG(logxml,   "logxml <dir> [threads]        XML file of each chip for the production data base");
+	CMD_REG(logwmap,  "logwmap <file> [mode]         wafer map image, mode bin|fail|class");
+	CMD_REG(logpiximg,"logpiximg <dir> [type] [ext]  pixel map images of all chips [threads]");
+	CMD_REG(pixcache, "pixcache [MB]                 pixel map cache of the wafer database");
+	CMD_REG(store,    "store [<dir>|close]           result store of the tested chips");
+	CMD_REG(wstat,    "wstat [reset|alarm|file]      running statistics of the tested wafer");
+	CMD_REG(logstore, "logstore <file> <dir>         chip test log into result store");
+	CMD_REG(readstore,"readstore <dir> [pixmaps]     wafer database from result store (1 = evaluate)");
+	CMD_REG(storestat,"storestat <dir> [file]        statistics and yield per wafer from result store");
 
 	if (settings.port_prober >= 0)
 	{
@@ -2847,6 +3719,7 @@ void cmd()
 		catch (CRpcError e)
 		{
 			e.What();
+			tb.Shadow().Invalidate();
 		}
 	}
 }
@@ -11,7 +11,8 @@
 
 // === set profiling options ================================================
 // if defined a profiling infos are collected during execution
-// and a report is created after termination (only Windows)
+// and a report is created after termination (profiler_report.txt,
+// on Linux also profiler_report.csv)
 
 // #define ENABLE_PROFILING
 
@@ -19,8 +20,17 @@
 // #define ENABLE_RPC_PROFILING
 
 
+// === timeline trace =======================================================
+// if defined test phases, rpc calls and USB transfers can be recorded
+// (command "trace") and written as Chrome trace file
+
+// #define ENABLE_TRACING
+
+
 // === thread safe CTestboard class =========================================
-// if defined -> CTestboard is thread safe (Boost thread library needed)
+// if defined -> CTestboard is thread safe. Calls from several threads are
+// multiplexed on the USB link and the replies are routed back in request
+// order (std::thread, no Boost library needed)
 
 // #define ENABLE_MULTITHREADING
 
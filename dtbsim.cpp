@@ -0,0 +1,546 @@
+// dtbsim.cpp
+
+#include <math.h>
+#include "pixel_dtb.h"
+#include "dtbsim.h"
+
+#define CALDEL_MIN   40  // CalDel window of the calibrate signal
+#define CALDEL_MAX  100
+#define TRIM_SCALE  0.025 // threshold change per trim unit and Vtrim
+
+
+// === RPC decoding =========================================================
+
+unsigned int CDtbSim::TypeSize(char type)
+{
+	switch (type)
+	{
+		case 'b': case 'c': case 'C': return 1;
+		case 's': case 'S': return 2;
+		case 'i': case 'I': return 4;
+		case 'l': case 'L': return 8;
+		default: return 0;
+	}
+}
+
+
+bool CDtbSim::Function::Parse(const std::string &callName)
+{
+	size_t pos = callName.rfind('$');
+	if (pos == std::string::npos || pos + 1 >= callName.size()) return false;
+	name = callName.substr(0, pos++);
+	ret = callName[pos++];
+	parType.clear(); parMode.clear(); parOffset.clear();
+	parSize = dataIn = 0;
+	while (pos < callName.size())
+	{
+		char mode = '-';
+		if (callName[pos] >= '0' && callName[pos] <= '4')
+		{
+			mode = callName[pos++];
+			if (pos >= callName.size()) return false;
+		}
+		parMode.push_back(mode);
+		parType.push_back(callName[pos++]);
+		parOffset.push_back(parSize);
+		if (mode == '-' || mode == '0') parSize += TypeSize(parType[parType.size()-1]);
+		else if (mode == '1' || mode == '3') dataIn++;
+	}
+	return true;
+}
+
+
+uint32_t CDtbSim::Par(unsigned int i)
+{
+	const uint8_t *p = m_par + m_call->parOffset[i];
+	switch (m_call->parType[i])
+	{
+		case 'b': return rpc_Get_BOOL(p);
+		case 'c': return rpc_Get_INT8(p);
+		case 'C': return rpc_Get_UINT8(p);
+		case 's': return rpc_Get_INT16(p);
+		case 'S': return rpc_Get_UINT16(p);
+		case 'i': return rpc_Get_INT32(p);
+		case 'I': return rpc_Get_UINT32(p);
+		default: return 0;
+	}
+}
+
+
+bool CDtbSim::Execute()
+{ // executes the first message in m_in if it is complete
+	if (m_in.size() < 4) return false;
+	if (m_in[0] != RPC_TYPE_DTB) throw CRpcError(CRpcError::WRONG_MSG_TYPE);
+	unsigned int id = rpc_Get_UINT16(&m_in[1]);
+	if (id >= m_fn.size()) throw CRpcError(CRpcError::UNKNOWN_CMD);
+	const Function &f = m_fn[id];
+	if (m_in[3] != f.parSize) throw CRpcError(CRpcError::CMD_PAR_SIZE);
+
+	// wait for the data messages
+	unsigned int pos = 4 + f.parSize;
+	m_dataIn.resize(f.dataIn);
+	for (unsigned int i = 0; i < f.dataIn; i++)
+	{
+		if (m_in.size() < pos + 4) return false;
+		if (m_in[pos] != RPC_TYPE_DTB_DATA) throw CRpcError(CRpcError::NO_DATA_MSG);
+		unsigned int size = rpc_Get_UINT16(&m_in[pos+2]);
+		if (m_in.size() < pos + 4 + size) return false;
+		m_dataIn[i].assign((const char*)&m_in[pos+4], size);
+		pos += 4 + size;
+	}
+
+	m_call = &f;
+	m_callId = id;
+	m_par = &m_in[4];
+	m_ret = 0;
+	m_ref.assign(f.parMode.size(), 0);
+	m_dataOut.assign(f.parMode.size(), std::vector<uint8_t>());
+	std::map<std::string, Exec>::iterator e = m_exec.find(f.name);
+	if (e != m_exec.end()) (this->*(e->second))();
+	Reply();
+
+	m_in.erase(m_in.begin(), m_in.begin() + pos);
+	return true;
+}
+
+
+void CDtbSim::Reply()
+{
+	const Function &f = *m_call;
+	bool reply = f.ret != 'v';
+	unsigned int i, size = TypeSize(f.ret);
+	for (i = 0; i < f.parMode.size(); i++)
+	{
+		if (f.parMode[i] == '0') size += TypeSize(f.parType[i]);
+		if (f.parMode[i] == '0' || f.parMode[i] == '2' || f.parMode[i] == '4') reply = true;
+	}
+	if (!reply) return;
+
+	if (m_outPos >= m_out.size()) { m_out.clear(); m_outPos = 0; }
+	unsigned int pos = m_out.size();
+	m_out.resize(pos + 4 + size);
+	uint8_t *p = &m_out[pos];
+	p[0] = RPC_TYPE_DTB;
+	rpc_Put_UINT16(p+1, m_callId);
+	p[3] = uint8_t(size);
+	p += 4;
+	uint64_t ret = m_ret;
+	for (unsigned int k = 0; k < TypeSize(f.ret); k++, ret >>= 8) *p++ = uint8_t(ret);
+	for (i = 0; i < f.parMode.size(); i++) if (f.parMode[i] == '0')
+	{
+		uint32_t ref = m_ref[i];
+		for (unsigned int k = 0; k < TypeSize(f.parType[i]); k++, ref >>= 8) *p++ = uint8_t(ref);
+	}
+
+	for (i = 0; i < f.parMode.size(); i++)
+		if (f.parMode[i] == '2' || f.parMode[i] == '4')
+		{
+			std::vector<uint8_t> &d = m_dataOut[i];
+			if (d.size() > 0xffff) d.resize(0xffff);
+			pos = m_out.size();
+			m_out.resize(pos + 4 + d.size());
+			m_out[pos] = RPC_TYPE_DTB_DATA;
+			m_out[pos+1] = 0;
+			rpc_Put_UINT16(&m_out[pos+2], uint16_t(d.size()));
+			if (d.size()) memcpy(&m_out[pos+4], &d[0], d.size());
+		}
+}
+
+
+void CDtbSim::Write(const void *buffer, unsigned int size)
+{
+	const uint8_t *p = (const uint8_t*)buffer;
+	m_in.insert(m_in.end(), p, p + size);
+	try { while (Execute()) {} }
+	catch (CRpcError) { m_in.clear(); throw; }
+}
+
+
+void CDtbSim::Read(void *buffer, unsigned int size)
+{
+	if (m_outPos + size > m_out.size()) throw CRpcError(CRpcError::READ_TIMEOUT);
+	memcpy(buffer, &m_out[m_outPos], size);
+	m_outPos += size;
+}
+
+
+// === chip model ===========================================================
+
+CDtbSim::CDtbSim(unsigned int seed, unsigned int nroc) : m_outPos(0), m_call(0), m_callId(0), m_par(0)
+{
+	m_exec["GetRpcVersion"]   = &CDtbSim::GetRpcVersion;
+	m_exec["GetRpcCallId"]    = &CDtbSim::GetRpcCallId;
+	m_exec["GetRpcCallCount"] = &CDtbSim::GetRpcCallCount;
+	m_exec["GetRpcCallName"]  = &CDtbSim::GetRpcCallName;
+	m_exec["Pon"]             = &CDtbSim::Pon;
+	m_exec["Poff"]            = &CDtbSim::Poff;
+	m_exec["_GetVD"]          = &CDtbSim::GetVD;
+	m_exec["_GetVA"]          = &CDtbSim::GetVA;
+	m_exec["_GetID"]          = &CDtbSim::GetID;
+	m_exec["_GetIA"]          = &CDtbSim::GetIA;
+	m_exec["SetRocAddress"]   = &CDtbSim::SetRocAddress;
+	m_exec["Pg_SetCmd"]       = &CDtbSim::Pg_SetCmd;
+	m_exec["Pg_Single"]       = &CDtbSim::Pg_Single;
+	m_exec["Daq_Open"]        = &CDtbSim::Daq_Open;
+	m_exec["Daq_Close"]       = &CDtbSim::Daq_Close;
+	m_exec["Daq_Start"]       = &CDtbSim::Daq_Start;
+	m_exec["Daq_Stop"]        = &CDtbSim::Daq_Stop;
+	m_exec["Daq_GetSize"]     = &CDtbSim::Daq_GetSize;
+	m_exec["Daq_Read"]        = &CDtbSim::Daq_Read;
+	m_exec["roc_I2cAddr"]     = &CDtbSim::roc_I2cAddr;
+	m_exec["roc_ClrCal"]      = &CDtbSim::roc_ClrCal;
+	m_exec["roc_SetDAC"]      = &CDtbSim::roc_SetDAC;
+	m_exec["roc_Pix"]         = &CDtbSim::roc_Pix;
+	m_exec["roc_Pix_Trim"]    = &CDtbSim::roc_Pix_Trim;
+	m_exec["roc_Pix_Mask"]    = &CDtbSim::roc_Pix_Mask;
+	m_exec["roc_Pix_Cal"]     = &CDtbSim::roc_Pix_Cal;
+	m_exec["roc_Col_Enable"]  = &CDtbSim::roc_Col_Enable;
+	m_exec["roc_Col_Mask"]    = &CDtbSim::roc_Col_Mask;
+	m_exec["roc_Chip_Mask"]   = &CDtbSim::roc_Chip_Mask;
+	m_exec["testColPixel"]    = &CDtbSim::testColPixel;
+	Reset(seed, nroc);
+}
+
+
+void CDtbSim::Reset(unsigned int seed, unsigned int nroc)
+{
+	// call ids 0 and 1 are fixed
+	m_fn.clear();
+	m_fnId.clear();
+	const char *fixed[2] = { "GetRpcVersion$S", "GetRpcCallId$i3c" };
+	for (int i = 0; i < 2; i++)
+	{
+		Function f;
+		f.Parse(fixed[i]);
+		m_fnId[fixed[i]] = i;
+		m_fn.push_back(f);
+	}
+	Clear();
+
+	// chips
+	if (nroc < 1) nroc = 1; else if (nroc > 16) nroc = 16;
+	m_roc.resize(nroc);
+	m_rnd.seed(seed);
+	m_gauss.reset();
+	for (unsigned int i = 0; i < nroc; i++)
+	{
+		Roc &roc = m_roc[i];
+		for (int col = 0; col < 52; col++) for (int row = 0; row < 80; row++)
+		{
+			Pixel &p = roc.pix[col][row];
+			p.thr0 = 30.0f + 5.0f*m_gauss(m_rnd);
+			p.noise = 1.0f + 0.2f*fabs(m_gauss(m_rnd));
+			p.trimGain = 1.0f + 0.1f*m_gauss(m_rnd);
+			p.ped = 30.0f + 8.0f*m_gauss(m_rnd);
+			p.gain = 700.0f + 70.0f*m_gauss(m_rnd);
+			p.dead = (m_rnd() % 1000) < 3;
+			p.trim = 15;
+			p.mask = true;
+			p.cal = false;
+		}
+		for (int k = 0; k < 26; k++) roc.dcolEnable[k] = false;
+		roc.calList.clear();
+		memset(roc.dac, 0, sizeof(roc.dac));
+		roc.lastDac = roc.lastData = 0;
+		roc.rbValue = 0;
+	}
+	m_i2cAddr = m_rocAddr = 0;
+	m_power = false;
+	memset(m_pg, 0, sizeof(m_pg));
+	m_rbCount = 0;
+	m_daqOpen = m_daqRun = false;
+	m_daq.clear();
+	m_daqPos = 0;
+	m_pgSingle = 0;
+	m_colPixelVcal = 9; // first estimation
+}
+
+
+CDtbSim::Roc* CDtbSim::Selected()
+{
+	if (m_roc.size() == 1) return (m_i2cAddr == m_rocAddr) ? &m_roc[0] : 0;
+	return (m_i2cAddr < int(m_roc.size())) ? &m_roc[m_i2cAddr] : 0;
+}
+
+
+double CDtbSim::Threshold(const Roc &roc, int col, int row)
+{
+	const Pixel &p = roc.pix[col][row];
+	return p.thr0 + (40 - roc.dac[VthrComp])
+		- (15 - p.trim)*roc.dac[Vtrim]*TRIM_SCALE*p.trimGain;
+}
+
+
+bool CDtbSim::Fires(const Roc &roc, int col, int row, double q)
+{
+	const Pixel &p = roc.pix[col][row];
+	if (p.dead || p.mask) return false;
+	return q + p.noise*m_gauss(m_rnd) > Threshold(roc, col, row);
+}
+
+
+void CDtbSim::PixelFlags(int col, int row, uint8_t value)
+{
+	Roc *roc = Selected();
+	if (!roc || col >= 52 || row >= 80) return;
+	roc->pix[col][row].trim = value & 0x0f;
+	roc->pix[col][row].mask = (value & 0x80) != 0;
+}
+
+
+void CDtbSim::Cal(int col, int row, bool on)
+{
+	Roc *roc = Selected();
+	if (!roc || col >= 52 || row >= 80) return;
+	Pixel &p = roc->pix[col][row];
+	if (on && !p.cal) roc->calList.push_back(col*80 + row);
+	p.cal = on;
+}
+
+
+void CDtbSim::Trigger(bool cal)
+{ // token pass through all ROCs
+	unsigned int j = m_rbCount++ % 16;
+	if (m_roc.size() == 1) { Readout(m_roc[0], m_rocAddr, j, cal); return; }
+	for (unsigned int i = 0; i < m_roc.size(); i++) Readout(m_roc[i], i, j, cal);
+}
+
+
+void CDtbSim::Readout(Roc &roc, int addr, unsigned int j, bool cal)
+{ // ROC header (with readback bit) and hit pixels
+	uint16_t rb;
+	if (j == 0)
+	{ // start bit with D0 of the last value, latch new value
+		rb = 2 | (roc.rbValue & 1);
+		int sel = roc.dac[0xff] & 0x0f;
+		int data = 0;
+		switch (sel)
+		{
+			case  0: data = roc.lastData; break;
+			case  1: data = roc.lastDac; break;
+			case  8: data = 125; break;      // Vd unreg
+			case  9: data = 85;  break;      // Va unreg
+			case 10: data = 130; break;      // Va reg
+			case 11: data = 60;  break;      // bandgap
+			case 12: data = 5 + roc.dac[Vana]/10; break; // Iana
+		}
+		roc.rbValue = uint16_t((addr << 12) | (sel << 8) | data);
+	}
+	else rb = (roc.rbValue >> (16 - j)) & 1;
+
+	if (!(m_daqOpen && m_daqRun)) return;
+	m_daq.push_back(0x87f8 | rb);
+	if (!cal || roc.dac[CalDel] < CALDEL_MIN || roc.dac[CalDel] > CALDEL_MAX) return;
+
+	double q = roc.dac[Vcal] * ((roc.dac[CtrlReg] & 0x04) ? 7.0 : 1.0);
+	for (unsigned int i = 0; i < roc.calList.size(); i++)
+	{
+		int col = roc.calList[i] / 80, row = roc.calList[i] % 80;
+		const Pixel &p = roc.pix[col][row];
+		if (!roc.dcolEnable[col/2] || !Fires(roc, col, row, q)) continue;
+
+		// encode pixel address (base 6) and pulse height
+		int ph = int(p.ped + 200.0*tanh(q/p.gain));
+		if (ph < 0) ph = 0; else if (ph > 255) ph = 255;
+		int c = col/2, r = 2*(80-row) + (col&1);
+		unsigned int raw = ((c/6) << 12) | ((c%6) << 9)
+			| ((r/36) << 6) | (((r/6)%6) << 3) | (r%6);
+		raw = (raw << 9) | ((ph & 0xf0) << 1) | (ph & 0x0f);
+		m_daq.push_back((raw >> 12) & 0xfff);
+		m_daq.push_back(raw & 0xfff);
+	}
+}
+
+
+// === RPC functions ========================================================
+
+void CDtbSim::GetRpcVersion() { Ret(0x0101); }
+
+
+void CDtbSim::GetRpcCallId()
+{
+	std::map<std::string, int>::iterator i = m_fnId.find(m_dataIn[0]);
+	if (i != m_fnId.end()) { Ret(uint32_t(i->second)); return; }
+
+	Function f;
+	if (!f.Parse(m_dataIn[0])) { Ret(uint32_t(-1)); return; }
+	int id = m_fn.size();
+	m_fn.push_back(f);
+	m_fnId[m_dataIn[0]] = id;
+	m_call = &m_fn[m_callId]; // m_fn may have moved
+	Ret(uint32_t(id));
+}
+
+
+void CDtbSim::GetRpcCallCount() { Ret(m_fn.size()); }
+
+
+void CDtbSim::GetRpcCallName()
+{
+	unsigned int id = Par(0);
+	if (id >= m_fn.size()) return;
+	std::map<std::string, int>::iterator i;
+	for (i = m_fnId.begin(); i != m_fnId.end(); i++)
+		if (i->second == int(id))
+		{
+			DataOut(1).assign(i->first.begin(), i->first.end());
+			Ret(1);
+		}
+}
+
+
+void CDtbSim::Pon()  { m_power = true;  }
+void CDtbSim::Poff() { m_power = false; }
+
+void CDtbSim::GetVD() { Ret(m_power ? 2500 : 0); }
+void CDtbSim::GetVA() { Ret(m_power ? 1700 : 0); }
+void CDtbSim::GetID() { Ret(m_power ? 300*m_roc.size() : 0); } // 0.1 mA
+
+
+void CDtbSim::GetIA() // 0.1 mA
+{
+	unsigned int ia = 0;
+	for (unsigned int i = 0; i < m_roc.size(); i++) ia += 80 + 3*m_roc[i].dac[Vana]/2;
+	Ret(m_power ? ia : 0);
+}
+
+void CDtbSim::SetRocAddress() { m_rocAddr = Par(0) & 0x0f; }
+
+
+void CDtbSim::Pg_SetCmd() { m_pg[Par(0) & 0xff] = Par(1); }
+
+
+void CDtbSim::Pg_Single()
+{
+	uint16_t cmd = 0;
+	for (int i = 0; i < 256; i++)
+	{
+		cmd |= m_pg[i];
+		if ((m_pg[i] & 0xff) == 0) break;
+	}
+	m_pgSingle++;
+	if (cmd & PG_TOK) Trigger((cmd & PG_CAL) && (cmd & PG_TRG));
+}
+
+
+void CDtbSim::Daq_Open()
+{
+	uint32_t size = Par(0);
+	if (size > 10000000) size = 10000000;
+	m_daqOpen = true;
+	m_daq.clear();
+	m_daqPos = 0;
+	Ret(size);
+}
+
+
+void CDtbSim::Daq_Close() { m_daqOpen = m_daqRun = false; m_daq.clear(); m_daqPos = 0; }
+void CDtbSim::Daq_Start() { m_daqRun = m_daqOpen; }
+void CDtbSim::Daq_Stop()  { m_daqRun = false; }
+void CDtbSim::Daq_GetSize() { Ret(m_daq.size() - m_daqPos); }
+
+
+void CDtbSim::Daq_Read()
+{
+	unsigned int n = m_daq.size() - m_daqPos;
+	if (n > Par(1)) n = Par(1);
+	if (n > 32767) n = 32767;
+	std::vector<uint8_t> &d = DataOut(0);
+	d.resize(2*n);
+	if (n) memcpy(&d[0], &m_daq[m_daqPos], 2*n);
+	m_daqPos += n;
+	if (m_daqPos >= m_daq.size()) { m_daq.clear(); m_daqPos = 0; }
+	if (m_call->parMode.size() > 2) Ref(2, m_daq.size() - m_daqPos);
+}
+
+
+void CDtbSim::roc_I2cAddr() { m_i2cAddr = Par(0) & 0x0f; }
+
+
+void CDtbSim::roc_ClrCal()
+{
+	Roc *roc = Selected();
+	if (!roc) return;
+	for (unsigned int i = 0; i < roc->calList.size(); i++)
+		roc->pix[roc->calList[i]/80][roc->calList[i]%80].cal = false;
+	roc->calList.clear();
+}
+
+
+void CDtbSim::roc_SetDAC()
+{
+	Roc *roc = Selected();
+	if (!roc) return;
+	roc->lastDac  = Par(0);
+	roc->lastData = Par(1);
+	roc->dac[roc->lastDac] = roc->lastData;
+}
+
+
+void CDtbSim::roc_Pix()      { PixelFlags(Par(0), Par(1), Par(2)); }
+void CDtbSim::roc_Pix_Trim() { PixelFlags(Par(0), Par(1), Par(2) & 0x0f); }
+void CDtbSim::roc_Pix_Mask() { PixelFlags(Par(0), Par(1), 0x8f); }
+void CDtbSim::roc_Pix_Cal()  { Cal(Par(0), Par(1), true); }
+
+
+void CDtbSim::roc_Col_Enable()
+{
+	Roc *roc = Selected();
+	if (roc && Par(0) < 52) roc->dcolEnable[Par(0)/2] = Par(1) != 0;
+}
+
+
+void CDtbSim::roc_Col_Mask()
+{
+	Roc *roc = Selected();
+	unsigned int col = Par(0);
+	if (!roc || col >= 52) return;
+	for (int row = 0; row < 80; row++) roc->pix[col][row].mask = true;
+	roc->dcolEnable[col/2] = false;
+}
+
+
+void CDtbSim::roc_Chip_Mask()
+{
+	Roc *roc = Selected();
+	if (!roc) return;
+	for (int col = 0; col < 52; col++)
+		for (int row = 0; row < 80; row++) roc->pix[col][row].mask = true;
+	for (int i = 0; i < 26; i++) roc->dcolEnable[i] = false;
+}
+
+
+void CDtbSim::testColPixel()
+{ // DTB firmware: Vcal threshold (linear walk, 20 triggers) of a column
+	int &x = m_colPixelVcal;
+	unsigned int col = Par(0);
+	uint8_t trim = Par(1);
+	std::vector<uint8_t> &res = DataOut(2);
+	Roc *roc = Selected();
+	if (!roc || col >= 52) return;
+
+	roc->dcolEnable[col/2] = true;
+	for (int row = 0; row < 80; row++)
+	{
+		Pixel &p = roc->pix[col][row];
+		p.trim = trim & 0x0f;
+		p.mask = false;
+		if (x > 253) x = 200; else if (x < 1) x = 1;
+		bool fired = false;
+		for (int dir = 0; ; )
+		{
+			roc->dac[Vcal] = x;
+			int n = 0;
+			for (int k = 0; k < 20; k++) if (Fires(*roc, col, row, x)) n++;
+			m_pgSingle += 20;
+			fired = n > 10;
+			if (dir == 0) dir = fired ? -1 : 1;
+			if (dir < 0) { if (!fired) { x++; break; } if (x <= 1) break; x--; }
+			else         { if (fired || x >= 253) break; x++; }
+		}
+		res.push_back(x);
+		p.mask = true;
+	}
+	roc->dcolEnable[col/2] = false;
+	Ret(1);
+}
@@ -0,0 +1,162 @@
+// dtbsim.h
+//
+// Offline DTB with a simulated PSI46dig ROC. CDtbSim replaces the USB
+// connection of CTestboard (tb.SetIo). It decodes the RPC messages,
+// assigns call ids like the DTB does (GetRpcCallId) and executes the
+// calls on a simple chip model:
+//
+//  - DACs, I2C address, readback register (16 event cycle)
+//  - pixel trim, mask and calibrate bits, double column enable
+//  - pixel threshold in Vcal units (low range) depending on VthrComp,
+//    Vtrim and the trim bits, with gaussian noise
+//  - pulse height, CalDel window, supply currents
+//  - pattern generator, DAQ buffer and the DTB testColPixel function
+//  - a module of up to 16 ROCs (ROC i at I2C address i), read out as
+//    chain of ROC header and hits for each ROC. A single ROC is at the
+//    I2C address of SetRocAddress.
+//
+// Calls without model get an empty default reply. The chip parameters
+// are random but reproducible for a given seed.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include "rpc_io.h"
+
+
+class CDtbSim : public CRpcIo
+{
+	// --- RPC decoding -----------------------------------------------------
+	struct Function
+	{
+		std::string name;       // without signature
+		char ret;               // return type
+		std::string parType;    // type of each parameter
+		std::string parMode;    // '-' value, '0' reference, '1' vector ...
+		std::vector<unsigned int> parOffset; // in command message
+		unsigned int parSize;
+		unsigned int dataIn;    // number of data messages received
+		bool Parse(const std::string &callName);
+	};
+	std::vector<Function> m_fn; // index = call id
+	std::map<std::string, int> m_fnId;
+	typedef void (CDtbSim::*Exec)();
+	std::map<std::string, Exec> m_exec;
+
+	std::vector<uint8_t> m_in;   // received, not yet executed
+	std::vector<uint8_t> m_out;  // replies
+	unsigned int m_outPos;
+
+	// current call
+	const Function *m_call;
+	uint16_t m_callId;
+	const uint8_t *m_par;
+	std::vector<std::string> m_dataIn;
+	uint64_t m_ret;
+	std::vector<uint32_t> m_ref;
+	std::vector< std::vector<uint8_t> > m_dataOut;
+
+	static unsigned int TypeSize(char type);
+	uint32_t Par(unsigned int i);
+	void Ret(uint64_t value) { m_ret = value; }
+	void Ref(unsigned int i, uint32_t value) { m_ref[i] = value; }
+	std::vector<uint8_t>& DataOut(unsigned int i) { return m_dataOut[i]; }
+	bool Execute();
+	void Reply();
+
+	// --- chip model -------------------------------------------------------
+	struct Pixel
+	{
+		float thr0;     // threshold at VthrComp 40 (Vcal low range)
+		float noise;
+		float trimGain; // relative trim bit strength
+		float ped, gain; // pulse height
+		bool dead;
+		uint8_t trim;
+		bool mask;
+		bool cal;
+	};
+	struct Roc
+	{
+		Pixel pix[52][80];
+		bool dcolEnable[26];
+		std::vector<int> calList; // col*80 + row
+		uint8_t dac[256];
+		uint8_t lastDac, lastData;
+		uint16_t rbValue;
+	};
+	std::vector<Roc> m_roc;
+	int m_i2cAddr, m_rocAddr;
+	bool m_power;
+
+	uint16_t m_pg[256];
+	uint32_t m_rbCount;
+
+	bool m_daqOpen, m_daqRun;
+	std::vector<uint16_t> m_daq;
+	unsigned int m_daqPos;
+
+	std::mt19937 m_rnd;
+	std::normal_distribution<float> m_gauss;
+	unsigned long m_pgSingle;
+	int m_colPixelVcal; // testColPixel: start of the next walk (static in the firmware)
+
+	Roc* Selected(); // ROC at the I2C address or 0
+	void PixelFlags(int col, int row, uint8_t value);
+	void Cal(int col, int row, bool on);
+	double Threshold(const Roc &roc, int col, int row);
+	bool Fires(const Roc &roc, int col, int row, double q);
+	void Trigger(bool cal);
+	void Readout(Roc &roc, int addr, unsigned int j, bool cal);
+
+	// --- RPC functions ----------------------------------------------------
+	void GetRpcVersion();
+	void GetRpcCallId();
+	void GetRpcCallCount();
+	void GetRpcCallName();
+	void Pon();
+	void Poff();
+	void GetVD();
+	void GetVA();
+	void GetID();
+	void GetIA();
+	void SetRocAddress();
+	void Pg_SetCmd();
+	void Pg_Single();
+	void Daq_Open();
+	void Daq_Close();
+	void Daq_Start();
+	void Daq_Stop();
+	void Daq_GetSize();
+	void Daq_Read();
+	void roc_I2cAddr();
+	void roc_ClrCal();
+	void roc_SetDAC();
+	void roc_Pix();
+	void roc_Pix_Trim();
+	void roc_Pix_Mask();
+	void roc_Pix_Cal();
+	void roc_Col_Enable();
+	void roc_Col_Mask();
+	void roc_Chip_Mask();
+	void testColPixel();
+
+public:
+	CDtbSim(unsigned int seed = 1, unsigned int nroc = 1);
+	void Reset(unsigned int seed, unsigned int nroc = 1);
+	unsigned int RocCount() { return m_roc.size(); }
+
+	// ROC 0 at current DAC settings
+	double Threshold(int col, int row) { return Threshold(m_roc[0], col, row); }
+	unsigned long PgSingleCount() { return m_pgSingle; }
+
+	void Write(const void *buffer, unsigned int size);
+	void Flush() {}
+	void Clear() { m_in.clear(); m_out.clear(); m_outPos = 0; }
+	void Read(void *buffer, unsigned int size);
+	void Close() {}
+};
@@ -2,7 +2,7 @@
 
 #include "error.h"
 
-int errnr = 0;
+thread_local int errnr = 0;
 
 const char* errormsg()
 {
@@ -46,6 +46,8 @@ const char* errormsg()
 		return "ERROR: incorrect DCOL section!";
 	case ERROR_PUC:
 		return "ERROR: incorrect PUC section!";
+	case ERROR_TRIM:
+		return "ERROR: incorrect TRIM section!";
 	case ERROR_CLASS:
 		return "ERROR: incorrect CLASS section!";
 	case ERROR_POFF:
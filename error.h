@@ -5,7 +5,7 @@
 
 #define ERROR_ABORT(nr) { errnr = (nr); return false; }
 
-extern int errnr;
+extern thread_local int errnr; // per thread (parallel log reading)
 
 enum
 {
@@ -28,6 +28,7 @@ enum
 	ERROR_PH2,
 	ERROR_DCOL,
 	ERROR_PUC,
+	ERROR_TRIM,
 	ERROR_CLASS,
 	ERROR_POFF,
 	ERROR_END,
@@ -0,0 +1,112 @@
+// module.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "psi46test.h"
+#include "module.h"
+
+
+void CModule::Clear()
+{
+	for (int i=0; i<NROCS; i++) for (int reg=0; reg<256; reg++) m_dac[i][reg] = -1;
+	memset(m_pix, 0xff, sizeof(m_pix));
+	m_calls = 0;
+}
+
+
+void CModule::SetDAC(int roc, uint8_t reg, uint8_t value)
+{
+	for (int i = (roc < 0) ? 0 : roc; i < ((roc < 0) ? NROCS : roc+1); i++)
+		m_dac[i][reg] = value;
+}
+
+
+void CModule::SetTrim(int roc, unsigned int col, unsigned int row, uint8_t trim)
+{
+	if (col >= NCOLS || row >= NROWS) return;
+	for (int i = (roc < 0) ? 0 : roc; i < ((roc < 0) ? NROCS : roc+1); i++)
+		m_pix[i][col*NROWS + row] = trim & 0x0f;
+}
+
+
+void CModule::SetMask(int roc, unsigned int col, unsigned int row)
+{
+	if (col >= NCOLS || row >= NROWS) return;
+	for (int i = (roc < 0) ? 0 : roc; i < ((roc < 0) ? NROCS : roc+1); i++)
+		m_pix[i][col*NROWS + row] = 0x8f;
+}
+
+
+bool CModule::Load(const char *filename)
+{
+	FILE *f = fopen(filename, "rt");
+	if (!f) { printf("could not open %s\n", filename); return false; }
+
+	char s[256], roc[8], cmd[16];
+	int lineNr = 0, a, b, c, n;
+	bool ok = true;
+	while (ok && fgets(s, sizeof(s), f))
+	{
+		lineNr++;
+		char *comment = strchr(s, '#');
+		if (comment) *comment = 0;
+		n = sscanf(s, "%7s %15s %i %i %i", roc, cmd, &a, &b, &c);
+		if (n <= 0) continue;
+
+		int i = -1;
+		if (strcmp(roc, "*") != 0)
+		{
+			char *end;
+			i = strtol(roc, &end, 0);
+			if (*end || i < 0 || i >= NROCS) ok = false;
+		}
+		if (!ok) break;
+
+		if (strcmp(cmd, "trim") == 0)
+		{
+			if (n != 5 || a < 0 || a >= NCOLS || b < 0 || b >= NROWS || c < 0 || c > 15) ok = false;
+			else SetTrim(i, a, b, c);
+		}
+		else if (strcmp(cmd, "mask") == 0)
+		{
+			if (n != 4 || a < 0 || a >= NCOLS || b < 0 || b >= NROWS) ok = false;
+			else SetMask(i, a, b);
+		}
+		else
+		{
+			char *end;
+			int reg = strtol(cmd, &end, 0);
+			if (n != 3 || *end || reg < 1 || reg > 255 || a < 0 || a > 255) ok = false;
+			else SetDAC(i, reg, a);
+		}
+	}
+	fclose(f);
+	if (!ok) printf("%s line %i: illegal setting\n", filename, lineNr);
+	return ok;
+}
+
+
+void CModule::Configure(const int roclist[NROCS])
+{
+	m_calls = 0;
+	for (int i=0; i<NROCS; i++)
+	{
+		if (!roclist[i]) continue;
+		tb.roc_I2cAddr(i);
+		m_calls++;
+		for (int reg=0; reg<256; reg++) if (m_dac[i][reg] >= 0)
+		{
+			tb.roc_SetDAC(reg, m_dac[i][reg]);
+			m_calls++;
+		}
+		for (int col=0; col<NCOLS; col++) for (int row=0; row<NROWS; row++)
+		{
+			uint8_t value = m_pix[i][col*NROWS + row];
+			if (value == 0xff) continue;
+			tb.roc_Pix(col, row, value);
+			m_calls++;
+		}
+	}
+	tb.Flush();
+}
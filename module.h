@@ -0,0 +1,43 @@
+// module.h
+//
+// Configuration of all ROCs of a module (ROC i at I2C address i).
+// DAC values and pixel trim/mask bits of up to 16 ROCs are collected on
+// the host (Set..., Load) and sent by Configure with the usual buffered
+// roc_* calls and one flush at the end, like any other sequence of void
+// RPCs. Registers that did not change since the last Configure are
+// skipped by the ROC register shadow. The ROCs have no common
+// (broadcast) I2C address, so a value for all ROCs is sent to each ROC.
+//
+// config file, one setting per line, '#' starts a comment:
+//   <roc|*> <dac> <value>               DAC register
+//   <roc|*> trim <col> <row> <trim>     pixel enabled with trim bits
+//   <roc|*> mask <col> <row>            pixel masked
+// (* = all ROCs)
+
+#pragma once
+
+#include <stdint.h>
+
+
+class CModule
+{
+public:
+	enum { NROCS = 16, NCOLS = 52, NROWS = 80 };
+private:
+	int16_t m_dac[NROCS][256];          // -1 = not set
+	uint8_t m_pix[NROCS][NCOLS*NROWS];  // roc_Pix value, 0xFF = not set
+	unsigned long m_calls;
+public:
+	CModule() { Clear(); }
+	void Clear();
+
+	// roc < 0: all ROCs
+	void SetDAC(int roc, uint8_t reg, uint8_t value);
+	void SetTrim(int roc, unsigned int col, unsigned int row, uint8_t trim);
+	void SetMask(int roc, unsigned int col, unsigned int row);
+	bool Load(const char *filename);
+
+	// sends the configuration to the ROCs with roclist[roc] != 0
+	void Configure(const int roclist[NROCS]);
+	unsigned long Calls() { return m_calls; } // roc_* calls of the last Configure
+};
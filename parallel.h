@@ -0,0 +1,38 @@
+// parallel.h
+//
+// ParallelFor(n, f) splits the index range [0, n) into contiguous
+// blocks and calls f(begin, end) for each block on its own thread
+// (default: one thread per core). f must only write to data of its
+// own block.
+
+#pragma once
+
+#include <thread>
+#include <vector>
+
+
+inline unsigned int ParallelThreads()
+{
+	unsigned int n = std::thread::hardware_concurrency();
+	return n ? n : 1;
+}
+
+
+template <class F>
+void ParallelFor(unsigned int n, F f, unsigned int nthreads = 0)
+{
+	if (nthreads == 0) nthreads = ParallelThreads();
+	if (nthreads > n) nthreads = n;
+	if (nthreads <= 1) { if (n) f(0u, n); return; }
+
+	std::vector<std::thread> t;
+	unsigned int begin = 0;
+	for (unsigned int i = 0; i < nthreads - 1; i++)
+	{
+		unsigned int end = begin + (n - begin)/(nthreads - i);
+		t.push_back(std::thread(f, begin, end));
+		begin = end;
+	}
+	f(begin, n); // last block in the calling thread
+	for (unsigned int i = 0; i < t.size(); i++) t[i].join();
+}
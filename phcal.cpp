@@ -0,0 +1,202 @@
+// phcal.cpp
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "phcal.h"
+#include "parallel.h"
+
+#define PHCAL_MAGIC "PHCAL001"
+
+
+void CPhCalibration::Init(int x0, unsigned int nx, unsigned int step)
+{
+	m_x0 = x0;
+	m_nx = nx;
+	m_step = step ? step : 1;
+	m_ph.assign(nx*NPIXEL, -1.0f);
+}
+
+
+// least squares ph = a + b*u, returns the sum of squared residuals
+static double LinearFit(const std::vector<double> &u, const std::vector<double> &y,
+	double &a, double &b)
+{
+	unsigned int i, n = u.size();
+	double su = 0.0, sy = 0.0, suu = 0.0, suy = 0.0;
+	for (i = 0; i < n; i++)
+	{
+		su += u[i]; sy += y[i]; suu += u[i]*u[i]; suy += u[i]*y[i];
+	}
+	double det = n*suu - su*su;
+	if (det <= 0.0) { a = sy/n; b = 0.0; }
+	else
+	{
+		b = (n*suy - su*sy)/det;
+		a = (sy - b*su)/n;
+	}
+	double chi2 = 0.0;
+	for (i = 0; i < n; i++) { double d = y[i] - a - b*u[i]; chi2 += d*d; }
+	return chi2;
+}
+
+
+// TANH model for a fixed width w
+static double TanhFit(const std::vector<double> &x, const std::vector<double> &y,
+	double w, std::vector<double> &u, double &a, double &b)
+{
+	u.resize(x.size());
+	for (unsigned int i = 0; i < x.size(); i++) u[i] = tanh(x[i]/w);
+	return LinearFit(u, y, a, b);
+}
+
+
+void CPhCalibration::Fit(const float *ph, unsigned int nx, unsigned int step, float x0,
+	Model model, unsigned int p0, unsigned int p1,
+	float *ped, float *gain, float *width)
+{
+	std::vector<double> x, y, u;
+	x.reserve(nx); y.reserve(nx); u.reserve(nx);
+
+	for (unsigned int p = p0; p < p1; p++)
+	{
+		ped[p] = gain[p] = width[p] = 0.0f;
+
+		x.clear(); y.clear();
+		for (unsigned int i = 0; i < nx; i++)
+		{
+			float v = ph[i*NPIXEL + p];
+			if (v < 0.0f || v >= 255.0f) continue; // no hit or saturated
+			x.push_back(x0 + double(i*step));
+			y.push_back(v);
+		}
+		if (x.size() < 3) continue;
+
+		double a, b;
+		if (model == LINEAR)
+		{
+			LinearFit(x, y, a, b);
+			if (b <= 0.0) continue;
+			ped[p] = float(a);
+			gain[p] = float(b);
+			continue;
+		}
+
+		// golden section search of log(width) in [log 10, log 10000]
+		const double g = 0.5*(sqrt(5.0) - 1.0);
+		double l0 = log(10.0), l1 = log(10000.0);
+		double la = l1 - g*(l1 - l0), lb = l0 + g*(l1 - l0);
+		double ca = TanhFit(x, y, exp(la), u, a, b);
+		double cb = TanhFit(x, y, exp(lb), u, a, b);
+		for (int k = 0; k < 30; k++)
+		{
+			if (ca < cb)
+			{
+				l1 = lb; lb = la; cb = ca;
+				la = l1 - g*(l1 - l0);
+				ca = TanhFit(x, y, exp(la), u, a, b);
+			}
+			else
+			{
+				l0 = la; la = lb; ca = cb;
+				lb = l0 + g*(l1 - l0);
+				cb = TanhFit(x, y, exp(lb), u, a, b);
+			}
+		}
+		double w = exp(0.5*(l0 + l1));
+		TanhFit(x, y, w, u, a, b);
+		if (b <= 0.0) continue;
+		ped[p] = float(a);
+		gain[p] = float(b/w);
+		width[p] = float(w);
+	}
+}
+
+
+void CPhCalibration::Fit(Model model, unsigned int nthreads)
+{
+	m_model = model;
+	const float *ph = m_ph.empty() ? 0 : &m_ph[0];
+	unsigned int nx = m_nx, step = m_step;
+	float x0 = float(m_x0);
+	float *ped = &m_ped[0], *gain = &m_gain[0], *width = &m_width[0];
+	ParallelFor(NPIXEL, [=](unsigned int p0, unsigned int p1)
+		{ Fit(ph, nx, step, x0, model, p0, p1, ped, gain, width); }, nthreads);
+	MakeLut();
+}
+
+
+float CPhCalibration::Ph(unsigned int col, unsigned int row, float vcal)
+{
+	unsigned int p = col*80 + row;
+	if (m_width[p] > 0.0f) return m_ped[p] + m_gain[p]*m_width[p]*tanhf(vcal/m_width[p]);
+	return m_ped[p] + m_gain[p]*vcal;
+}
+
+
+void CPhCalibration::MakeLut()
+{
+	m_lut.assign(NPIXEL*256, 0);
+	for (unsigned int p = 0; p < NPIXEL; p++)
+	{
+		if (m_gain[p] <= 0.0f) continue;
+		uint8_t *lut = &m_lut[p*256];
+		for (int ph = 0; ph < 256; ph++)
+		{
+			double d = ph - m_ped[p], v;
+			if (m_width[p] > 0.0f)
+			{
+				double u = d/(m_gain[p]*m_width[p]);
+				if (u >= 1.0) { lut[ph] = 255; continue; }
+				v = (u <= -1.0) ? 0.0 : m_width[p]*atanh(u);
+			}
+			else v = d/m_gain[p];
+			lut[ph] = (v <= 0.0) ? 0 : (v >= 255.0) ? 255 : uint8_t(v + 0.5);
+		}
+	}
+}
+
+
+bool CPhCalibration::Save(const char *filename, const char *chipId)
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f) return false;
+	char id[IDSIZE];
+	memset(id, 0, IDSIZE);
+	if (chipId) strncpy(id, chipId, IDSIZE-1);
+	uint8_t header[4] = { uint8_t(m_model), 0, 0, 0 };
+	fwrite(PHCAL_MAGIC, 1, 8, f);
+	fwrite(id, 1, IDSIZE, f);
+	fwrite(header, 1, 4, f);
+	fwrite(&m_ped[0],   sizeof(float), NPIXEL, f);
+	fwrite(&m_gain[0],  sizeof(float), NPIXEL, f);
+	fwrite(&m_width[0], sizeof(float), NPIXEL, f);
+	return fclose(f) == 0;
+}
+
+
+bool CPhCalibration::Load(const char *filename, const char *chipId)
+{
+	FILE *f = fopen(filename, "rb");
+	if (!f) return false;
+	char magic[8], id[IDSIZE];
+	uint8_t header[4];
+	std::vector<float> ped(NPIXEL), gain(NPIXEL), width(NPIXEL);
+	bool ok = fread(magic, 1, 8, f) == 8
+		&& memcmp(magic, PHCAL_MAGIC, 8) == 0
+		&& fread(id, 1, IDSIZE, f) == IDSIZE
+		&& fread(header, 1, 4, f) == 4
+		&& fread(&ped[0],   sizeof(float), NPIXEL, f) == NPIXEL
+		&& fread(&gain[0],  sizeof(float), NPIXEL, f) == NPIXEL
+		&& fread(&width[0], sizeof(float), NPIXEL, f) == NPIXEL;
+	fclose(f);
+	id[IDSIZE-1] = 0;
+	if (!ok || (chipId && strncmp(id, chipId, IDSIZE-1) != 0)) return false;
+
+	m_model = (header[0] == LINEAR) ? LINEAR : TANH;
+	m_ped.swap(ped);
+	m_gain.swap(gain);
+	m_width.swap(width);
+	MakeLut();
+	return true;
+}
@@ -0,0 +1,77 @@
+// phcal.h
+//
+// Pulse height calibration (PH versus Vcal) of all pixels of a ROC.
+//
+// The mean pulse height of each Vcal step is stored as dense array
+// [x][pixel] with pixel = col*ROC_NUMROWS + row (as CSCurves). Steps
+// without hits and saturated steps (PH 255) are not used by the fit.
+//
+// Fit models per pixel:
+//   LINEAR  ph = ped + gain*vcal
+//   TANH    ph = ped + gain*width*tanh(vcal/width)
+// gain is the slope at Vcal 0 (PH per Vcal) for both models, width = 0
+// for LINEAR. For a fixed width the TANH model is linear in ped and
+// gain, so it is solved in closed form inside a 1D search of width.
+// The pixels are fitted in parallel. A pixel with less than 3 points
+// gets gain 0 (not calibrated).
+//
+// MakeLut builds a table [pixel][ph] -> Vcal (0..255) for the
+// conversion of readout data with a single lookup. Not calibrated
+// pixels give 0, PH values above the tanh plateau give 255.
+//
+// binary calibration file (Save):
+//   "PHCAL001", chip id (40 chars, 0 padded), model, 0, 0, 0,
+//   float pedestal[NPIXEL], gain[NPIXEL], width[NPIXEL]
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+
+class CPhCalibration
+{
+public:
+	enum Model { LINEAR, TANH };
+	enum { NPIXEL = 52*80, IDSIZE = 40 };
+private:
+	int m_x0;
+	unsigned int m_nx, m_step;
+	std::vector<float> m_ph; // -1 = no data
+	Model m_model;
+	std::vector<float> m_ped, m_gain, m_width;
+	std::vector<uint8_t> m_lut;
+	static void Fit(const float *ph, unsigned int nx, unsigned int step, float x0,
+		Model model, unsigned int p0, unsigned int p1,
+		float *ped, float *gain, float *width);
+public:
+	CPhCalibration() : m_x0(0), m_nx(0), m_step(1), m_model(TANH),
+		m_ped(NPIXEL, 0.0f), m_gain(NPIXEL, 0.0f), m_width(NPIXEL, 0.0f),
+		m_lut(NPIXEL*256, 0) {}
+	void Init(int x0, unsigned int nx, unsigned int step);
+	int X0() { return m_x0; }
+	unsigned int Steps() { return m_nx; }
+	unsigned int StepSize() { return m_step; }
+
+	void SetPh(unsigned int i, unsigned int col, unsigned int row,
+		unsigned int hits, unsigned int phSum)
+	{ m_ph[i*NPIXEL + col*80 + row] = hits ? float(phSum)/hits : -1.0f; }
+	float GetPh(unsigned int i, unsigned int col, unsigned int row)
+	{ return m_ph[i*NPIXEL + col*80 + row]; }
+
+	void Fit(Model model, unsigned int nthreads = 0);
+	Model GetModel() { return m_model; }
+	bool IsCalibrated(unsigned int col, unsigned int row) { return m_gain[col*80 + row] > 0.0f; }
+	float Pedestal(unsigned int col, unsigned int row) { return m_ped[col*80 + row]; }
+	float Gain(unsigned int col, unsigned int row) { return m_gain[col*80 + row]; }
+	float Width(unsigned int col, unsigned int row) { return m_width[col*80 + row]; }
+	float Ph(unsigned int col, unsigned int row, float vcal); // model
+
+	void MakeLut();
+	unsigned char ToVcal(unsigned int col, unsigned int row, unsigned int ph)
+	{ return m_lut[(col*80 + row)*256 + (ph & 0xff)]; }
+
+	bool Save(const char *filename, const char *chipId);
+	// false if the file is not readable or is for another chip (chipId != 0)
+	bool Load(const char *filename, const char *chipId = 0);
+};
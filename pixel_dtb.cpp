@@ -104,6 +104,8 @@ bool CTestboard::FindDTB(string &usbId)
 bool CTestboard::Open(string &usbId, bool init)
 {
 	rpc_Clear();
+	shadow.Reset();
+	{ RPC_THREAD_CLEAR } // new link: no reply pending
 	if (!usb.Open(&(usbId[0]))) return false;
 
 	if (init) Init();
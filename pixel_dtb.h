@@ -22,6 +22,18 @@
 #endif
 
 #include "usb.h"
+#include "rocshadow.h"
+
+// A roc_* call checks the shadow and sends the write as one step, so
+// with several threads the shadow sees the writes in send order.
+// Lock order: shadow, then RPC send.
+#ifdef ENABLE_MULTITHREADING
+#define SHADOW_THREAD std::mutex shadow_mutex;
+#define SHADOW_LOCK std::lock_guard<std::mutex> shadow_lock(shadow_mutex);
+#else
+#define SHADOW_THREAD
+#define SHADOW_LOCK
+#endif
 
 // size of ROC pixel array
 #define ROC_NUMROWS  80  // # rows
@@ -73,8 +85,12 @@ class CTestboard
 #endif
 	CUSB usb;
 
+	CRocShadow shadow;
+	SHADOW_THREAD
+
 public:
 	CRpcIo& GetIo() { return *rpc_io; }
+	void SetIo(CRpcIo &io) { SHADOW_LOCK rpc_Connect(io); shadow.Reset(); } // e.g. loopback or simulation
 
 	CTestboard() { RPC_INIT rpc_io = &usb; }
 	~CTestboard() { RPC_EXIT }
@@ -110,8 +126,8 @@ public:
 	const char * ConnectionError()
 	{ return usb.GetErrorMsg(usb.GetLastError()); }
 
-	void Flush() { rpc_io->Flush(); }
-	void Clear() { rpc_io->Clear(); }
+	void Flush() { RPC_THREAD_LOCK rpc_io->Flush(); }
+	void Clear() { RPC_THREAD_CLEAR rpc_io->Clear(); }
 
 
 	// === DTB identification ================================================
@@ -136,7 +152,8 @@ public:
 
 	// === DTB functions ====================================================
 
-	RPC_EXPORT void Init();
+	RPC_EXPORT void rpc_Init();
+	void Init() { SHADOW_LOCK shadow.Reset(); rpc_Init(); }
 
 	RPC_EXPORT void Welcome();
 	RPC_EXPORT void SetLed(uint8_t x);
@@ -207,8 +224,10 @@ public:
 
 
 	// --- ROC/Module power VD/VA -------------------------------------------
-	RPC_EXPORT void Pon();	// switch ROC power on
-	RPC_EXPORT void Poff();	// switch ROC power off
+	RPC_EXPORT void rpc_Pon();
+	RPC_EXPORT void rpc_Poff();
+	void Pon()  { SHADOW_LOCK shadow.Invalidate(); rpc_Pon();  } // switch ROC power on
+	void Poff() { SHADOW_LOCK shadow.Invalidate(); rpc_Poff(); } // switch ROC power off
 
 	RPC_EXPORT void _SetVD(uint16_t mV);
 	RPC_EXPORT void _SetVA(uint16_t mV);
@@ -232,10 +251,13 @@ public:
 
 	RPC_EXPORT void HVon();
 	RPC_EXPORT void HVoff();
-	RPC_EXPORT void ResetOn();
-	RPC_EXPORT void ResetOff();
+	RPC_EXPORT void rpc_ResetOn();
+	RPC_EXPORT void rpc_ResetOff();
+	void ResetOn()  { SHADOW_LOCK shadow.Invalidate(); rpc_ResetOn(); }
+	void ResetOff() { SHADOW_LOCK shadow.Invalidate(); rpc_ResetOff(); }
 	RPC_EXPORT uint8_t GetStatus();
-	RPC_EXPORT void SetRocAddress(uint8_t addr);
+	RPC_EXPORT void rpc_SetRocAddress(uint8_t addr);
+	void SetRocAddress(uint8_t addr) { SHADOW_LOCK shadow.Invalidate(); rpc_SetRocAddress(addr); }
 
 
 	// --- pulse pattern generator ------------------------------------------
@@ -276,40 +298,68 @@ public:
 
 
 	// --- ROC/module Communication -----------------------------------------
+	// The roc_* functions go through the register shadow (rocshadow.h) and
+	// skip writes that do not change the ROC state. rpc_roc_* always send.
+
 	// -- set the i2c address for the following commands
-	RPC_EXPORT void roc_I2cAddr(uint8_t id);
+	RPC_EXPORT void rpc_roc_I2cAddr(uint8_t id);
+	void roc_I2cAddr(uint8_t id)
+	{ SHADOW_LOCK if (shadow.I2cAddr(id)) rpc_roc_I2cAddr(id); }
 
 	// -- sends "ClrCal" command to ROC
-	RPC_EXPORT void roc_ClrCal();
+	RPC_EXPORT void rpc_roc_ClrCal();
+	void roc_ClrCal()
+	{ SHADOW_LOCK if (shadow.ClrCal()) rpc_roc_ClrCal(); }
 
 	// -- sets a single (DAC) register
-	RPC_EXPORT void roc_SetDAC(uint8_t reg, uint8_t value);
+	RPC_EXPORT void rpc_roc_SetDAC(uint8_t reg, uint8_t value);
+	void roc_SetDAC(uint8_t reg, uint8_t value)
+	{ SHADOW_LOCK if (shadow.SetDAC(reg, value)) rpc_roc_SetDAC(reg, value); }
 
 	// -- set pixel bits (count <= 60)
 	//    M - - - 8 4 2 1
-	RPC_EXPORT void roc_Pix(uint8_t col, uint8_t row, uint8_t value);
+	RPC_EXPORT void rpc_roc_Pix(uint8_t col, uint8_t row, uint8_t value);
+	void roc_Pix(uint8_t col, uint8_t row, uint8_t value)
+	{ SHADOW_LOCK if (shadow.Pix(col, row, value)) rpc_roc_Pix(col, row, value); }
 
 	// -- trimm a single pixel (count < =60)
-	RPC_EXPORT void roc_Pix_Trim(uint8_t col, uint8_t row, uint8_t value);
+	RPC_EXPORT void rpc_roc_Pix_Trim(uint8_t col, uint8_t row, uint8_t value);
+	void roc_Pix_Trim(uint8_t col, uint8_t row, uint8_t value)
+	{ SHADOW_LOCK if (shadow.Pix_Trim(col, row, value)) rpc_roc_Pix_Trim(col, row, value); }
 
 	// -- mask a single pixel (count <= 60)
-	RPC_EXPORT void roc_Pix_Mask(uint8_t col, uint8_t row);
+	RPC_EXPORT void rpc_roc_Pix_Mask(uint8_t col, uint8_t row);
+	void roc_Pix_Mask(uint8_t col, uint8_t row)
+	{ SHADOW_LOCK if (shadow.Pix_Mask(col, row)) rpc_roc_Pix_Mask(col, row); }
 
 	// -- set calibrate at specific column and row
-	RPC_EXPORT void roc_Pix_Cal(uint8_t col, uint8_t row, bool sensor_cal = false);
+	RPC_EXPORT void rpc_roc_Pix_Cal(uint8_t col, uint8_t row, bool sensor_cal);
+	void roc_Pix_Cal(uint8_t col, uint8_t row, bool sensor_cal = false)
+	{ SHADOW_LOCK if (shadow.Pix_Cal(col, row, sensor_cal)) rpc_roc_Pix_Cal(col, row, sensor_cal); }
 
 	// -- enable/disable a double column
-	RPC_EXPORT void roc_Col_Enable(uint8_t col, bool on);
+	RPC_EXPORT void rpc_roc_Col_Enable(uint8_t col, bool on);
+	void roc_Col_Enable(uint8_t col, bool on)
+	{ SHADOW_LOCK if (shadow.Col_Enable(col, on)) rpc_roc_Col_Enable(col, on); }
 
 	// -- mask all pixels of a column and the coresponding double column
-	RPC_EXPORT void roc_Col_Mask(uint8_t col);
+	RPC_EXPORT void rpc_roc_Col_Mask(uint8_t col);
+	void roc_Col_Mask(uint8_t col)
+	{ SHADOW_LOCK if (shadow.Col_Mask(col)) rpc_roc_Col_Mask(col); }
 
 	// -- mask all pixels and columns of the chip
-	RPC_EXPORT void roc_Chip_Mask();
+	RPC_EXPORT void rpc_roc_Chip_Mask();
+	void roc_Chip_Mask()
+	{ SHADOW_LOCK if (shadow.Chip_Mask()) rpc_roc_Chip_Mask(); }
+
+	// -- register shadow control and statistics (command thread only)
+	CRocShadow& Shadow() { return shadow; }
 
 
 // --- Wafer test functions
-	RPC_EXPORT bool testColPixel(uint8_t col, uint8_t trimbit, vectorR<uint8_t> &res);
+	RPC_EXPORT bool rpc_testColPixel(uint8_t col, uint8_t trimbit, vectorR<uint8_t> &res);
+	bool testColPixel(uint8_t col, uint8_t trimbit, vectorR<uint8_t> &res)
+	{ SHADOW_LOCK shadow.ColPixelTest(col); return rpc_testColPixel(col, trimbit, res); }
 
 	// Ethernet test functions
 	RPC_EXPORT void Ethernet_Send(string &message);
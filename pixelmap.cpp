@@ -4,12 +4,28 @@
 #include "pixelmap.h"
 #include "chipdatabase.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PIXELMAP_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define POPCOUNT32(x) __popcnt(x)
+#define POPCOUNT64(x) ((unsigned int)__popcnt64(x))
+#else
+#define POPCOUNT32(x) __builtin_popcount(x)
+#define POPCOUNT64(x) __builtin_popcountll(x)
+#endif
+
 
 void CPixelMap::Init()
 {
 	int col, row;
 	mapExist = pulseHeightExist = levelExist = false;
 	pulseHeight1Exist = pulseHeight2Exist = false;
+	scurveExist = trimExist = false;
+	planesValid = false;
 	for (col=0; col<ROCNUMCOLS; col++) for (row=0; row<ROCNUMROWS; row++)
 	{
 		map[col][row] = 0; // dead pixel
@@ -21,6 +37,9 @@ void CPixelMap::Init()
 		level[col][row][1] = 0;
 		level[col][row][2] = 0;
 		level[col][row][3] = 0;
+		threshold[col][row] = -1.0;
+		noise[col][row] = 0.0;
+		trim[col][row] = 15;
 	}
 }
 
@@ -30,6 +49,7 @@ void CPixelMap::SetMaskedCount(unsigned int x, unsigned int y, unsigned int coun
 	if (IsInRange(x,y))
 	{
 		map[x][y] = (map[x][y] & ~0x00f0) | ((count<<4) & 0x00f0);
+		planesValid = false;
 	}
 }
 
@@ -39,6 +59,7 @@ void CPixelMap::SetUnmaskedCount(unsigned int x, unsigned int y, unsigned int co
 	if (IsInRange(x,y))
 	{
 		map[x][y] = (map[x][y] & ~0x000f) | (count & 0x000f);
+		planesValid = false;
 	}
 }
 
@@ -51,6 +72,7 @@ void CPixelMap::SetDefectTrimBit(unsigned int x, unsigned int y,
 		unsigned int mask = 0x0100 << bit;
 		if (defect) map[x][y] |= mask;
 		else        map[x][y] &= ~mask;
+		planesValid = false;
 	}
 }
 
@@ -61,6 +83,7 @@ void CPixelMap::SetDefectColCode(unsigned int x, unsigned int y, bool defect)
 	{
 		if (defect) map[x][y] |=  0x1000;
 		else        map[x][y] &= ~0x1000;
+		planesValid = false;
 	}
 }
 
@@ -71,6 +94,7 @@ void CPixelMap::SetDefectRowCode(unsigned int x, unsigned int y, bool defect)
 	{
 		if (defect) map[x][y] |=  0x2000;
 		else        map[x][y] &= ~0x2000;
+		planesValid = false;
 	}
 }
 
@@ -110,6 +134,27 @@ void CPixelMap::SetLevel(unsigned int x, unsigned int y,
 }
 
 
+void CPixelMap::SetThreshold(unsigned int x, unsigned int y, float thr, float sigma)
+{
+	if (IsInRange(x,y))
+	{
+		threshold[x][y] = thr;
+		noise[x][y] = sigma;
+		scurveExist = true;
+	}
+}
+
+
+void CPixelMap::SetTrim(unsigned int x, unsigned int y, unsigned char value)
+{
+	if (IsInRange(x,y) && value < 16)
+	{
+		trim[x][y] = value;
+		trimExist = true;
+	}
+}
+
+
 
 unsigned int CPixelMap::GetMaskedCount(unsigned int x, unsigned int y)
 {
@@ -222,14 +267,226 @@ bool CPixelMap::IsDefect(unsigned int x, unsigned int y)
 }
 
 
-unsigned int CPixelMap::DefectPixelCount()
+// --- bulk statistics ---------------------------------------------------
+
+#ifdef PIXELMAP_SSE2
+
+// 16 bit masks of the planes of 16 pixels
+static inline void PlaneMasks(const unsigned int *v, unsigned int m[CPixelMap::NPLANES])
 {
-	int col, row;
+	const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi32(1);
+	const __m128i m0f = _mm_set1_epi32(0x000f), mf0 = _mm_set1_epi32(0x00f0);
+	const __m128i mf00 = _mm_set1_epi32(0x0f00), m3000 = _mm_set1_epi32(0x3000);
+	__m128i c[CPixelMap::NPLANES][4];
+	for (int i=0; i<4; i++)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(v + 4*i));
+		__m128i cnt = _mm_and_si128(x, m0f);
+		c[CPixelMap::PL_DEFECT][i]     = _mm_cmpeq_epi32(x, one);
+		c[CPixelMap::PL_UNMASKABLE][i] = _mm_cmpeq_epi32(_mm_and_si128(x, mf0), zero);
+		c[CPixelMap::PL_NOSIGNAL][i]   = _mm_cmpeq_epi32(cnt, zero);
+		c[CPixelMap::PL_NOISY][i]      = _mm_cmpgt_epi32(cnt, one);
+		c[CPixelMap::PL_ADDR][i]       = _mm_cmpeq_epi32(_mm_and_si128(x, m3000), zero);
+		c[CPixelMap::PL_TRIM][i]       = _mm_cmpeq_epi32(_mm_and_si128(x, mf00), zero);
+	}
+	for (int p=0; p<CPixelMap::NPLANES; p++)
+	{
+		unsigned int b = _mm_movemask_epi8(_mm_packs_epi16(
+			_mm_packs_epi32(c[p][0], c[p][1]), _mm_packs_epi32(c[p][2], c[p][3])));
+		m[p] = (p == CPixelMap::PL_NOSIGNAL || p == CPixelMap::PL_NOISY) ? b : ~b & 0xffff;
+	}
+}
+
+#else
+
+static inline void PlaneMasks(const unsigned int *v, unsigned int m[CPixelMap::NPLANES])
+{
+	for (int p=0; p<CPixelMap::NPLANES; p++) m[p] = 0;
+	for (int i=0; i<16; i++)
+	{
+		unsigned int x = v[i], cnt = x & 0x000f;
+		if (x != 1)        m[CPixelMap::PL_DEFECT]     |= 1 << i;
+		if (x & 0x00f0)    m[CPixelMap::PL_UNMASKABLE] |= 1 << i;
+		if (cnt == 0)      m[CPixelMap::PL_NOSIGNAL]   |= 1 << i;
+		if (cnt > 1)       m[CPixelMap::PL_NOISY]      |= 1 << i;
+		if (x & 0x3000)    m[CPixelMap::PL_ADDR]       |= 1 << i;
+		if (x & 0x0f00)    m[CPixelMap::PL_TRIM]       |= 1 << i;
+	}
+}
+
+#endif
+
+
+void CPixelMap::BuildPlanes()
+{
+	unsigned int m[NPLANES];
+	for (int col=0; col<ROCNUMCOLS; col++)
+	{
+		for (int p=0; p<NPLANES; p++) plane[p][col][0] = plane[p][col][1] = 0;
+		for (int g=0; g<ROCNUMROWS/16; g++)
+		{
+			PlaneMasks(&map[col][16*g], m);
+			for (int p=0; p<NPLANES; p++)
+				plane[p][col][g/4] |= uint64_t(m[p]) << (16*(g%4));
+		}
+	}
+	planesValid = true;
+}
+
+
+unsigned int CPixelMap::Count(unsigned int p)
+{
+	if (!planesValid) BuildPlanes();
 	unsigned int cnt = 0;
+	for (int col=0; col<ROCNUMCOLS; col++)
+		cnt += POPCOUNT64(plane[p][col][0]) + POPCOUNT64(plane[p][col][1]);
+	return cnt;
+}
+
+
+unsigned int CPixelMap::Count(unsigned int p, unsigned int col)
+{
+	if (col >= ROCNUMCOLS) return 0;
+	if (!planesValid) BuildPlanes();
+	return POPCOUNT64(plane[p][col][0]) + POPCOUNT64(plane[p][col][1]);
+}
+
+
+void CPixelMap::GetRefLevelStats(CRefLevelStats &s)
+{
+	int col, row;
+	s.n = s.sum = s.sum2 = 0;
+	s.min = 100;
+	s.max = 0;
+#ifdef PIXELMAP_SSE2
+	const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi32(1);
+	const __m128i l99 = _mm_set1_epi8(99);
+	__m128i sumLow = zero, sum2 = zero, mn = _mm_set1_epi8(-1), mx = zero;
+	for (col=0; col<ROCNUMCOLS; col++)
+	{
+		int n = 0;
+		__m128i sum = zero;
+		s.nCol[col] = s.sumCol[col] = 0;
+		for (row=0; row<ROCNUMROWS; row += 16)
+		{
+			const __m128i *v = (const __m128i*)&map[col][row];
+			__m128i good = _mm_packs_epi16(
+				_mm_packs_epi32(_mm_cmpeq_epi32(_mm_loadu_si128(v),   one), _mm_cmpeq_epi32(_mm_loadu_si128(v+1), one)),
+				_mm_packs_epi32(_mm_cmpeq_epi32(_mm_loadu_si128(v+2), one), _mm_cmpeq_epi32(_mm_loadu_si128(v+3), one)));
+			__m128i y = _mm_loadu_si128((const __m128i*)&refLevel[col][row]);
+			s.nCol[col] += POPCOUNT32(_mm_movemask_epi8(good));
+			sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_and_si128(y, good), zero));
+
+			__m128i sel = _mm_and_si128(good, _mm_cmpeq_epi8(_mm_min_epu8(y, l99), y)); // y < 100
+			__m128i ys = _mm_and_si128(y, sel);
+			n += POPCOUNT32(_mm_movemask_epi8(sel));
+			sumLow = _mm_add_epi64(sumLow, _mm_sad_epu8(ys, zero));
+			__m128i lo = _mm_unpacklo_epi8(ys, zero), hi = _mm_unpackhi_epi8(ys, zero);
+			sum2 = _mm_add_epi32(sum2, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+			mn = _mm_min_epu8(mn, _mm_or_si128(ys, _mm_andnot_si128(sel, _mm_set1_epi8(-1))));
+			mx = _mm_max_epu8(mx, ys);
+		}
+		s.sumCol[col] = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+		s.n += n;
+	}
+	int t[4];
+	unsigned char b[2][16];
+	s.sum = _mm_cvtsi128_si32(sumLow) + _mm_cvtsi128_si32(_mm_srli_si128(sumLow, 8));
+	_mm_storeu_si128((__m128i*)t, sum2);
+	s.sum2 = t[0] + t[1] + t[2] + t[3];
+	_mm_storeu_si128((__m128i*)b[0], mn);
+	_mm_storeu_si128((__m128i*)b[1], mx);
+	for (int i=0; i<16; i++)
+	{
+		if (b[0][i] < s.min) s.min = b[0][i];
+		if (b[1][i] > s.max) s.max = b[1][i];
+	}
+#else
+	for (col=0; col<ROCNUMCOLS; col++)
+	{
+		s.nCol[col] = s.sumCol[col] = 0;
+		for (row=0; row<ROCNUMROWS; row++)
+		{
+			if (map[col][row] != 1) continue;
+			int y = refLevel[col][row];
+			s.nCol[col]++;
+			s.sumCol[col] += y;
+			if (y < 100)
+			{
+				s.n++;
+				s.sum  += y;
+				s.sum2 += y*y;
+				if (y < s.min) s.min = y;
+				if (y > s.max) s.max = y;
+			}
+		}
+	}
+#endif
+}
+
+
+unsigned int CPixelMap::RefLevelOutside(int lo, int hi)
+{
+	const unsigned char *y = &refLevel[0][0];
+	unsigned int i = 0, cnt = 0;
+#ifdef PIXELMAP_SSE2
+	const __m128i l100 = _mm_set1_epi8(100);
+	const __m128i below = _mm_set1_epi8(char((lo > 0) ? ((lo > 256) ? 255 : lo-1) : 0));
+	const __m128i above = _mm_set1_epi8(char((hi < 255) ? ((hi < -1) ? 0 : hi+1) : 255));
+	for (; i + 16 <= ROCNUMCOLS*ROCNUMROWS; i += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(y+i));
+		__m128i c = _mm_cmpeq_epi8(x, l100);
+		if (lo > 0)   c = _mm_or_si128(c, _mm_cmpeq_epi8(_mm_min_epu8(x, below), x)); // x <= lo-1
+		if (hi < 255) c = _mm_or_si128(c, _mm_cmpeq_epi8(_mm_max_epu8(x, above), x)); // x >= hi+1
+		cnt += POPCOUNT32(_mm_movemask_epi8(c));
+	}
+#endif
+	for (; i < ROCNUMCOLS*ROCNUMROWS; i++)
+		if (y[i] == 100 || y[i] < lo || hi < y[i]) cnt++;
+	return cnt;
+}
+
+
+void CPixelMap::GetPulseHeightStats(CPulseHeightStats &s)
+{
+	const short *ph1 = &pulseHeight1[0][0], *ph2 = &pulseHeight2[0][0];
+	// int arithmetic modulo 2^32 as the former per pixel sums
+	unsigned int n = 0, sum1 = 0, sum1_2 = 0, sum21 = 0, sum21_2 = 0;
+	for (int i=0; i<ROCNUMCOLS*ROCNUMROWS; i++)
+	{
+		int a = ph1[i], b = ph2[i];
+		if (a < 10000 && b < 10000)
+		{
+			unsigned int d = b - a;
+			n++;
+			sum1    += a;
+			sum1_2  += unsigned(a)*unsigned(a);
+			sum21   += d;
+			sum21_2 += d*d;
+		}
+	}
+	s.n = n;
+	s.sum1 = sum1;
+	s.sum1_2 = sum1_2;
+	s.sum21 = sum21;
+	s.sum21_2 = sum21_2;
+}
 
-	for (col=0; col<ROCNUMCOLS; col++)	for (row=0; row<ROCNUMROWS; row++)
-		if (map[col][row] != 1) cnt++;
 
+unsigned int CPixelMap::PulseHeightOutside(double ph1lo, double ph1hi, double difflo, double diffhi)
+{
+	const short *ph1 = &pulseHeight1[0][0], *ph2 = &pulseHeight2[0][0];
+	unsigned int cnt = 0;
+	for (int i=0; i<ROCNUMCOLS*ROCNUMROWS; i++)
+	{
+		int a = ph1[i], b = ph2[i];
+		if (a < 10000 && b < 10000)
+		{
+			int d = b - a;
+			if (a < ph1lo || a > ph1hi || d < difflo || d > diffhi) cnt++;
+		}
+	}
 	return cnt;
 }
 
@@ -256,6 +513,7 @@ bool CPixelMap::ReadPixMap(CScanner &Log)
 	int row, col;
 	char *s = Log.getNextLine();
 
+	planesValid = false;
 	if (strlen(s) == 0)
 	{
 		for (col=0; col<52; col++) for (row=0; row<80; row++)
@@ -285,7 +543,8 @@ bool CPixelMap::ReadPulseHeight(CScanner &Log)
 		char *s = Log.getNextLine();
 		for (col=0; col<52; col++)
 		{
-			if (sscanf(s, "%i", &value) != 1) return false;
+			char *p = s;
+			if (!ScanInt(&p, value)) return false;
 			pulseHeight[col][row] = short(value);
 			s+=5;
 		}
@@ -305,8 +564,9 @@ bool CPixelMap::ReadPulseHeight1(CScanner &Log)
 		char *s = Log.getNextLine();
 		for (col=0; col<52; col++)
 		{
+			char *p = s;
 			if (s[1] == '.') pulseHeight1[col][row] = 10000;
-			else if (sscanf(s, "%i", &value) != 1) return false;
+			else if (!ScanInt(&p, value)) return false;
 			else pulseHeight1[col][row] = short(value);
 			s+=5;
 		}
@@ -326,8 +586,9 @@ bool CPixelMap::ReadPulseHeight2(CScanner &Log)
 		char *s = Log.getNextLine();
 		for (col=0; col<52; col++)
 		{
+			char *p = s;
 			if (s[1] == '.') pulseHeight2[col][row] = 10000;
-			else if (sscanf(s, "%i", &value) != 1) return false;
+			else if (!ScanInt(&p, value)) return false;
 			else pulseHeight2[col][row] = short(value);
 			s+=5;
 		}
@@ -386,6 +647,26 @@ bool CPixelMap::ReadLevel(CScanner &Log, unsigned int trimbit)
 	return true;
 }
 
+
+bool CPixelMap::ReadTrim(CScanner &Log)
+{
+	int col, row, value;
+	for (row=79; row>=0; row--)
+	{
+		char *s = Log.getNextLine();
+		for (col=0; col<52; col++)
+		{
+			char *p = s;
+			if (!ScanInt(&p, value) || value < 0 || value > 15) return false;
+			trim[col][row] = (unsigned char)value;
+			s+=3;
+		}
+	}
+
+	trimExist = true;
+	return true;
+}
+
 /*
 void CPixelMap::Histo(CHistogram &h)
 {
@@ -518,3 +799,58 @@ void CPixelMap::PrintLevel(unsigned int trimbit, CProtocol &prot)
 }
 
 
+
+
+void CPixelMap::PrintThreshold(CProtocol &prot)
+{
+	if (!scurveExist) return;
+
+	int col, row;
+
+	prot.section("THR");
+	for (row=ROCNUMROWS-1; row>=0; row--)
+	{
+		for (col=0; col<ROCNUMCOLS; col++)
+		{
+			float thr = GetThreshold(col,row);
+			if (thr < 0.0) prot.puts("    OR");
+			else prot.printf(" %5.1f", thr);
+		}
+		prot.puts("\n");
+	}
+}
+
+
+void CPixelMap::PrintNoise(CProtocol &prot)
+{
+	if (!scurveExist) return;
+
+	int col, row;
+
+	prot.section("NOISE");
+	for (row=ROCNUMROWS-1; row>=0; row--)
+	{
+		for (col=0; col<ROCNUMCOLS; col++)
+		{
+			if (GetThreshold(col,row) < 0.0) prot.puts("  ....");
+			else prot.printf(" %5.2f", GetNoise(col,row));
+		}
+		prot.puts("\n");
+	}
+}
+
+
+void CPixelMap::PrintTrim(CProtocol &prot)
+{
+	if (!trimExist) return;
+
+	int col, row;
+
+	prot.section("TRIMBITS");
+	for (row=ROCNUMROWS-1; row>=0; row--)
+	{
+		for (col=0; col<ROCNUMCOLS; col++)
+			prot.printf("%3u", (unsigned int)GetTrim(col,row));
+		prot.puts("\n");
+	}
+}
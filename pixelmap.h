@@ -4,6 +4,7 @@
 #define PIXELMAP_H
 
 // #include "grlog.h"
+#include <stdint.h>
 #include "scanner.h"
 
 #include "protocol.h"
@@ -28,14 +29,49 @@ struct CParser;
 #define ROCNUMCOLS  52
  
 
+// reference levels (PUC1) of the pixels that are not defect
+struct CRefLevelStats
+{
+	int n, sum, sum2, min, max;   // levels < 100 (min = 100, max = 0 if n = 0)
+	int nCol[ROCNUMCOLS];         // per column, all levels
+	int sumCol[ROCNUMCOLS];
+};
+
+
+// pixels with pulse heights PH1 and PH2 < 10000
+struct CPulseHeightStats
+{
+	int n;
+	int sum1, sum1_2;   // PH1
+	int sum21, sum21_2; // PH2 - PH1
+};
+
+
+/*
+  defect bitplanes (built from map on demand):
+  one bit per pixel and defect class, bit row%64 of word [col][row/64]
+*/
+
 class CPixelMap
 {
 public:
+	enum
+	{
+		PL_DEFECT,     // map value != 1
+		PL_UNMASKABLE, // masked readout count > 0
+		PL_NOSIGNAL,   // unmasked readout count 0
+		PL_NOISY,      // unmasked readout count > 1
+		PL_ADDR,       // wrong column or pixel address code
+		PL_TRIM,       // trim bit defect
+		NPLANES
+	};
 	bool mapExist;
 	bool pulseHeightExist;
 	bool pulseHeight1Exist;
 	bool pulseHeight2Exist;
 	bool levelExist;
+	bool scurveExist;
+	bool trimExist;
 private:
 	unsigned int map[ROCNUMCOLS][ROCNUMROWS];
 	short pulseHeight[ROCNUMCOLS][ROCNUMROWS];
@@ -43,6 +79,13 @@ private:
 	short pulseHeight2[ROCNUMCOLS][ROCNUMROWS];
 	unsigned char refLevel[ROCNUMCOLS][ROCNUMROWS];
 	unsigned char level[ROCNUMCOLS][ROCNUMROWS][4];
+	float threshold[ROCNUMCOLS][ROCNUMROWS]; // S-curve fit
+	float noise[ROCNUMCOLS][ROCNUMROWS];
+	unsigned char trim[ROCNUMCOLS][ROCNUMROWS]; // trim bits (0..15)
+
+	uint64_t plane[NPLANES][ROCNUMCOLS][2];
+	bool planesValid; // false after each change of map
+	void BuildPlanes();
 
 	bool IsInRange(unsigned int x, unsigned int y)
 	{ return x<ROCNUMCOLS && y<ROCNUMROWS; }
@@ -68,6 +111,9 @@ public:
 	void SetLevel(unsigned int x, unsigned int y,
 		unsigned char bit, unsigned char value);
 
+	void SetThreshold(unsigned int x, unsigned int y, float thr, float sigma);
+	void SetTrim(unsigned int x, unsigned int y, unsigned char value);
+
 	// data get methods
 	unsigned int GetMaskedCount(unsigned int x, unsigned int y);
 	unsigned int GetUnmaskedCount(unsigned int x, unsigned int y);
@@ -87,10 +133,23 @@ public:
 	unsigned char GetLevel(unsigned int x, unsigned int y, unsigned int bit)
 	{ return level[x][y][bit]; }
 
+	float GetThreshold(unsigned int x, unsigned int y) { return threshold[x][y]; }
+	float GetNoise(unsigned int x, unsigned int y) { return noise[x][y]; }
+	unsigned char GetTrim(unsigned int x, unsigned int y) { return trim[x][y]; }
+
 	void UpdateTrimDefects();
 
 	bool IsDefect(unsigned int x, unsigned int y);
-	unsigned int DefectPixelCount();
+	unsigned int DefectPixelCount() { return Count(PL_DEFECT); }
+
+	// bulk statistics
+	const uint64_t (*Plane(unsigned int p))[2] { if (!planesValid) BuildPlanes(); return plane[p]; }
+	unsigned int Count(unsigned int p);                   // pixels in plane p
+	unsigned int Count(unsigned int p, unsigned int col); // in column col
+	void GetRefLevelStats(CRefLevelStats &s);
+	unsigned int RefLevelOutside(int lo, int hi); // level 100, < lo or > hi (all pixels)
+	void GetPulseHeightStats(CPulseHeightStats &s);
+	unsigned int PulseHeightOutside(double ph1lo, double ph1hi, double difflo, double diffhi);
 
 	bool ReadPixMap(CScanner &Log);
 	bool ReadPulseHeight(CScanner &Log);
@@ -99,6 +158,7 @@ public:
 
 	bool ReadRefLevel(CScanner &Log);
 	bool ReadLevel(CScanner &Log, unsigned int trimbit);
+	bool ReadTrim(CScanner &Log);
 
 //	void Histo(CHistogram &h);
 //	void HistoDiff(unsigned int trimbit, CHistogram &h);
@@ -109,6 +169,11 @@ public:
 	void PrintPulseHeight2(CProtocol &prot);
 	void PrintRefLevel(CProtocol &prot);
 	void PrintLevel(unsigned int trimbit, CProtocol &prot);
+	void PrintThreshold(CProtocol &prot);
+	void PrintNoise(CProtocol &prot);
+	void PrintTrim(CProtocol &prot);
+
+	friend class CResultStore;
 };
 
 #endif
@@ -68,3 +68,294 @@ void Watchpoint::Report(const char *filename)
 
 #endif
 
+
+
+#ifndef _WIN32
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include "profiler.h"
+
+
+// time histogram: 4 buckets per octave (< 19% resolution)
+#define PROFILER_BUCKETS 256
+
+static inline unsigned int ProfilerBucket(long long dt)
+{
+	if (dt < 4) return dt < 0 ? 0 : (unsigned int)dt;
+	int e = 63 - __builtin_clzll(dt);
+	return 4*e + ((dt >> (e-2)) & 3) - 4;
+}
+
+static inline long long ProfilerBucketValue(unsigned int b)
+{
+	if (b < 4) return b;
+	int e = b/4 + 1;
+	long long low = (long long)(4 + b%4) << (e-2);
+	return low + ((1LL << (e-2)) >> 1);
+}
+
+
+struct ProfilerNode
+{
+	const Watchpoint *wp;
+	const char *name;
+	unsigned int parent;
+	std::vector<unsigned int> children;
+	unsigned long long n;
+	long long t, tMin, tMax; // ns
+	unsigned int hist[PROFILER_BUCKETS];
+
+	ProfilerNode(const Watchpoint *w, const char *fname, unsigned int up)
+		: wp(w), name(fname), parent(up), n(0), t(0), tMin(0), tMax(0)
+	{ memset(hist, 0, sizeof(hist)); }
+
+	void Add(long long dt)
+	{
+		if (n == 0 || dt < tMin) tMin = dt;
+		if (dt > tMax) tMax = dt;
+		n++; t += dt;
+		hist[ProfilerBucket(dt)]++;
+	}
+
+	void Merge(const ProfilerNode &x)
+	{
+		if (x.n == 0) return;
+		if (n == 0 || x.tMin < tMin) tMin = x.tMin;
+		if (x.tMax > tMax) tMax = x.tMax;
+		n += x.n; t += x.t;
+		for (unsigned int i=0; i<PROFILER_BUCKETS; i++) hist[i] += x.hist[i];
+	}
+
+	long long Percentile(double p) const
+	{
+		unsigned long long limit = (unsigned long long)(p*n);
+		unsigned long long sum = 0;
+		for (unsigned int i=0; i<PROFILER_BUCKETS; i++)
+		{
+			sum += hist[i];
+			if (sum > limit)
+			{
+				long long v = ProfilerBucketValue(i);
+				return v < tMin ? tMin : (v > tMax ? tMax : v);
+			}
+		}
+		return tMax;
+	}
+};
+
+
+class ProfilerTree
+{
+public:
+	std::vector<ProfilerNode> node; // node[0] = root
+	unsigned int current;
+
+	ProfilerTree() : current(0) { node.push_back(ProfilerNode(0, "", 0)); }
+
+	unsigned int Child(unsigned int up, const Watchpoint *wp, const char *name)
+	{
+		const std::vector<unsigned int> &c = node[up].children;
+		for (unsigned int i=0; i<c.size(); i++)
+			if (node[c[i]].wp == wp) return c[i];
+		unsigned int k = node.size();
+		node.push_back(ProfilerNode(wp, name, up));
+		node[up].children.push_back(k);
+		return k;
+	}
+
+	void Merge(unsigned int dst, const ProfilerTree &src, unsigned int s)
+	{
+		const std::vector<unsigned int> &c = src.node[s].children;
+		for (unsigned int i=0; i<c.size(); i++)
+		{
+			const ProfilerNode &x = src.node[c[i]];
+			unsigned int k = Child(dst, x.wp, x.name);
+			node[k].Merge(x);
+			Merge(k, src, c[i]);
+		}
+	}
+
+	long long Exclusive(unsigned int k) const
+	{
+		long long t = node[k].t;
+		for (unsigned int i=0; i<node[k].children.size(); i++)
+			t -= node[node[k].children[i]].t;
+		return t;
+	}
+};
+
+
+// all thread trees (never freed, they are reported at program exit)
+static std::mutex profiler_lock;
+static std::vector<ProfilerTree*> *profiler_threads = 0;
+static thread_local ProfilerTree *profiler_tree = 0;
+
+
+static ProfilerTree& GetProfilerTree()
+{
+	if (!profiler_tree)
+	{
+		profiler_tree = new ProfilerTree;
+		std::lock_guard<std::mutex> lock(profiler_lock);
+		if (!profiler_threads) profiler_threads = new std::vector<ProfilerTree*>;
+		profiler_threads->push_back(profiler_tree);
+	}
+	return *profiler_tree;
+}
+
+
+static inline long long ProfilerTime()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+
+AutoCounter::AutoCounter(Watchpoint &handle)
+{
+	ProfilerTree &tree = GetProfilerTree();
+	m_node = tree.Child(tree.current, &handle, handle.Name());
+	tree.current = m_node;
+	m_start = ProfilerTime();
+}
+
+
+AutoCounter::~AutoCounter()
+{
+	long long dt = ProfilerTime() - m_start;
+	ProfilerTree &tree = *profiler_tree;
+	ProfilerNode &x = tree.node[m_node];
+	x.Add(dt);
+	tree.current = x.parent;
+}
+
+
+// === report ===============================================================
+
+class ProfilerReport
+{
+	ProfilerTree tree;
+	std::vector<unsigned int> order; // depth first, children by name
+	std::vector<unsigned int> depth;
+	std::vector<std::string> path;
+
+	struct ByName
+	{
+		const ProfilerTree &t;
+		ByName(const ProfilerTree &tree) : t(tree) {}
+		bool operator()(unsigned int a, unsigned int b) const
+		{ return strcmp(t.node[a].name, t.node[b].name) < 0; }
+	};
+
+	void Walk(unsigned int k, unsigned int d, const std::string &p);
+	void WriteText(const char *filename);
+	void WriteCsv(const char *filename);
+public:
+	~ProfilerReport();
+};
+
+
+void ProfilerReport::Walk(unsigned int k, unsigned int d, const std::string &p)
+{
+	std::vector<unsigned int> c(tree.node[k].children);
+	std::sort(c.begin(), c.end(), ByName(tree));
+	for (unsigned int i=0; i<c.size(); i++)
+	{
+		std::string name = p.empty() ? tree.node[c[i]].name : p + '/' + tree.node[c[i]].name;
+		order.push_back(c[i]);
+		depth.push_back(d);
+		path.push_back(name);
+		Walk(c[i], d+1, name);
+	}
+}
+
+
+void ProfilerReport::WriteText(const char *filename)
+{
+	FILE *f = fopen(filename, "wt");
+	if (!f) return;
+
+	unsigned int i, width = 9;
+	for (i=0; i<order.size(); i++)
+	{
+		unsigned int w = 2*depth[i] + strlen(tree.node[order[i]].name);
+		if (w > width) width = w;
+	}
+	if (width > 200) width = 200;
+
+	fprintf(f, "--- call tree (inclusive/exclusive time in s, call times in us) ---\n");
+	fprintf(f, "%-*s %10s %11s %11s %10s %10s %10s %10s %10s %10s\n", width, "call path",
+		"calls", "incl", "excl", "min", "mean", "p50", "p90", "p99", "max");
+	for (i=0; i<order.size(); i++)
+	{
+		const ProfilerNode &x = tree.node[order[i]];
+		fprintf(f, "%*s%-*s %10llu %11.3f %11.3f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+			2*depth[i], "", width - 2*depth[i], x.name, x.n,
+			x.t*1e-9, tree.Exclusive(order[i])*1e-9,
+			x.tMin*1e-3, x.n ? double(x.t)/x.n*1e-3 : 0.0,
+			x.Percentile(0.5)*1e-3, x.Percentile(0.9)*1e-3, x.Percentile(0.99)*1e-3,
+			x.tMax*1e-3);
+	}
+
+	// flat profile: sum over all call paths of a function
+	ProfilerTree flat;
+	std::vector<long long> excl;
+	for (i=0; i<order.size(); i++)
+	{
+		const ProfilerNode &x = tree.node[order[i]];
+		unsigned int k = flat.Child(0, x.wp, x.name);
+		flat.node[k].Merge(x);
+		if (excl.size() <= k) excl.resize(k+1, 0);
+		excl[k] += tree.Exclusive(order[i]);
+	}
+	std::vector<unsigned int> c(flat.node[0].children);
+	std::sort(c.begin(), c.end(), ByName(flat));
+	fprintf(f, "\n--- functions (sum over all call paths, time in s) ---\n");
+	fprintf(f, "%-*s %10s %11s %11s\n", width, "function", "calls", "incl", "excl");
+	for (i=0; i<c.size(); i++)
+	{
+		const ProfilerNode &x = flat.node[c[i]];
+		fprintf(f, "%-*s %10llu %11.3f %11.3f\n", width, x.name, x.n, x.t*1e-9, excl[c[i]]*1e-9);
+	}
+	fclose(f);
+}
+
+
+void ProfilerReport::WriteCsv(const char *filename)
+{
+	FILE *f = fopen(filename, "wt");
+	if (!f) return;
+	fprintf(f, "path,calls,incl_ns,excl_ns,min_ns,p50_ns,p90_ns,p99_ns,max_ns\n");
+	for (unsigned int i=0; i<order.size(); i++)
+	{
+		const ProfilerNode &x = tree.node[order[i]];
+		fprintf(f, "%s,%llu,%lld,%lld,%lld,%lld,%lld,%lld,%lld\n",
+			path[i].c_str(), x.n, x.t, tree.Exclusive(order[i]), x.tMin,
+			x.Percentile(0.5), x.Percentile(0.9), x.Percentile(0.99), x.tMax);
+	}
+	fclose(f);
+}
+
+
+ProfilerReport::~ProfilerReport()
+{
+	std::lock_guard<std::mutex> lock(profiler_lock);
+	if (!profiler_threads) return;
+	for (unsigned int i=0; i<profiler_threads->size(); i++)
+		tree.Merge(0, *(*profiler_threads)[i], 0);
+	Walk(0, 0, "");
+	WriteText("profiler_report.txt");
+	WriteCsv("profiler_report.csv");
+}
+
+
+static ProfilerReport profiler_report;
+
+#endif
@@ -48,4 +48,30 @@ public:
 	~AutoCounter() { Stop(); }
 };
 
+#else // Linux
+
+// Every thread accumulates its own call tree (no locking on the hot path).
+// A node is a call path (f1/f2/f3); it counts calls, inclusive time,
+// min/max and a logarithmic time histogram for the percentiles. At
+// program exit the trees of all threads are merged and written to
+// profiler_report.txt (text) and profiler_report.csv (one line per path).
+
+class Watchpoint
+{
+	const char *name;
+public:
+	Watchpoint(const char *fname) : name(fname) {}
+	const char* Name() const { return name; }
+};
+
+
+class AutoCounter
+{
+	unsigned int m_node;
+	long long m_start;
+public:
+	AutoCounter(Watchpoint &handle);
+	~AutoCounter();
+};
+
 #endif
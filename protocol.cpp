@@ -14,7 +14,14 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 #include <time.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 #include "protocol.h"
 #include "psi46test.h"
 
@@ -24,9 +31,11 @@ bool CProtocol::open(const char filename[])
 	f = fopen(filename, "wt");
 	if (f != NULL)
 	{
+		m_error = 0;
+		if (m_async) startWriter();
 		timestamp("OPEN");
 		section("VERSION", false);
-		fputs(VERSIONINFO "\n", f);
+		puts(VERSIONINFO "\n");
 		return true;
 	}
 	return false;
@@ -38,21 +47,37 @@ bool CProtocol::append(const char filename[])
 	f = fopen(filename, "at");
 	if (f != NULL)
 	{
+		m_error = 0;
+		if (m_async) startWriter();
 		timestamp("OPEN");
 		section("VERSION", false);
-		fputs(VERSIONINFO "\n", f);
+		puts(VERSIONINFO "\n");
 		return true;
 	}
 	return false;
 }
 
 
-void CProtocol::close()
+bool CProtocol::close()
 {
-	if (f == NULL) return;
+	if (f == NULL) return true;
 	timestamp("CLOSE");
-	fclose(f);
+	if (m_async) stopWriter();
+	if (fclose(f) != 0) setError(errno);
 	f = NULL;
+	return m_error == 0;
+}
+
+
+void CProtocol::setAsync(bool on)
+{
+	if (on == m_async) return;
+	if (f != NULL)
+	{
+		if (on) startWriter();
+		else stopWriter();
+	}
+	m_async = on;
 }
 
 
@@ -63,35 +88,35 @@ void CProtocol::timestamp(const char s[])
 	struct tm *dt;
 	time(&t);
 	dt = localtime(&t);
-	fprintf(f, "[%s] %s", s, asctime(dt));
+	printf("[%s] %s", s, asctime(dt));
 }
 
 
 void CProtocol::section(const char s[], bool crlf)
 {
 	if (f == NULL) return;
-	if (crlf) fprintf(f, "[%s]\n", s);
-	else      fprintf(f, "[%s] ",   s);
+	if (crlf) printf("[%s]\n", s);
+	else      printf("[%s] ",   s);
 }
 
 
 void CProtocol::section(const char s[], const char par[])
 {
 	if (f == NULL) return;
-	fprintf(f, "[%s] %s\n", s, par);
+	printf("[%s] %s\n", s, par);
 }
 
 
 void CProtocol::puts(const char s[])
 {
 	if (f == NULL) return;
-	fputs(s, f);
+	write(s, strlen(s));
 }
 
 void CProtocol::puts(const std::string s)
 {
 	if (f == NULL) return;
-	fputs(s.c_str(), f);
+	write(s.data(), s.size());
 }
 
 
@@ -99,14 +124,133 @@ void CProtocol::printf(const char *fmt, ...)
 {
 	va_list ap;
 	if (f == NULL) return;
+	if (!m_async)
+	{
+		va_start(ap,fmt);
+		if (vfprintf(f, fmt, ap) < 0) setError(errno);
+		va_end(ap);
+		return;
+	}
+
+	char s[512];
+	va_start(ap,fmt);
+	int n = vsnprintf(s, sizeof(s), fmt, ap);
+	va_end(ap);
+	if (n < 0) return;
+	if (n < int(sizeof(s))) { write(s, n); return; }
+
+	std::string l(n+1, '\0'); // long line
 	va_start(ap,fmt);
-	vfprintf(f, fmt, ap);
+	vsnprintf(&l[0], n+1, fmt, ap);
 	va_end(ap);
+	write(l.data(), n);
 }
 
 
 void CProtocol::flush()
 {
 	if (f == NULL) return;
-	fflush(f);
+	if (m_async) post(false);
+	else if (fflush(f) != 0) setError(errno);
+}
+
+
+bool CProtocol::sync()
+{
+	if (f == NULL) return true;
+	if (m_async) post(true);
+	else if (fflush(f) != 0) setError(errno);
+	return error() == 0;
+}
+
+
+int CProtocol::error()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_error;
+}
+
+
+// keeps the first error
+void CProtocol::setError(int err)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_error == 0) m_error = err ? err : EIO;
+}
+
+
+// --- asynchronous mode ---------------------------------------------
+
+void CProtocol::write(const char *s, size_t n)
+{
+	if (!m_async) { if (fwrite(s, 1, n, f) != n) setError(errno); return; }
+	m_buffer.append(s, n);
+	if (m_buffer.size() >= CHUNKSIZE) post(false);
+}
+
+
+void CProtocol::post(bool sync)
+{
+	if (m_buffer.empty() && !sync) return;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(Chunk());
+		m_queue.back().text.swap(m_buffer);
+		m_queue.back().sync = sync;
+		if (!m_free.empty()) { m_buffer.swap(m_free.back()); m_free.pop_back(); }
+	}
+	m_ready.notify_one();
+	if (m_buffer.capacity() < CHUNKSIZE) m_buffer.reserve(2*CHUNKSIZE);
+}
+
+
+void CProtocol::startWriter()
+{
+	m_stop = false;
+	m_buffer.reserve(2*CHUNKSIZE);
+	m_writer = std::thread(&CProtocol::writerLoop, this);
+}
+
+
+void CProtocol::stopWriter()
+{
+	post(true);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_ready.notify_one();
+	m_writer.join();
+	m_free.clear();
+}
+
+
+void CProtocol::writerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		while (m_queue.empty() && !m_stop) m_ready.wait(lock);
+		if (m_queue.empty()) break;
+		Chunk c;
+		c.text.swap(m_queue.front().text);
+		c.sync = m_queue.front().sync;
+		m_queue.pop_front();
+		lock.unlock();
+
+		if (fwrite(c.text.data(), 1, c.text.size(), f) != c.text.size()) setError(errno);
+		if (c.sync)
+		{
+			if (fflush(f) != 0) setError(errno);
+#ifdef _WIN32
+			else if (_commit(_fileno(f)) != 0) setError(errno);
+#else
+			else if (fsync(fileno(f)) != 0) setError(errno);
+#endif
+		}
+		c.text.clear();
+
+		lock.lock();
+		if (m_free.size() < 4) { m_free.push_back(std::string()); m_free.back().swap(c.text); }
+	}
 }
@@ -17,17 +17,62 @@
 
 #include <stdio.h>
 #include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 
+// Asynchronous mode (setAsync): the text is collected in a buffer of
+// the logging thread without locking and handed to a writer thread in
+// chunks, so a test never waits for the disk. flush() only hands over
+// the collected text, sync() (end of a chip) also makes the writer
+// flush the file to the disk. The file content is the same in both
+// modes. Only one thread may write to the log.
+//
+// The first failed write or flush is recorded (error()). sync() and
+// close() return false once an error occurred; in asynchronous mode an
+// error of the text handed over by sync() shows at a later sync() or
+// at close().
+
 class CProtocol
 {
 	FILE *f;
+
+	enum { CHUNKSIZE = 65536 };
+	struct Chunk
+	{
+		std::string text;
+		bool sync;
+	};
+
+	bool m_async;
+	std::string m_buffer; // text of the logging thread
+
+	// writer thread
+	std::thread m_writer;
+	std::mutex m_mutex;
+	std::condition_variable m_ready;
+	std::deque<Chunk> m_queue;
+	std::vector<std::string> m_free; // written chunks for reuse
+	bool m_stop;
+	int m_error; // errno of the first failed write or flush, 0 = ok
+
+	void write(const char *s, size_t n);
+	void post(bool sync);
+	void startWriter();
+	void stopWriter();
+	void writerLoop();
+	void setError(int err);
 public:
-	CProtocol() { f = NULL; }
+	CProtocol() : f(NULL), m_async(false), m_stop(false), m_error(0) {}
 	~CProtocol() { close(); }
+	void setAsync(bool on);
+	bool isAsync() { return m_async; }
 	bool open(const char filename[]);
 	bool append(const char filename[]);
-	void close();
+	bool close();
 	void timestamp(const char s[]);
 	void section(const char s[], bool crlf = true);
 	void section(const char s[], const char par[]);
@@ -35,7 +80,9 @@ public:
 	void puts(const std::string s);
 	void printf(const char *fmt, ...);
 	void flush();
-	FILE* File() { return f; }
+	bool sync();
+	int error();
+	FILE* File() { return f; } // direct writes only in synchronous mode
 };
 
 
@@ -12,6 +12,7 @@
  * -------------------------------------------------------------
  */
 
+#include <string.h>
 #include <string>
 #include <vector>
 #include "psi46test.h"
@@ -128,5 +129,6 @@ int main(int argc, char* argv[])
 		e.What();
 	}
 
+	if (!Log.close()) printf("log: error writing file: %s\n", strerror(Log.error()));
 	return 0;
 }
@@ -0,0 +1,599 @@
+// resultstore.cpp
+
+#include <string.h>
+#include <map>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#include "resultstore.h"
+#include "parallel.h"
+
+
+// === columns ===========================================================
+
+#define COL_INT(name, f) { name, CResultStore::INT32, 4, \
+	[](CChip &c, void *v) { int32_t x = int32_t(c.f); memcpy(v, &x, 4); }, \
+	[](CChip &c, const void *v) { int32_t x; memcpy(&x, v, 4); c.f = decltype(c.f)(x); } }
+
+#define COL_DBL(name, f) { name, CResultStore::FLOAT64, 8, \
+	[](CChip &c, void *v) { double x = c.f; memcpy(v, &x, 8); }, \
+	[](CChip &c, const void *v) { memcpy(&c.f, v, 8); } }
+
+#define COL_STR(name, f) { name, CResultStore::CHARS, sizeof(((CChip*)0)->f), \
+	[](CChip &c, void *v) { memset(v, 0, sizeof(c.f)); memcpy(v, c.f, strnlen(c.f, sizeof(c.f))); }, \
+	[](CChip &c, const void *v) { memcpy(c.f, v, sizeof(c.f)); c.f[sizeof(c.f)-1] = 0; } }
+
+// exist, n, mean, stdev, min, max (32 bytes)
+#define COL_LEVEL(name, f) { name, CResultStore::RAW, 32, \
+	[](CChip &c, void *v) { GetLevel(c.f, (char*)v); }, \
+	[](CChip &c, const void *v) { SetLevel(c.f, (const char*)v); } }
+
+static void GetLevel(CAnalogLevel &l, char *v)
+{
+	memset(v, 0, 32);
+	if (!l.exist) return;
+	int32_t i[4] = { 1, l.n, l.min, l.max };
+	memcpy(v, i, 8);
+	memcpy(v+8, &l.mean, 8);
+	memcpy(v+16, &l.stdev, 8);
+	memcpy(v+24, i+2, 8);
+}
+
+static void SetLevel(CAnalogLevel &l, const char *v)
+{
+	int32_t i[4];
+	memcpy(i, v, 8);
+	memcpy(i+2, v+24, 8);
+	l.Init();
+	if (!i[0]) return;
+	l.exist = true;
+	l.n = i[1];
+	memcpy(&l.mean, v+8, 8);
+	memcpy(&l.stdev, v+16, 8);
+	l.min = i[2];
+	l.max = i[3];
+}
+
+// valid, result of the 26 double columns (108 bytes)
+static void GetDcol(CChip &c, void *v)
+{
+	int32_t x[27] = { 0 };
+	if (c.dcol.IsValid())
+	{
+		x[0] = 1;
+		for (int i=0; i<26; i++) x[i+1] = c.dcol.get(i);
+	}
+	memcpy(v, x, sizeof(x));
+}
+
+static void SetDcol(CChip &c, const void *v)
+{
+	int32_t x[27];
+	memcpy(x, v, sizeof(x));
+	c.dcol.SetValid(x[0] != 0);
+	for (int i=0; i<26; i++) c.dcol.set(i, x[i+1]);
+}
+
+
+const CResultStore::Column CResultStore::columns[] =
+{
+	COL_INT("nEntry",       nEntry),
+	COL_STR("productId",    productId),
+	COL_STR("waferId",      waferId),
+	COL_STR("waferNr",      waferNr),
+	COL_INT("mapX",         mapX),
+	COL_INT("mapY",         mapY),
+	COL_INT("mapPos",       mapPos),
+	COL_STR("chipId",       chipId),
+	COL_STR("startTime",    startTime),
+	COL_STR("endTime",      endTime),
+	COL_INT("frequency",    frequency),
+	COL_DBL("IdigOn",       IdigOn),
+	COL_DBL("IanaOn",       IanaOn),
+	COL_DBL("IdigInit",     IdigInit),
+	COL_DBL("IanaInit",     IanaInit),
+	COL_INT("probecard",    probecard.isValid),
+	COL_DBL("vd_cap",       probecard.vd_cap),
+	COL_DBL("vd_reg",       probecard.vd_reg),
+	COL_DBL("v_dac",        probecard.v_dac),
+	COL_DBL("v_tout",       probecard.v_tout),
+	COL_DBL("v_aout",       probecard.v_aout),
+	COL_DBL("Iana0",        Iana[0]),
+	COL_DBL("Iana1",        Iana[1]),
+	COL_DBL("Iana2",        Iana[2]),
+	COL_DBL("Iana3",        Iana[3]),
+	COL_DBL("Iana4",        Iana[4]),
+	COL_INT("InitVana",     InitVana),
+	COL_DBL("InitIana",     InitIana),
+	COL_INT("InitCalDel",   InitCalDel),
+	COL_LEVEL("ublack",     ublack),
+	COL_LEVEL("black",      black),
+	COL_LEVEL("l0",         l[0]),
+	COL_LEVEL("l1",         l[1]),
+	COL_LEVEL("l2",         l[2]),
+	COL_LEVEL("l3",         l[3]),
+	COL_LEVEL("l4",         l[4]),
+	COL_LEVEL("l5",         l[5]),
+	COL_INT("token",        token),
+	COL_INT("i2c",          i2c),
+	COL_INT("bin",          bin),
+	COL_INT("pixtest2",     pixtest2),
+	{ "dcol", CResultStore::RAW, 108, GetDcol, SetDcol },
+	COL_INT("trimVcal",     trimVcal),
+	COL_INT("trimVthrComp", trimVthrComp),
+	COL_INT("trimVtrim",    trimVtrim),
+	COL_INT("logChipClass", logChipClass),
+	// evaluation
+	COL_INT("chipClass",    chipClass),
+	COL_INT("pickClass",    pickClass),
+	COL_INT("failCode",     failCode),
+	COL_INT("picX",         picX),
+	COL_INT("picY",         picY),
+	COL_DBL("addressStep",  addressStep),
+	COL_INT("n",            n),
+	COL_DBL("pm",           pm),
+	COL_DBL("pm_col_max",   pm_col_max),
+	COL_DBL("pstd",         pstd),
+	COL_INT("pmin",         pmin),
+	COL_INT("pmax",         pmax),
+	COL_INT("nPh",          nPh),
+	COL_DBL("ph1mean",      ph1mean),
+	COL_DBL("ph21mean",     ph21mean),
+	COL_DBL("ph1std",       ph1std),
+	COL_DBL("ph21std",      ph21std),
+	COL_INT("nPhFail",      nPhFail),
+	COL_INT("nPixDefect",   nPixDefect),
+	COL_INT("nPixNoSignal", nPixNoSignal),
+	COL_INT("nPixNoisy",    nPixNoisy),
+	COL_INT("nPixUnmaskable", nPixUnmaskable),
+	COL_INT("nPixAddrDefect", nPixAddrDefect),
+	COL_INT("nPixNoTrim",   nPixNoTrim),
+	COL_INT("nColDefect",   nColDefect),
+	COL_INT("nPixThrOr",    nPixThrOr)
+};
+
+const unsigned int CResultStore::ncolumns = sizeof(columns)/sizeof(columns[0]);
+
+#define MAXCOLSIZE 128
+#define IDXSIZE     16
+
+
+const CResultStore::Column* CResultStore::Find(const char *name)
+{
+	for (unsigned int i=0; i<ncolumns; i++)
+		if (strcmp(columns[i].name, name) == 0) return &columns[i];
+	return NULL;
+}
+
+
+// === store files =======================================================
+
+static long long FileSize(const std::string &name)
+{
+#ifdef _WIN32
+	struct _stati64 st;
+	if (_stati64(name.c_str(), &st) != 0) return -1;
+#else
+	struct stat st;
+	if (stat(name.c_str(), &st) != 0) return -1;
+#endif
+	return st.st_size;
+}
+
+
+static void MakeDir(const char *name)
+{
+#ifdef _WIN32
+	_mkdir(name);
+#else
+	mkdir(name, 0777);
+#endif
+}
+
+
+std::string CResultStore::Path(const char *name, const char *ext)
+{
+	return m_dir + "/" + name + ext;
+}
+
+
+bool CResultStore::Open(const char *dir, bool write)
+{
+	Close();
+	m_dir = dir;
+	if (write) MakeDir(dir);
+
+	// a chip is complete if it is in all files
+	long long size = FileSize(Path("pixmap.idx"));
+	if (size < 0 && !write) { m_dir.clear(); return false; }
+	if (size < 0) size = 0;
+	long long rows = size/IDXSIZE;
+	bool complete = size%IDXSIZE == 0;
+	unsigned int i;
+	for (i=0; i<ncolumns; i++)
+	{
+		size = FileSize(Path(columns[i].name, ".col"));
+		if (size < 0) { if (rows) complete = false; continue; }
+		if (size != rows*columns[i].size) complete = false;
+		if (size/columns[i].size < rows) rows = size/columns[i].size;
+	}
+	m_rows = (unsigned int)rows;
+	if (!write) return true;
+
+	// append only to a consistent store
+	long long datSize = FileSize(Path("pixmap.dat"));
+	m_datSize = (datSize > 0) ? datSize : 0;
+	if (!complete) { Close(); return false; }
+	m_dat = fopen(Path("pixmap.dat").c_str(), "ab");
+	m_idx = fopen(Path("pixmap.idx").c_str(), "ab");
+	m_col.resize(ncolumns);
+	bool ok = m_dat && m_idx;
+	for (i=0; i<ncolumns; i++)
+		if ((m_col[i] = fopen(Path(columns[i].name, ".col").c_str(), "ab")) == NULL) ok = false;
+	m_write = true;
+	if (!ok) Close();
+	return ok;
+}
+
+
+void CResultStore::Close()
+{
+	for (unsigned int i=0; i<m_col.size(); i++) if (m_col[i]) fclose(m_col[i]);
+	m_col.clear();
+	if (m_dat) fclose(m_dat);
+	if (m_idx) fclose(m_idx);
+	m_dat = m_idx = NULL;
+	m_datSize = 0;
+	m_write = false;
+	m_rows = 0;
+	m_dir.clear();
+}
+
+
+bool CResultStore::Append(CChip &chip)
+{
+	if (!m_write) return false;
+
+	std::shared_ptr<CPixelMap> map = chip.pixmap.Get();
+	std::vector<uint8_t> block;
+	EncodeMap(*map, block);
+	uint32_t size = block.size();
+	uint32_t flags = (map->mapExist ? 0x01 : 0)
+		| (map->pulseHeightExist  ? 0x02 : 0)
+		| (map->pulseHeight1Exist ? 0x04 : 0)
+		| (map->pulseHeight2Exist ? 0x08 : 0)
+		| (map->levelExist  ? 0x10 : 0)
+		| (map->scurveExist ? 0x20 : 0)
+		| (map->trimExist   ? 0x40 : 0);
+	char idx[IDXSIZE];
+	memcpy(idx, &m_datSize, 8);
+	memcpy(idx+8, &size, 4);
+	memcpy(idx+12, &flags, 4);
+	bool ok = fwrite(&block[0], 1, size, m_dat) == size
+		&& fwrite(idx, IDXSIZE, 1, m_idx) == 1;
+
+	char value[MAXCOLSIZE];
+	for (unsigned int i=0; i<ncolumns; i++)
+	{
+		columns[i].get(chip, value);
+		if (fwrite(value, columns[i].size, 1, m_col[i]) != 1) ok = false;
+	}
+
+	if (fflush(m_dat) || fflush(m_idx)) ok = false;
+	for (unsigned int i=0; i<ncolumns; i++) if (fflush(m_col[i])) ok = false;
+
+	// the files of a failed chip are no longer consistent
+	if (!ok) { Close(); return false; }
+	m_datSize += size;
+	m_rows++;
+	return true;
+}
+
+
+// === queries ===========================================================
+
+bool CResultStore::Map(const Column *c, CFile &f)
+{
+	if (!c || !IsOpen()) return false;
+	if (!f.open(Path(c->name, ".col").c_str())) return false;
+	return f.size() >= size_t(m_rows)*c->size;
+}
+
+
+bool CResultStore::Get(const char *name, std::vector<double> &values)
+{
+	const Column *c = Find(name);
+	if (!c || (c->type != INT32 && c->type != FLOAT64)) return false;
+	CFile f;
+	if (!Map(c, f)) return false;
+	const char *p = f.data();
+	values.resize(m_rows);
+	for (unsigned int i=0; i<m_rows; i++, p += c->size)
+	{
+		if (c->type == INT32) { int32_t x; memcpy(&x, p, 4); values[i] = x; }
+		else memcpy(&values[i], p, 8);
+	}
+	return true;
+}
+
+
+bool CResultStore::Get(const char *name, std::vector<std::string> &values)
+{
+	const Column *c = Find(name);
+	if (!c || c->type != CHARS) return false;
+	CFile f;
+	if (!Map(c, f)) return false;
+	const char *p = f.data();
+	values.resize(m_rows);
+	for (unsigned int i=0; i<m_rows; i++, p += c->size)
+		values[i].assign(p, strnlen(p, c->size));
+	return true;
+}
+
+
+bool CResultStore::GetPixelMap(unsigned int row, CPixelMap &map)
+{
+	if (!IsOpen() || row >= m_rows) return false;
+	CFile idx, dat;
+	if (!idx.open(Path("pixmap.idx").c_str()) || !dat.open(Path("pixmap.dat").c_str())) return false;
+	uint64_t offset;
+	uint32_t size, flags;
+	const char *r = idx.data() + size_t(row)*IDXSIZE;
+	memcpy(&offset, r, 8);
+	memcpy(&size, r+8, 4);
+	memcpy(&flags, r+12, 4);
+	if (offset + size > dat.size()) return false;
+	const uint8_t *p = (const uint8_t*)dat.data() + offset;
+	return DecodeMap(p, p + size, flags, map);
+}
+
+
+bool CResultStore::GetChips(std::vector<CChip> &chips, bool pixmaps)
+{
+	if (!IsOpen()) return false;
+	chips.clear();
+	chips.resize(m_rows);
+	for (unsigned int k=0; k<ncolumns; k++)
+	{
+		const Column &c = columns[k];
+		CFile f;
+		if (!Map(&c, f)) continue; // column not in the store
+		const char *p = f.data();
+		for (unsigned int i=0; i<m_rows; i++, p += c.size) c.set(chips[i], p);
+	}
+	if (!pixmaps) return true;
+
+	CFile idx, dat;
+	if (!idx.open(Path("pixmap.idx").c_str()) || !dat.open(Path("pixmap.dat").c_str())) return false;
+	std::vector<char> ok(m_rows, 0);
+	ParallelFor(m_rows, [&](unsigned int i0, unsigned int i1)
+	{
+		for (unsigned int i = i0; i < i1; i++)
+		{
+			uint64_t offset;
+			uint32_t size, flags;
+			const char *r = idx.data() + size_t(i)*IDXSIZE;
+			memcpy(&offset, r, 8);
+			memcpy(&size, r+8, 4);
+			memcpy(&flags, r+12, 4);
+			if (offset + size > dat.size()) continue;
+			const uint8_t *p = (const uint8_t*)dat.data() + offset;
+			ok[i] = DecodeMap(p, p + size, flags, *chips[i].pixmap);
+		}
+	});
+	for (unsigned int i=0; i<m_rows; i++) if (!ok[i]) return false;
+	return true;
+}
+
+
+// reads only the columns it needs; of retested chips (same wafer and
+// pic position) the first test with the highest fail code counts (as
+// with CWaferDataBase::CalculateMulti)
+bool CResultStore::Statistics(FILE *f)
+{
+	std::vector<std::string> waferId;
+	std::vector<double> picX, picY, failCode, chipClass, pickClass;
+	if (!Get("waferId", waferId) || !Get("picX", picX) || !Get("picY", picY)
+		|| !Get("failCode", failCode) || !Get("chipClass", chipClass)
+		|| !Get("pickClass", pickClass)) return false;
+
+	std::map<std::string, unsigned int> chip; // key -> row
+	std::vector<std::string> wafers;
+	std::map<std::string, unsigned int> waferNr;
+	unsigned int i;
+	char key[128];
+	for (i=0; i<m_rows; i++)
+	{
+		if (waferNr.find(waferId[i]) == waferNr.end())
+		{
+			waferNr[waferId[i]] = wafers.size();
+			wafers.push_back(waferId[i]);
+		}
+		snprintf(key, sizeof(key), "%s %i %i", waferId[i].c_str(), int(picX[i]), int(picY[i]));
+		std::map<std::string, unsigned int>::iterator it = chip.find(key);
+		if (it == chip.end()) chip[key] = i;
+		else if (failCode[i] > failCode[it->second]) it->second = i;
+	}
+
+	struct Count
+	{
+		int n, good, fail[24], cl[5];
+		Count() { memset(this, 0, sizeof(*this)); }
+		void Add(int failCode, int chipClass, int pickClass)
+		{
+			n++;
+			if (0 <= failCode && failCode < 24) fail[failCode]++;
+			if (1 <= chipClass && chipClass <= 5) cl[chipClass-1]++;
+			if (pickClass == 1) good++;
+		}
+		void Print(FILE *f)
+		{
+			int i;
+			fprintf(f,"#Chips: %4i\n#fail: ", n);
+			for (i=0; i<24; i++) fprintf(f," %4i", fail[i]);
+			fputs("\n%fail: ",f);
+			for (i=0; i<24; i++) fprintf(f," %4.1f", n ? fail[i]*100.0/n : 0.0);
+			fprintf(f,"\n#Class:  ");
+			for (i=0; i<5; i++) fprintf(f," %4i", cl[i]);
+			fputs("\n%Class:  ",f);
+			for (i=0; i<5; i++) fprintf(f," %4.1f", n ? cl[i]*100.0/n : 0.0);
+			fprintf(f,"\nyield:   %4.1f%% (pick class 1)\n", n ? good*100.0/n : 0.0);
+		}
+	};
+	std::vector<Count> wafer(wafers.size());
+	Count lot;
+	for (std::map<std::string, unsigned int>::iterator it = chip.begin(); it != chip.end(); it++)
+	{
+		i = it->second;
+		wafer[waferNr[waferId[i]]].Add(int(failCode[i]), int(chipClass[i]), int(pickClass[i]));
+		lot.Add(int(failCode[i]), int(chipClass[i]), int(pickClass[i]));
+	}
+
+	for (i=0; i<wafers.size(); i++)
+	{
+		fprintf(f,"wafer:  %s\n", wafers[i].c_str());
+		wafer[i].Print(f);
+		fputs("\n", f);
+	}
+	fprintf(f,"lot:    %u wafers, %u tests\n", (unsigned int)(wafers.size()), m_rows);
+	lot.Print(f);
+	return true;
+}
+
+
+// === pixel map blocks ==================================================
+
+void CResultStore::GetTable(CPixelMap &map, unsigned int t, int32_t *x)
+{
+	unsigned int i;
+	switch (t)
+	{
+	case 0: { const unsigned int *p = &map.map[0][0]; for (i=0; i<NPIX; i++) x[i] = p[i]; } break;
+	case 1: { const short *p = &map.pulseHeight[0][0];  for (i=0; i<NPIX; i++) x[i] = p[i]; } break;
+	case 2: { const short *p = &map.pulseHeight1[0][0]; for (i=0; i<NPIX; i++) x[i] = p[i]; } break;
+	case 3: { const short *p = &map.pulseHeight2[0][0]; for (i=0; i<NPIX; i++) x[i] = p[i]; } break;
+	case 4: { const unsigned char *p = &map.refLevel[0][0]; for (i=0; i<NPIX; i++) x[i] = p[i]; } break;
+	case 5: case 6: case 7: case 8:
+		{ const unsigned char *p = &map.level[0][0][t-5]; for (i=0; i<NPIX; i++) x[i] = p[4*i]; } break;
+	case 9:  memcpy(x, &map.threshold[0][0], NPIX*4); break; // float bits
+	case 10: memcpy(x, &map.noise[0][0], NPIX*4); break;
+	case 11: { const unsigned char *p = &map.trim[0][0]; for (i=0; i<NPIX; i++) x[i] = p[i]; } break;
+	}
+}
+
+
+void CResultStore::SetTable(CPixelMap &map, unsigned int t, const int32_t *x)
+{
+	unsigned int i;
+	switch (t)
+	{
+	case 0: { unsigned int *p = &map.map[0][0]; for (i=0; i<NPIX; i++) p[i] = x[i]; map.planesValid = false; } break;
+	case 1: { short *p = &map.pulseHeight[0][0];  for (i=0; i<NPIX; i++) p[i] = x[i]; } break;
+	case 2: { short *p = &map.pulseHeight1[0][0]; for (i=0; i<NPIX; i++) p[i] = x[i]; } break;
+	case 3: { short *p = &map.pulseHeight2[0][0]; for (i=0; i<NPIX; i++) p[i] = x[i]; } break;
+	case 4: { unsigned char *p = &map.refLevel[0][0]; for (i=0; i<NPIX; i++) p[i] = x[i]; } break;
+	case 5: case 6: case 7: case 8:
+		{ unsigned char *p = &map.level[0][0][t-5]; for (i=0; i<NPIX; i++) p[4*i] = x[i]; } break;
+	case 9:  memcpy(&map.threshold[0][0], x, NPIX*4); break;
+	case 10: memcpy(&map.noise[0][0], x, NPIX*4); break;
+	case 11: { unsigned char *p = &map.trim[0][0]; for (i=0; i<NPIX; i++) p[i] = x[i]; } break;
+	}
+}
+
+
+void CResultStore::Encode(const int32_t *x, unsigned int n, std::vector<uint8_t> &out)
+{
+	int32_t prev = 0;
+	unsigned int i = 0, k;
+	while (i < n)
+	{
+		if (x[i] == prev)
+		{
+			for (k=1; i+k < n && k < 128 && x[i+k] == prev; k++);
+			out.push_back(uint8_t(k-1));
+			i += k;
+			continue;
+		}
+		uint32_t d = uint32_t(x[i]) - uint32_t(prev);
+		uint32_t z = (d << 1) ^ (0u - (d >> 31)); // zigzag
+		prev = x[i++];
+		uint8_t b = 0x80 | (z & 0x3f);
+		z >>= 6;
+		if (z) b |= 0x40;
+		out.push_back(b);
+		while (z)
+		{
+			b = z & 0x7f;
+			z >>= 7;
+			if (z) b |= 0x80;
+			out.push_back(b);
+		}
+	}
+}
+
+
+bool CResultStore::Decode(const uint8_t *&p, const uint8_t *end, int32_t *x, unsigned int n)
+{
+	int32_t prev = 0;
+	unsigned int i = 0;
+	while (i < n)
+	{
+		if (p >= end) return false;
+		uint8_t b = *p++;
+		if (b < 0x80)
+		{
+			unsigned int k = b + 1;
+			if (i + k > n) return false;
+			while (k--) x[i++] = prev;
+			continue;
+		}
+		uint32_t z = b & 0x3f;
+		if (b & 0x40)
+		{
+			unsigned int shift = 6;
+			do
+			{
+				if (p >= end || shift > 31) return false;
+				b = *p++;
+				z |= uint32_t(b & 0x7f) << shift;
+				shift += 7;
+			} while (b & 0x80);
+		}
+		prev = int32_t(uint32_t(prev) + ((z >> 1) ^ (0u - (z & 1))));
+		x[i++] = prev;
+	}
+	return true;
+}
+
+
+void CResultStore::EncodeMap(CPixelMap &map, std::vector<uint8_t> &out)
+{
+	int32_t x[NPIX];
+	out.clear();
+	for (unsigned int t=0; t<NTABLES; t++)
+	{
+		GetTable(map, t, x);
+		Encode(x, NPIX, out);
+	}
+}
+
+
+bool CResultStore::DecodeMap(const uint8_t *p, const uint8_t *end, uint32_t flags, CPixelMap &map)
+{
+	int32_t x[NPIX];
+	map.Init();
+	for (unsigned int t=0; t<NTABLES; t++)
+	{
+		if (!Decode(p, end, x, NPIX)) return false;
+		SetTable(map, t, x);
+	}
+	map.mapExist          = (flags & 0x01) != 0;
+	map.pulseHeightExist  = (flags & 0x02) != 0;
+	map.pulseHeight1Exist = (flags & 0x04) != 0;
+	map.pulseHeight2Exist = (flags & 0x08) != 0;
+	map.levelExist        = (flags & 0x10) != 0;
+	map.scurveExist       = (flags & 0x20) != 0;
+	map.trimExist         = (flags & 0x40) != 0;
+	return p == end;
+}
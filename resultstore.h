@@ -0,0 +1,86 @@
+// resultstore.h
+//
+// Column store of chip test results. A store is a directory with
+//   <column>.col  one file per scalar of CChip, one fixed size value per
+//                 chip in test order (native byte order)
+//   pixmap.dat    pixel maps, one compressed block per chip
+//   pixmap.idx    per chip: block offset (8 bytes), size and exist flags
+// Append adds one chip to all files (test_wafer/test_chip write each
+// tested chip). A query reads only the column files it needs, a pixel
+// map only its own block.
+//
+// The evaluation columns (chipClass, failCode, ...) hold the values of
+// the chip when it was appended: CChip::Calculate of the single chip,
+// without the AOUT offset correction of the wafer. The AOUT levels are
+// stored uncorrected, so a full evaluation (with pixel maps) gives the
+// same results as the evaluation of the log file.
+//
+// pixel map block: all tables in column order (col*80 + row), each
+// value as zigzag coded difference to the previous one:
+//   byte < 0x80   byte+1 differences 0
+//   byte >= 0x80  bits 0..5 of the difference, bit 6 set: 7 bit groups
+//                 follow (bit 7 set: more groups)
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "chipdatabase.h"
+
+
+class CResultStore
+{
+public:
+	enum Type { INT32, FLOAT64, CHARS, RAW };
+	struct Column
+	{
+		const char *name;
+		Type type;
+		unsigned int size; // bytes per chip
+		void (*get)(CChip &chip, void *value);
+		void (*set)(CChip &chip, const void *value);
+	};
+	static const Column columns[];
+	static const unsigned int ncolumns;
+
+private:
+	std::string m_dir;
+	bool m_write;
+	unsigned int m_rows;
+	std::vector<FILE*> m_col; // write: file of each column
+	FILE *m_dat, *m_idx;
+	uint64_t m_datSize;
+
+	std::string Path(const char *name, const char *ext = "");
+	bool Map(const Column *c, CFile &f);
+
+	enum { NTABLES = 12, NPIX = ROCNUMCOLS*ROCNUMROWS };
+	static void GetTable(CPixelMap &map, unsigned int t, int32_t *x);
+	static void SetTable(CPixelMap &map, unsigned int t, const int32_t *x);
+	static void Encode(const int32_t *x, unsigned int n, std::vector<uint8_t> &out);
+	static bool Decode(const uint8_t *&p, const uint8_t *end, int32_t *x, unsigned int n);
+	static void EncodeMap(CPixelMap &map, std::vector<uint8_t> &out);
+	static bool DecodeMap(const uint8_t *p, const uint8_t *end, uint32_t flags, CPixelMap &map);
+public:
+	CResultStore() : m_write(false), m_rows(0), m_dat(0), m_idx(0), m_datSize(0) {}
+	~CResultStore() { Close(); }
+
+	bool Open(const char *dir, bool write = false); // write: append, creates the store
+	void Close();
+	bool IsOpen() { return !m_dir.empty(); }
+	bool IsWritable() { return m_write; }
+	const char* Dir() { return m_dir.c_str(); }
+	unsigned int Rows() { return m_rows; }
+
+	bool Append(CChip &chip);
+
+	// queries
+	static const Column* Find(const char *name);
+	bool Get(const char *name, std::vector<double> &values);      // INT32, FLOAT64
+	bool Get(const char *name, std::vector<std::string> &values); // CHARS
+	bool GetPixelMap(unsigned int row, CPixelMap &map);
+	bool GetChips(std::vector<CChip> &chips, bool pixmaps = false); // all columns
+	bool Statistics(FILE *f); // chips, fail codes and classes per wafer and lot
+};
@@ -0,0 +1,192 @@
+// rocshadow.cpp
+
+#include <string.h>
+#include "pixel_dtb.h"
+
+
+void CRocShadow::Roc::Invalidate()
+{
+	for (int i=0; i<256; i++) dac[i] = -1;
+	memset(dcol, UNKNOWN, sizeof(dcol));
+	memset(pix,  UNKNOWN, sizeof(pix));
+	memset(cal,  UNKNOWN, sizeof(cal));
+	calCount = -1;
+}
+
+
+CRocShadow::CRocShadow() : m_roc(NROCS), m_addr(-1), m_enabled(true)
+{
+	Reset();
+	ResetCounters();
+}
+
+
+void CRocShadow::Enable(bool on)
+{
+	m_enabled = on;
+	Reset();
+}
+
+
+void CRocShadow::Invalidate()
+{
+	for (unsigned int i=0; i<m_roc.size(); i++) m_roc[i].Invalidate();
+}
+
+
+void CRocShadow::Reset()
+{
+	Invalidate();
+	m_addr = -1;
+}
+
+
+void CRocShadow::ResetCounters()
+{
+	for (int i=0; i<NCALLS; i++) m_calls[i] = m_skipped[i] = 0;
+}
+
+
+const char* CRocShadow::Name(Call call)
+{
+	static const char *name[NCALLS] =
+	{
+		"roc_I2cAddr", "roc_SetDAC", "roc_Pix", "roc_Pix_Trim", "roc_Pix_Mask",
+		"roc_Pix_Cal", "roc_ClrCal", "roc_Col_Enable", "roc_Col_Mask", "roc_Chip_Mask"
+	};
+	return (call < NCALLS) ? name[call] : "";
+}
+
+
+bool CRocShadow::I2cAddr(uint8_t id)
+{
+	if (!m_enabled) return Send(I2CADDR, true);
+	bool changed = m_addr != id;
+	m_addr = (id < NROCS) ? id : -1;
+	return Send(I2CADDR, changed);
+}
+
+
+bool CRocShadow::SetDAC(uint8_t reg, uint8_t value)
+{
+	Roc *roc = Current();
+	if (!roc) return Send(SETDAC, true);
+	bool changed = roc->dac[reg] != value || reg == 0xff; // readback select
+	roc->dac[reg] = value;
+	return Send(SETDAC, changed);
+}
+
+
+bool CRocShadow::Pix(uint8_t col, uint8_t row, uint8_t value)
+{
+	Roc *roc = Current();
+	if (!roc || col >= NCOLS || row >= NROWS) return Send(PIX, true);
+	value &= PIX_MASKED | 0x0f;
+	bool changed = roc->pix[col][row] != value;
+	roc->pix[col][row] = value;
+	return Send(PIX, changed);
+}
+
+
+bool CRocShadow::Pix_Trim(uint8_t col, uint8_t row, uint8_t value)
+{
+	Roc *roc = Current();
+	if (!roc || col >= NCOLS || row >= NROWS) return Send(PIX_TRIM, true);
+	value &= 0x0f;
+	bool changed = roc->pix[col][row] != value;
+	roc->pix[col][row] = value;
+	return Send(PIX_TRIM, changed);
+}
+
+
+bool CRocShadow::Pix_Mask(uint8_t col, uint8_t row)
+{
+	Roc *roc = Current();
+	if (!roc || col >= NCOLS || row >= NROWS) return Send(PIX_MASK, true);
+	uint8_t &pix = roc->pix[col][row];
+	bool changed = pix == UNKNOWN || !(pix & PIX_MASKED);
+	if (changed) pix = PIX_MASK_ONLY;
+	return Send(PIX_MASK, changed);
+}
+
+
+bool CRocShadow::Pix_Cal(uint8_t col, uint8_t row, bool sensor_cal)
+{
+	Roc *roc = Current();
+	if (!roc || col >= NCOLS || row >= NROWS) return Send(PIX_CAL, true);
+	uint8_t value = sensor_cal ? 2 : 1;
+	uint8_t &cal = roc->cal[col][row];
+	bool changed = cal != value;
+	if (cal == 0 && roc->calCount >= 0) roc->calCount++;
+	cal = value;
+	return Send(PIX_CAL, changed);
+}
+
+
+bool CRocShadow::ClrCal()
+{
+	Roc *roc = Current();
+	if (!roc) return Send(CLRCAL, true);
+	bool changed = roc->calCount != 0;
+	memset(roc->cal, 0, sizeof(roc->cal));
+	roc->calCount = 0;
+	return Send(CLRCAL, changed);
+}
+
+
+bool CRocShadow::Col_Enable(uint8_t col, bool on)
+{
+	Roc *roc = Current();
+	if (!roc || col >= NCOLS) return Send(COL_ENABLE, true);
+	uint8_t value = on ? 1 : 0;
+	bool changed = roc->dcol[col/2] != value;
+	roc->dcol[col/2] = value;
+	return Send(COL_ENABLE, changed);
+}
+
+
+bool CRocShadow::Col_Mask(uint8_t col)
+{
+	Roc *roc = Current();
+	if (!roc || col >= NCOLS) return Send(COL_MASK, true);
+	bool changed = roc->dcol[col/2] != 0;
+	for (int row=0; row<NROWS; row++)
+	{
+		uint8_t &pix = roc->pix[col][row];
+		if (pix == UNKNOWN || !(pix & PIX_MASKED)) { pix = PIX_MASK_ONLY; changed = true; }
+	}
+	roc->dcol[col/2] = 0;
+	return Send(COL_MASK, changed);
+}
+
+
+bool CRocShadow::Chip_Mask()
+{
+	Roc *roc = Current();
+	if (!roc) return Send(CHIP_MASK, true);
+	bool changed = false;
+	for (int col=0; col<NCOLS; col++)
+	{
+		if (roc->dcol[col/2] != 0) changed = true;
+		for (int row=0; row<NROWS; row++)
+		{
+			uint8_t &pix = roc->pix[col][row];
+			if (pix == UNKNOWN || !(pix & PIX_MASKED)) { pix = PIX_MASK_ONLY; changed = true; }
+		}
+	}
+	memset(roc->dcol, 0, sizeof(roc->dcol));
+	return Send(CHIP_MASK, changed);
+}
+
+
+void CRocShadow::ColPixelTest(uint8_t col)
+{
+	Roc *roc = Current();
+	if (!roc) return;
+	if (col >= NCOLS) { roc->Invalidate(); return; }
+	roc->dac[Vcal] = -1;
+	roc->dcol[col/2] = UNKNOWN;
+	memset(roc->pix[col], UNKNOWN, NROWS);
+	memset(roc->cal[col], UNKNOWN, NROWS);
+	roc->calCount = -1;
+}
@@ -0,0 +1,90 @@
+// rocshadow.h
+//
+// Host copy of the ROC configuration (per I2C address): DACs, double
+// column enables, pixel trim/mask bits and calibrate bits. CTestboard
+// asks the shadow before each roc_* call. A call that does not change
+// the known state is skipped, all others are sent and recorded.
+//
+// The state is unknown after Invalidate (power, reset, DTB functions
+// that change the ROC setup) and after Reset (DTB init, new connection),
+// which also forgets the I2C address. An unknown value is always sent.
+// SetRocAddress moves the ROC to another I2C address and invalidates.
+// Writes to the readback select register (0xFF) are always sent. The
+// readback of the last DAC sees only the writes that were sent.
+//
+// CRocShadow has no lock of its own: with ENABLE_MULTITHREADING the
+// CTestboard wrappers hold their shadow lock while they check and send.
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+
+class CRocShadow
+{
+public:
+	enum Call
+	{
+		I2CADDR, SETDAC, PIX, PIX_TRIM, PIX_MASK, PIX_CAL, CLRCAL,
+		COL_ENABLE, COL_MASK, CHIP_MASK, NCALLS
+	};
+	enum { NROCS = 16, NCOLS = 52, NROWS = 80, NDCOLS = 26 };
+
+private:
+	// pixel bits: M - - - 8 4 2 1 (roc_Pix), 0xC0 = masked with unknown
+	// trim bits, 0xFF = unknown
+	enum { PIX_MASKED = 0x80, PIX_MASK_ONLY = 0xC0, UNKNOWN = 0xFF };
+
+	struct Roc
+	{
+		int16_t dac[256];             // -1 = unknown
+		uint8_t dcol[NDCOLS];         // 0, 1 or UNKNOWN
+		uint8_t pix[NCOLS][NROWS];
+		uint8_t cal[NCOLS][NROWS];    // 0, 1 = cal, 2 = sensor cal, UNKNOWN
+		int calCount;                 // pixels with cal, -1 = unknown
+		void Invalidate();
+	};
+	std::vector<Roc> m_roc; // index = I2C address
+	int m_addr;             // -1 = unknown
+	bool m_enabled;
+
+	unsigned long m_calls[NCALLS];
+	unsigned long m_skipped[NCALLS];
+
+	bool Send(Call call, bool changed)
+	{
+		m_calls[call]++;
+		if (!changed) m_skipped[call]++;
+		return changed;
+	}
+	Roc* Current() { return (m_enabled && m_addr >= 0) ? &m_roc[m_addr] : 0; }
+
+public:
+	CRocShadow();
+
+	void Enable(bool on);
+	bool IsEnabled() { return m_enabled; }
+	void Invalidate(); // ROC state unknown
+	void Reset();      // ROC state and I2C address unknown
+
+	unsigned long Calls(Call call) { return m_calls[call]; }
+	unsigned long Skipped(Call call) { return m_skipped[call]; }
+	void ResetCounters();
+	static const char* Name(Call call);
+
+	// --- true if the call has to be sent to the DTB
+	bool I2cAddr(uint8_t id);
+	bool SetDAC(uint8_t reg, uint8_t value);
+	bool Pix(uint8_t col, uint8_t row, uint8_t value);
+	bool Pix_Trim(uint8_t col, uint8_t row, uint8_t value);
+	bool Pix_Mask(uint8_t col, uint8_t row);
+	bool Pix_Cal(uint8_t col, uint8_t row, bool sensor_cal);
+	bool ClrCal();
+	bool Col_Enable(uint8_t col, bool on);
+	bool Col_Mask(uint8_t col);
+	bool Chip_Mask();
+
+	// DTB testColPixel: trims, masks and calibrates the column with Vcal
+	void ColPixelTest(uint8_t col);
+};
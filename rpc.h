@@ -5,26 +5,133 @@
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <string.h>
 
 #include "config.h"
 #include "rpc_io.h"
 #include "rpc_error.h"
 
+#ifdef ENABLE_TRACING
+#include "trace.h"
+#define RPC_TRACE TRACE_SCOPE(__FUNCTION__, "rpc")
+#else
+#define RPC_TRACE
+#endif
+
 #ifdef ENABLE_RPC_PROFILING
-#define RPC_PROFILING PROFILING
+#define RPC_PROFILING PROFILING RPC_TRACE
 #else
-#define RPC_PROFILING
+#define RPC_PROFILING RPC_TRACE
 #endif
 
 #ifdef ENABLE_MULTITHREADING
-#include <boost/thread.hpp>
-#define RPC_THREAD boost::mutex m_sync;
-#define RPC_THREAD_LOCK boost::lock_guard<boost::mutex> lock(m_sync);
+#include <mutex>
+#include <condition_variable>
+
+// Several threads may share one CTestboard. A call writes its request
+// under the send lock and draws a ticket. The DTB answers the requests in
+// the order they arrive, so the reply for ticket n is the n-th reply on
+// the link. The caller releases the send lock (other threads can send in
+// the meantime), waits until its ticket is served and reads its own reply.
+// A reply that is not read completely leaves the link out of sync: all
+// waiting and later calls fail with READ_ERROR until Clear purges the
+// link and restarts the tickets.
+// The call id table (rpc_cmdId) has its own lock. It is not held while
+// GetRpcCallId asks the DTB, so two threads may look up the same name.
+class CRpcSync
+{
+	std::mutex m_send;
+	std::mutex m_recv;
+	std::condition_variable m_served;
+	uint32_t m_ticket;  // next ticket to draw (send lock held)
+	uint32_t m_turn;    // ticket whose reply is next on the link
+	uint32_t m_pending; // tickets drawn and not yet served or failed
+	bool m_failed;      // link out of sync (until Restart)
+	std::mutex m_id;    // call id table (not held during an RPC)
+public:
+	CRpcSync() : m_ticket(0), m_turn(0), m_pending(0), m_failed(false) {}
+	std::mutex& SendLock() { return m_send; }
+	std::mutex& RecvLock() { return m_recv; }
+	std::mutex& IdLock() { return m_id; }
+	uint32_t Ticket()
+	{
+		std::lock_guard<std::mutex> lock(m_recv);
+		m_pending++;
+		return m_ticket++;
+	}
+	void Wait(uint32_t ticket)
+	{
+		std::unique_lock<std::mutex> lock(m_recv);
+		while (m_turn != ticket && !m_failed) m_served.wait(lock);
+		if (m_failed)
+		{
+			m_pending--;
+			m_served.notify_all();
+			throw CRpcError(CRpcError::READ_ERROR);
+		}
+	}
+	void Done(bool received)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_recv);
+			m_pending--;
+			if (received) m_turn++; else m_failed = true;
+		}
+		m_served.notify_all();
+	}
+	// send lock held: waits until no call waits for its reply
+	void Restart(std::unique_lock<std::mutex> &recvLock)
+	{
+		while (m_pending) m_served.wait(recvLock);
+		m_ticket = m_turn = 0;
+		m_failed = false;
+	}
+};
+
+
+// Holds the reply slot of a call. The next ticket is served when the
+// call leaves its scope after Received. If the receive throws an error
+// the link is out of sync and the waiting calls fail.
+class CRpcReply
+{
+	CRpcSync &m_sync;
+	bool m_received;
+public:
+	CRpcReply(CRpcSync &sync, std::unique_lock<std::mutex> &sendLock)
+		: m_sync(sync), m_received(false)
+	{
+		uint32_t ticket = m_sync.Ticket();
+		sendLock.unlock();
+		m_sync.Wait(ticket);
+	}
+	~CRpcReply() { m_sync.Done(m_received); }
+	void Received() { m_received = true; }
+};
+
+
+// Holds the link idle while it is purged (send and receive lock).
+class CRpcIdle
+{
+	std::unique_lock<std::mutex> m_recvLock;
+public:
+	CRpcIdle(CRpcSync &sync) : m_recvLock(sync.RecvLock()) { sync.Restart(m_recvLock); }
+};
+
+#define RPC_THREAD CRpcSync m_sync;
+#define RPC_THREAD_LOCK std::unique_lock<std::mutex> rpc_lock(m_sync.SendLock());
+#define RPC_THREAD_RECEIVE CRpcReply rpc_reply(m_sync, rpc_lock);
+#define RPC_THREAD_RECEIVED rpc_reply.Received();
 #define RPC_THREAD_UNLOCK
+#define RPC_THREAD_CLEAR RPC_THREAD_LOCK CRpcIdle rpc_idle(m_sync);
+#define RPC_THREAD_ID_LOCK std::lock_guard<std::mutex> rpc_id_lock(m_sync.IdLock());
 #else
 #define RPC_THREAD
 #define RPC_THREAD_LOCK
+#define RPC_THREAD_RECEIVE
+#define RPC_THREAD_RECEIVED
 #define RPC_THREAD_UNLOCK
+#define RPC_THREAD_CLEAR
+#define RPC_THREAD_ID_LOCK
 #endif
 
 using namespace std;
@@ -41,14 +148,16 @@ extern const char rpc_timestamp[];
 	static const unsigned int rpc_cmdListSize; \
 	static const char *rpc_cmdName[]; \
 	int *rpc_cmdId; \
-	void rpc_Clear() { rpc_cmdId[0] = 0; rpc_cmdId[1] = 1; for ( unsigned int i=2; i<rpc_cmdListSize; i++) rpc_cmdId[i] = -1; } \
+	void rpc_Clear() { RPC_THREAD_ID_LOCK rpc_cmdId[0] = 0; rpc_cmdId[1] = 1; for ( unsigned int i=2; i<rpc_cmdListSize; i++) rpc_cmdId[i] = -1; } \
 	void rpc_Connect(CRpcIo &port) { rpc_io = &port; rpc_Clear(); } \
 	uint16_t rpc_GetCallId(uint16_t x) \
 	{ \
-		int id = rpc_cmdId[x]; \
+		int id; \
+		{ RPC_THREAD_ID_LOCK id = rpc_cmdId[x]; } \
 		if (id >= 0) return id; \
 		string name(rpc_cmdName[x]); \
-		rpc_cmdId[x] = id = GetRpcCallId(name); \
+		id = GetRpcCallId(name); /* an RPC: id lock released */ \
+		{ RPC_THREAD_ID_LOCK rpc_cmdId[x] = id; } \
 		if (id >= 0) return id; \
 		throw CRpcError(CRpcError::UNKNOWN_CMD); \
 	} \
@@ -76,50 +185,104 @@ public:
 
 // === message ==============================================================
 
+// Parameters are serialized little endian at fixed offsets. The generated
+// stubs write them directly into the message buffer with the rpc_Put_xxx
+// functions and read return values with rpc_Get_xxx. The host byte order
+// must therefore be little endian (as already assumed for the headers).
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "RPC serialization requires a little endian host"
+#endif
+
+inline void rpc_Put_INT8  (uint8_t *p, int8_t   x) { *p = uint8_t(x); }
+inline void rpc_Put_UINT8 (uint8_t *p, uint8_t  x) { *p = x; }
+inline void rpc_Put_BOOL  (uint8_t *p, bool     x) { *p = x ? 1 : 0; }
+inline void rpc_Put_INT16 (uint8_t *p, int16_t  x) { memcpy(p, &x, 2); }
+inline void rpc_Put_UINT16(uint8_t *p, uint16_t x) { memcpy(p, &x, 2); }
+inline void rpc_Put_INT32 (uint8_t *p, int32_t  x) { memcpy(p, &x, 4); }
+inline void rpc_Put_UINT32(uint8_t *p, uint32_t x) { memcpy(p, &x, 4); }
+inline void rpc_Put_INT64 (uint8_t *p, int64_t  x) { memcpy(p, &x, 8); }
+inline void rpc_Put_UINT64(uint8_t *p, uint64_t x) { memcpy(p, &x, 8); }
+
+inline int8_t   rpc_Get_INT8  (const uint8_t *p) { return int8_t(*p); }
+inline uint8_t  rpc_Get_UINT8 (const uint8_t *p) { return *p; }
+inline bool     rpc_Get_BOOL  (const uint8_t *p) { return *p != 0; }
+inline int16_t  rpc_Get_INT16 (const uint8_t *p) { int16_t  x; memcpy(&x, p, 2); return x; }
+inline uint16_t rpc_Get_UINT16(const uint8_t *p) { uint16_t x; memcpy(&x, p, 2); return x; }
+inline int32_t  rpc_Get_INT32 (const uint8_t *p) { int32_t  x; memcpy(&x, p, 4); return x; }
+inline uint32_t rpc_Get_UINT32(const uint8_t *p) { uint32_t x; memcpy(&x, p, 4); return x; }
+inline int64_t  rpc_Get_INT64 (const uint8_t *p) { int64_t  x; memcpy(&x, p, 8); return x; }
+inline uint64_t rpc_Get_UINT64(const uint8_t *p) { uint64_t x; memcpy(&x, p, 8); return x; }
+
+
 class rpcMessage
 {
+	enum { HEADER_SIZE = 4, MAX_PAR_SIZE = 255 };
+
+	// header (type, cmd, size) and parameter block in one buffer,
+	// so that a message goes to the transport with a single write
 	uint8_t m_pos;
+	uint8_t m_buffer[HEADER_SIZE + MAX_PAR_SIZE];
+
+	uint8_t  Type() { return m_buffer[0]; }
+	uint16_t Cmd()  { return rpc_Get_UINT16(m_buffer + 1); }
+	uint8_t  Size() { return m_buffer[3]; }
+	uint8_t* Par()  { return m_buffer + HEADER_SIZE; }
 
-	uint8_t  m_type;
-	uint16_t m_cmd;
-	uint8_t  m_size;
-	uint8_t  m_par[256];
+	uint8_t* PutPos(unsigned int n)
+	{
+		if (m_pos + n > MAX_PAR_SIZE) throw CRpcError(CRpcError::CMD_PAR_SIZE);
+		uint8_t *p = Par() + m_pos;
+		m_pos += n;
+		m_buffer[3] = m_pos;
+		return p;
+	}
+	const uint8_t* GetPos(unsigned int n)
+	{
+		if (m_pos + n > Size()) throw CRpcError(CRpcError::CMD_PAR_SIZE);
+		const uint8_t *p = Par() + m_pos;
+		m_pos += n;
+		return p;
+	}
 public:
-	uint16_t GetCmd() { return m_cmd; }
+	uint16_t GetCmd() { return Cmd(); }
 
 	uint16_t GetCheckedCmd(uint16_t cmdCnt)
-	{ if (m_cmd < cmdCnt) return m_cmd; throw CRpcError(CRpcError::UNKNOWN_CMD); }
-
-	void Create(uint16_t cmd);
-	void Put_INT8(int8_t x) { m_par[m_pos++] = int8_t(x); m_size++; }
-	void Put_UINT8(uint8_t x) { m_par[m_pos++] = x; m_size++; }
-	void Put_BOOL(bool x) { Put_UINT8(x ? 1 : 0); }
-	void Put_INT16(int16_t x) { Put_UINT8(uint8_t(x)); Put_UINT8(uint8_t(x>>8)); }
-	void Put_UINT16(uint16_t x) { Put_UINT8(uint8_t(x)); Put_UINT8(uint8_t(x>>8)); }
-	void Put_INT32(int32_t x) { Put_UINT16(uint16_t(x)); Put_UINT16(uint16_t(x>>16)); }
-	void Put_UINT32(int32_t x) { Put_UINT16(uint16_t(x)); Put_UINT16(uint16_t(x>>16)); }
-	void Put_INT64(int64_t x) { Put_UINT32(uint32_t(x)); Put_UINT32(uint32_t(x>>32)); }
-	void Put_UINT64(uint64_t x) { Put_UINT32(uint32_t(x)); Put_UINT32(uint32_t(x>>32)); }
+	{ if (Cmd() < cmdCnt) return Cmd(); throw CRpcError(CRpcError::UNKNOWN_CMD); }
+
+	void Create(uint16_t cmd) { Create(cmd, 0); }
+	uint8_t* Create(uint16_t cmd, uint8_t size);
+	uint8_t* GetPar() { return Par(); }
+
+	void Put_INT8(int8_t x)     { rpc_Put_INT8  (PutPos(1), x); }
+	void Put_UINT8(uint8_t x)   { rpc_Put_UINT8 (PutPos(1), x); }
+	void Put_BOOL(bool x)       { rpc_Put_BOOL  (PutPos(1), x); }
+	void Put_INT16(int16_t x)   { rpc_Put_INT16 (PutPos(2), x); }
+	void Put_UINT16(uint16_t x) { rpc_Put_UINT16(PutPos(2), x); }
+	void Put_INT32(int32_t x)   { rpc_Put_INT32 (PutPos(4), x); }
+	void Put_UINT32(uint32_t x) { rpc_Put_UINT32(PutPos(4), x); }
+	void Put_INT64(int64_t x)   { rpc_Put_INT64 (PutPos(8), x); }
+	void Put_UINT64(uint64_t x) { rpc_Put_UINT64(PutPos(8), x); }
 
 	void Send(CRpcIo &rpc_io);
 	void Receive(CRpcIo &rpc_io);
 	void Check(uint16_t cmd, uint8_t size)
 	{
-		if (m_cmd != cmd) throw CRpcError(CRpcError::UNKNOWN_CMD);
-		if (m_size != size) throw CRpcError(CRpcError::CMD_PAR_SIZE);
+		if (Cmd() != cmd) throw CRpcError(CRpcError::UNKNOWN_CMD);
+		if (Size() != size) throw CRpcError(CRpcError::CMD_PAR_SIZE);
 		return;
 	}
-	void CheckSize(uint8_t size) { if (m_size != size) throw CRpcError(CRpcError::CMD_PAR_SIZE); }
-
-	int8_t Get_INT8() { return int8_t(m_par[m_pos++]); }
-	uint8_t Get_UINT8() { return uint8_t(m_par[m_pos++]); }
-	bool Get_BOOL() { return Get_UINT8() != 0; }
-	int16_t Get_INT16() { int16_t x = Get_UINT8(); x += (uint16_t)Get_UINT8() << 8; return x; }
-	uint16_t Get_UINT16() { uint16_t x = Get_UINT8(); x += (uint16_t)Get_UINT8() << 8; return x; }
-	int32_t Get_INT32() { int32_t x = Get_UINT16(); x += (uint32_t)Get_UINT16() << 16; return x; }
-	uint32_t Get_UINT32() { uint32_t x = Get_UINT16(); x += (uint32_t)Get_UINT16() << 16; return x; }
- 	int64_t Get_INT64() { int64_t x = Get_UINT32(); x += (uint64_t)Get_UINT32() << 32; return x; }
-	uint64_t Get_UINT64() { uint64_t x = Get_UINT32(); x = (uint64_t)Get_UINT32() << 32; return x; }
+	void CheckSize(uint8_t size) { if (Size() != size) throw CRpcError(CRpcError::CMD_PAR_SIZE); }
+
+	int8_t   Get_INT8()   { return rpc_Get_INT8  (GetPos(1)); }
+	uint8_t  Get_UINT8()  { return rpc_Get_UINT8 (GetPos(1)); }
+	bool     Get_BOOL()   { return rpc_Get_BOOL  (GetPos(1)); }
+	int16_t  Get_INT16()  { return rpc_Get_INT16 (GetPos(2)); }
+	uint16_t Get_UINT16() { return rpc_Get_UINT16(GetPos(2)); }
+	int32_t  Get_INT32()  { return rpc_Get_INT32 (GetPos(4)); }
+	uint32_t Get_UINT32() { return rpc_Get_UINT32(GetPos(4)); }
+	int64_t  Get_INT64()  { return rpc_Get_INT64 (GetPos(8)); }
+	uint64_t Get_UINT64() { return rpc_Get_UINT64(GetPos(8)); }
 };
 
 
@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <string.h>
+#include <vector>
 #include "rpc_error.h"
 
 
@@ -30,3 +32,45 @@ public:
 
 };
 
+
+// Memory loopback transport (no hardware). Everything written goes to the
+// tx buffer. With echo mode on, Flush moves it to the receive queue, so
+// that a message can be sent and received back. Reply() queues data
+// that the next Read calls return.
+class CRpcIoLoopback : public CRpcIo
+{
+	bool m_echo;
+	std::vector<unsigned char> m_tx;
+	std::vector<unsigned char> m_rx;
+	unsigned int m_rxPos;
+public:
+	CRpcIoLoopback(bool echo = false) : m_echo(echo), m_rxPos(0) {}
+	void SetEcho(bool echo) { m_echo = echo; }
+	unsigned int TxSize() { return m_tx.size(); }
+	void Reply(const void *buffer, unsigned int size)
+	{
+		if (m_rxPos >= m_rx.size()) { m_rx.clear(); m_rxPos = 0; }
+		const unsigned char *p = (const unsigned char*)buffer;
+		m_rx.insert(m_rx.end(), p, p + size);
+	}
+
+	void Write(const void *buffer, unsigned int size)
+	{
+		const unsigned char *p = (const unsigned char*)buffer;
+		m_tx.insert(m_tx.end(), p, p + size);
+	}
+	void Flush()
+	{
+		if (m_echo && m_tx.size()) Reply(&(m_tx[0]), m_tx.size());
+		m_tx.clear();
+	}
+	void Clear() { m_tx.clear(); m_rx.clear(); m_rxPos = 0; }
+	void Read(void *buffer, unsigned int size)
+	{
+		if (m_echo && m_rxPos + size > m_rx.size()) Flush();
+		if (m_rxPos + size > m_rx.size()) throw CRpcError(CRpcError::READ_TIMEOUT);
+		memcpy(buffer, &(m_rx[m_rxPos]), size);
+		m_rxPos += size;
+	}
+	void Close() { Clear(); }
+};
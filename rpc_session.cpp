@@ -0,0 +1,158 @@
+// rpc_session.cpp
+
+#include <string.h>
+#include "rpc_session.h"
+#include "trace.h"
+
+#define SESSION_MAGIC "RPCSESS1"
+
+
+// === recorder =============================================================
+
+bool CRpcIoRecorder::Start(const char *filename, CRpcIo &io)
+{
+	Stop();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_f = fopen(filename, "wb");
+	if (!m_f) return false;
+	fwrite(SESSION_MAGIC, 1, 8, m_f);
+	m_io = &io;
+	m_t0 = CTrace::Now();
+	m_bytesW = m_bytesR = 0;
+	return true;
+}
+
+
+CRpcIo* CRpcIoRecorder::Stop()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_f) { fclose(m_f); m_f = 0; }
+	return m_io;
+}
+
+
+// header and data in one fwrite and the byte counters under the lock
+void CRpcIoRecorder::Record(uint8_t type, const void *buffer, unsigned int size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (type == 'W') m_bytesW += size;
+	else if (type == 'R') m_bytesR += size;
+	if (!m_f) return;
+	uint32_t n = size;
+	int64_t t = CTrace::Now() - m_t0;
+	m_record.resize(13 + size);
+	m_record[0] = type;
+	memcpy(&m_record[1], &n, 4);
+	memcpy(&m_record[5], &t, 8);
+	if (size) memcpy(&m_record[13], buffer, size);
+	fwrite(&m_record[0], 1, m_record.size(), m_f);
+}
+
+
+void CRpcIoRecorder::Write(const void *buffer, unsigned int size)
+{
+	m_io->Write(buffer, size);
+	Record('W', buffer, size);
+}
+
+
+void CRpcIoRecorder::Flush()
+{
+	m_io->Flush();
+	Record('F', 0, 0);
+}
+
+
+void CRpcIoRecorder::Clear()
+{
+	m_io->Clear();
+	Record('C', 0, 0);
+}
+
+
+void CRpcIoRecorder::Read(void *buffer, unsigned int size)
+{
+	m_io->Read(buffer, size);
+	Record('R', buffer, size);
+}
+
+
+void CRpcIoRecorder::Close()
+{
+	m_io->Close();
+}
+
+
+// === replay ===============================================================
+
+bool CRpcIoReplay::Load(const char *filename)
+{
+	m_tx.clear();
+	m_rx.clear();
+	m_duration = 0;
+	Rewind();
+
+	FILE *f = fopen(filename, "rb");
+	if (!f) return false;
+
+	char magic[8];
+	bool ok = fread(magic, 1, 8, f) == 8 && memcmp(magic, SESSION_MAGIC, 8) == 0;
+	uint8_t header[13];
+	while (ok && fread(header, 1, 13, f) == 13)
+	{
+		uint32_t n;
+		int64_t t;
+		memcpy(&n, header+1, 4);
+		memcpy(&t, header+5, 8);
+		m_duration = t;
+		std::vector<uint8_t> *stream = 0;
+		switch (header[0])
+		{
+			case 'W': stream = &m_tx; break;
+			case 'R': stream = &m_rx; break;
+			case 'F':
+			case 'C': break;
+			default: ok = false;
+		}
+		if (ok && n)
+		{
+			if (!stream) { ok = false; break; }
+			unsigned int pos = stream->size();
+			stream->resize(pos + n);
+			ok = fread(&((*stream)[pos]), 1, n, f) == n;
+		}
+	}
+	fclose(f);
+	return ok;
+}
+
+
+void CRpcIoReplay::Write(const void *buffer, unsigned int size)
+{
+	const uint8_t *p = (const uint8_t*)buffer;
+	for (unsigned int i=0; i<size; i++, m_txPos++)
+	{
+		if (m_txPos < m_tx.size() && m_tx[m_txPos] == p[i]) continue;
+		if (m_firstMismatch < 0) m_firstMismatch = m_txPos;
+		m_mismatch++;
+	}
+}
+
+
+void CRpcIoReplay::Read(void *buffer, unsigned int size)
+{
+	if (m_rxPos + size > m_rx.size()) throw CRpcError(CRpcError::READ_TIMEOUT);
+	memcpy(buffer, &(m_rx[m_rxPos]), size);
+	m_rxPos += size;
+}
+
+
+void CRpcIoReplay::Report()
+{
+	printf(" recorded session: %0.3f s, %u bytes sent, %u bytes received\n",
+		m_duration*1e-9, (unsigned int)m_tx.size(), (unsigned int)m_rx.size());
+	printf(" replayed:         %u bytes sent, %u bytes received\n", m_txPos, m_rxPos);
+	if (m_mismatch)
+		printf(" WARNING: %u sent bytes differ from record (first at byte %lli)\n",
+			m_mismatch, m_firstMismatch);
+}
@@ -0,0 +1,74 @@
+// rpc_session.h
+//
+// Record and replay of the RPC traffic to the DTB.
+//
+// CRpcIoRecorder is put between CTestboard and the USB connection and
+// logs every block written and read (with time stamp) to a session file.
+// CRpcIoReplay serves the recorded replies without hardware, so that a
+// test or script can be executed offline with identical RPC traffic.
+//
+// With ENABLE_MULTITHREADING the sending thread and the thread reading
+// its reply use the recorder at the same time. Each record is written
+// with one fwrite under the recorder lock, so records do not interleave.
+//
+// session file: "RPCSESS1" followed by records
+//   uint8 type ('W' write, 'R' read, 'F' flush, 'C' clear)
+//   uint32 size, int64 time [ns since start], data[size]
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include "rpc_io.h"
+
+
+class CRpcIoRecorder : public CRpcIo
+{
+	CRpcIo *m_io;
+	FILE *m_f;
+	long long m_t0;
+	unsigned long long m_bytesW, m_bytesR;
+	std::mutex m_mutex; // file, counters and record buffer
+	std::vector<uint8_t> m_record;
+	void Record(uint8_t type, const void *buffer, unsigned int size);
+public:
+	CRpcIoRecorder() : m_io(0), m_f(0), m_t0(0), m_bytesW(0), m_bytesR(0) {}
+	~CRpcIoRecorder() { Stop(); }
+	bool Start(const char *filename, CRpcIo &io);
+	CRpcIo* Stop(); // returns the recorded connection
+	bool IsRecording() { std::lock_guard<std::mutex> lock(m_mutex); return m_f != 0; }
+	unsigned long long BytesWritten() { std::lock_guard<std::mutex> lock(m_mutex); return m_bytesW; }
+	unsigned long long BytesRead() { std::lock_guard<std::mutex> lock(m_mutex); return m_bytesR; }
+
+	void Write(const void *buffer, unsigned int size);
+	void Flush();
+	void Clear();
+	void Read(void *buffer, unsigned int size);
+	void Close();
+};
+
+
+class CRpcIoReplay : public CRpcIo
+{
+	std::vector<uint8_t> m_tx; // recorded host -> DTB stream
+	std::vector<uint8_t> m_rx; // recorded DTB -> host stream
+	unsigned int m_txPos, m_rxPos;
+	unsigned int m_mismatch;   // written bytes different from record
+	long long m_firstMismatch; // stream position of first difference
+	long long m_duration;      // recorded session time [ns]
+public:
+	CRpcIoReplay() : m_duration(0) { Rewind(); }
+	bool Load(const char *filename);
+	void Rewind() { m_txPos = m_rxPos = 0; m_mismatch = 0; m_firstMismatch = -1; }
+
+	void Report();
+	bool AtEnd() { return m_rxPos >= m_rx.size(); }
+
+	void Write(const void *buffer, unsigned int size);
+	void Flush() {}
+	void Clear() {} // unread input is not recorded, the session goes on
+	void Read(void *buffer, unsigned int size);
+	void Close() {}
+};
@@ -93,7 +93,7 @@ bool CDataType::Read(const char*&s, int parNr)
 void CDataType::WriteSendPar(FILE *f)
 {
 	if (parByteCount)
-		fprintf(f, "\tmsg.Put_%s(rpc_par%u);\n", GetTypeName(), id);
+		fprintf(f, "\trpc_Put_%s(rpc_buf+%u, rpc_par%u);\n", GetTypeName(), parOffset, id);
 }
 
 
@@ -107,10 +107,7 @@ void CDataType::WriteRecvPar(FILE *f)
 {
 	if (retByteCount)
 	{
-		if (IsReturn())
-			fprintf(f, "\trpc_par0 = msg.Get_%s();\n", GetTypeName());
-		else
-			fprintf(f, "\trpc_par%u = msg.Get_%s();\n", id, GetTypeName());
+		fprintf(f, "\trpc_par%u = rpc_Get_%s(rpc_buf+%u);\n", id, GetTypeName(), retOffset);
 	}
 }
 
@@ -172,6 +169,8 @@ void CParameterList::Read(const char *s)
 	while (*s)
 	{
 		CDataType t;
+		t.parOffset = parCount;
+		t.retOffset = retCount;
 		if (t.Read(s, i)) par.push_back(t);
 		parCount += t.GetParBytes();
 		retCount += t.GetRetBytes();
@@ -20,6 +20,8 @@ class CDataType
 	unsigned int id; // 0 = return value
 	unsigned int parByteCount;
 	unsigned int retByteCount;
+	unsigned int parOffset; // fixed position in the message parameter block
+	unsigned int retOffset; // fixed position in the return parameter block
 public:
 	bool IsReturn() { return id == 0; }
 	bool IsSimpleType() { return comp == SIMPLE; }
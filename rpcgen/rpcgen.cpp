@@ -29,6 +29,15 @@ typedef list<string> functList;
 typedef list<string>::iterator functListIterator;
 
 
+// A host function "rpc_name" is the RPC "name". The prefix allows a
+// host side wrapper with the original name (e.g. a register cache).
+string RpcName(const string &fname)
+{
+	if (fname.compare(0, 4, "rpc_") == 0) return fname.substr(4);
+	return fname;
+}
+
+
 bool ReadFunctDefinitions(const char *filename, functList &fl)
 {
 	string s;
@@ -113,7 +122,7 @@ void GenerateServerCode(functList &fl, FILE *f)
 		for (i = fl.begin(); i != fl.end(); i++)
 		{
 			unsigned int found = i->find_last_of('$');
-			name = i->substr(0,found);
+			name = RpcName(i->substr(0,found));
 			parameter = i->substr(found+1);
 			GenerateServerEntry( f,  cmd, name.c_str(), parameter.c_str());
 			cmd++;
@@ -134,10 +143,11 @@ void GenerateServerCodeTrailer(functList &fl, FILE *f)
 	list<string>::iterator i;
 	for (i = fl.begin(); i != fl.end(); i++)
 	{
+		string name = RpcName(*i);
 		if (cmd == 0)
-			fprintf(f, "\t/* %5u */ { rpc__%s, \"%s\" }", cmd, i->c_str(), i->c_str());
+			fprintf(f, "\t/* %5u */ { rpc__%s, \"%s\" }", cmd, name.c_str(), name.c_str());
 		else
-			fprintf(f, ",\n\t/* %5u */ { rpc__%s, \"%s\" }", cmd, i->c_str(), i->c_str());
+			fprintf(f, ",\n\t/* %5u */ { rpc__%s, \"%s\" }", cmd, name.c_str(), name.c_str());
 		cmd++;
 	}
 	fprintf
@@ -177,10 +187,13 @@ void GenerateClientEntry(FILE *f, unsigned int cmd, const char *fname, const cha
 		"\ttry {\n"
 		"\tuint16_t rpc_clientCallId = rpc_GetCallId(%u);\n"
 		"\tRPC_THREAD_LOCK\n"
-		"\trpcMessage msg;\n"
-		"\tmsg.Create(rpc_clientCallId);\n",
+		"\trpcMessage msg;\n",
 		cmd
 	);
+	if (plist.GetTotalParBytes())
+		fprintf(f, "\tuint8_t *rpc_buf = msg.Create(rpc_clientCallId, %u);\n", plist.GetTotalParBytes());
+	else
+		fputs("\tmsg.Create(rpc_clientCallId);\n", f);
 	plist.WriteAllSendPar(f);
 	fputs("\tmsg.Send(*rpc_io);\n", f);
 	plist.WriteAllSendDat(f);
@@ -189,11 +202,15 @@ void GenerateClientEntry(FILE *f, unsigned int cmd, const char *fname, const cha
 	{
 		fprintf(f,
 			"\trpc_io->Flush();\n"
+			"\tRPC_THREAD_RECEIVE\n"
 			"\tmsg.Receive(*rpc_io);\n"
 			"\tmsg.Check(rpc_clientCallId,%u);\n",
 			plist.GetTotalRetBytes());
+		if (plist.GetTotalRetBytes())
+			fprintf(f, "\t%srpc_buf = msg.GetPar();\n", plist.GetTotalParBytes() ? "" : "uint8_t *");
 		plist.WriteAllRecvPar(f);
 		plist.WriteAllRecvDat(f);
+		fputs("\tRPC_THREAD_RECEIVED\n", f);
 	}
 	fprintf(f, "\tRPC_THREAD_UNLOCK\n");
 	fprintf(f, "\t} catch (CRpcError &e) { e.SetFunction(%u); throw; };\n", cmd);
@@ -223,9 +240,9 @@ void GenerateClientCodeHeader(functList &fl, FILE *f)
 	for (i = fl.begin(); i != fl.end(); i++)
 	{
 		if (cmd == 0)
-			fprintf(f, "\t/* %5u */ \"%s\"", cmd, i->c_str());
+			fprintf(f, "\t/* %5u */ \"%s\"", cmd, RpcName(*i).c_str());
 		else
-			fprintf(f, ",\n\t/* %5u */ \"%s\"", cmd, i->c_str());
+			fprintf(f, ",\n\t/* %5u */ \"%s\"", cmd, RpcName(*i).c_str());
 		cmd++;
 	}
 	fprintf(f, "\n};\n\n");
@@ -3,61 +3,193 @@
 #include <string.h>
 #include "scanner.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCANNER_SSE2
+#endif
+
 
 // === CFile =============================================================
 
 
 bool CFile::open(const char filename[])
 {
-	init();
-	buffer = new char[FILEBUFFERSIZE];
-	if (!buffer) return false;
-	m_stream = fopen(filename,"r");
-	if (m_stream == NULL) return false;
-	getNextChar();
+	close();
+#ifdef _WIN32
+	m_hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE,
+		NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_hFile == INVALID_HANDLE_VALUE) { m_hFile = NULL; return false; }
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_hFile, &size)) { close(); return false; }
+	m_size = size_t(size.QuadPart);
+	if (m_size)
+	{
+		m_hMap = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_hMap) m_data = (const char*)MapViewOfFile(m_hMap, FILE_MAP_READ, 0, 0, 0);
+		m_mapped = m_data != NULL;
+	}
+	if (!m_mapped)
+	{
+		char *buffer = new char[m_size+1];
+		DWORD n;
+		size_t count = 0;
+		while (count < m_size && ReadFile(m_hFile, buffer+count,
+			DWORD((m_size-count < 0x40000000) ? m_size-count : 0x40000000), &n, NULL) && n)
+			count += n;
+		m_data = buffer;
+		m_size = count;
+	}
+#else
+	int fd = ::open(filename, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+	m_size = size_t(st.st_size);
+	if (m_size)
+	{
+		void *p = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED)
+		{
+			madvise(p, m_size, MADV_SEQUENTIAL);
+			m_data = (const char*)p;
+			m_mapped = true;
+		}
+	}
+	if (!m_mapped)
+	{
+		char *buffer = new char[m_size+1];
+		size_t count = 0;
+		ssize_t n;
+		while (count < m_size && (n = ::read(fd, buffer+count, m_size-count)) > 0)
+			count += n;
+		m_data = buffer;
+		m_size = count;
+	}
+	::close(fd);
+#endif
+	seek(0);
 	return true;
 }
 
-bool CFile::rewind()
+
+bool CFile::open(const CFile &src)
 {
-	if (!m_stream) return false;
-	fseek(m_stream, 0, SEEK_SET);
-	getNextChar();
+	close();
+	if (!src.m_data) return false;
+	m_data = src.m_data;
+	m_size = src.m_size;
+	m_shared = true;
+	seek(0);
 	return true;
 }
 
-char CFile::loadBuffer()
+
+void CFile::close()
 {
-	if (!m_stream) return 0;
-	count = fread(buffer,1,FILEBUFFERSIZE,m_stream);
-	pos = 0;
-	
-	if (pos >= count) m_LastChar = 0;
-	else m_LastChar = buffer[pos++];
-	return m_LastChar;
+	if (m_data && !m_shared)
+	{
+#ifdef _WIN32
+		if (m_mapped) UnmapViewOfFile(m_data);
+#else
+		if (m_mapped) munmap((void*)m_data, m_size);
+#endif
+		else delete[] m_data;
+	}
+#ifdef _WIN32
+	if (m_hMap) CloseHandle(m_hMap);
+	if (m_hFile) CloseHandle(m_hFile);
+#endif
+	init();
 }
 
 
-void CFile::close()
+
+// === CScanner ==========================================================
+
+// first '[', CR or LF in [p, end)
+static const char* FindLineEnd(const char *p, const char *end)
 {
-	if (buffer) { delete[] buffer; buffer=NULL; }
-	if (m_stream) { fclose(m_stream); m_stream = NULL; }
+#ifdef SCANNER_SSE2
+	const __m128i bracket = _mm_set1_epi8('['), cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+	while (end - p >= 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)p);
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, bracket),
+			_mm_or_si128(_mm_cmpeq_epi8(x, cr), _mm_cmpeq_epi8(x, lf))));
+		if (mask)
+		{
+#ifdef _MSC_VER
+			unsigned long i;
+			_BitScanForward(&i, mask);
+			return p + i;
+#else
+			return p + __builtin_ctz(mask);
+#endif
+		}
+		p += 16;
+	}
+#endif
+	while (p < end && *p != '[' && *p != '\r' && *p != '\n') p++;
+	return p;
 }
 
 
+// same rules as the sequential scan: a section starts at '[' and its
+// name ends at ']', a '[' inside the name starts no section
+void CScanner::buildIndex()
+{
+	const char *data = m_logf.data(), *end = data + m_logf.size();
+	const char *p = data;
+	m_index.clear();
+	m_next = 0;
+	if (!data) return;
+	while ((p = (const char*)memchr(p, '[', end - p)) != NULL)
+	{
+		Section s;
+		s.pos = p - data;
+		p++;
+		const char *q = (const char*)memchr(p, ']', end - p);
+		if (!q) q = end;
+		size_t len = q - p;
+		if (len > MAXSECTIONLEN) len = MAXSECTIONLEN;
+		memcpy(s.name, p, len);
+		s.name[len] = 0;
+		p = (q < end) ? q + 1 : end;
+		s.data = p - data;
+		m_index.push_back(s);
+	}
+}
 
-// === CScanner ==========================================================
 
 bool CScanner::open(const char filename[])
 {
-	if (m_logf.open(filename)) { getNextSection(); return true; }
+	if (m_logf.open(filename)) { buildIndex(); getNextSection(); return true; }
 	return false;
 }
 
 
+bool CScanner::open(const CScanner &src)
+{
+	if (!m_logf.open(src.m_logf)) return false;
+	m_index = src.m_index;
+	m_next = 0;
+	getNextSection();
+	return true;
+}
+
+
 bool CScanner::rewind()
 {
-	if (m_logf.rewind()) { getNextSection(); return true; }
+	if (m_logf.rewind()) { m_next = 0; getNextSection(); return true; }
 	return false;
 }
 
@@ -65,25 +197,36 @@ bool CScanner::rewind()
 void CScanner::close()
 {
 	m_logf.close();
+	m_index.clear();
+	m_next = 0;
+	m_Section[0] = 0;
 }
 
 
 char* CScanner::getNextSection()
 {
-	m_logf.skipToChar('[');
-	int pos = 0;
-	char ch = m_logf.getNextChar();
-	while (ch && ch!=']')
+	size_t pos = m_logf.tell();
+	while (m_next < m_index.size() && m_index[m_next].pos < pos) m_next++;
+	if (m_next < m_index.size()) gotoSection(m_next);
+	else
 	{
-		if (pos<MAXSECTIONLEN) m_Section[pos++] = ch;
-		ch = m_logf.getNextChar();
+		m_Section[0] = 0;
+		m_logf.seek(m_logf.size());
 	}
-	m_Section[pos] = 0;
-	m_logf.getNextChar();
 	return m_Section;
 }
 
 
+bool CScanner::gotoSection(unsigned int i)
+{
+	if (i >= m_index.size()) return false;
+	strcpy(m_Section, m_index[i].name);
+	m_logf.seek(m_index[i].data);
+	m_next = i + 1;
+	return true;
+}
+
+
 bool CScanner::getNextSection(const char name[])
 {
 	do
@@ -112,24 +255,23 @@ bool CScanner::getNextSection(const char name[], const char stop[])
 
 char* CScanner::getNextLine()
 {
-	int pos = 0;
-	char ch = m_logf.getChar();
-	while (ch && ch!='[' && ch!='\r' && ch!='\n')
-	{
-		if (pos<MAXLINELEN) m_Line[pos++] = ch;
-		ch = m_logf.getNextChar();
-	}
-	m_Line[pos] = 0;
-	while (ch=='\r' || ch=='\n') ch = m_logf.getNextChar();
-	return m_Line;
+	const char *data = m_logf.data(), *end = data + m_logf.size();
+	const char *p = data + m_logf.tell();
+	const char *q = FindLineEnd(p, end);
+	size_t len = q - p;
+	if (len >= m_Line.size()) m_Line.resize(len+1);
+	memcpy(&m_Line[0], p, len);
+	m_Line[len] = 0;
+	while (q < end && (*q=='\r' || *q=='\n')) q++;
+	m_logf.seek(q - data);
+	return &m_Line[0];
 }
 
 
 void CScanner::skipLine()
 {
-	char ch = m_logf.getChar();
-	while (ch && ch!='[' && ch!='\r' && ch!='\n')
-		ch = m_logf.getNextChar();
-	while (ch=='\r' || ch=='\n') ch = m_logf.getNextChar();
+	const char *data = m_logf.data(), *end = data + m_logf.size();
+	const char *q = FindLineEnd(data + m_logf.tell(), end);
+	while (q < end && (*q=='\r' || *q=='\n')) q++;
+	m_logf.seek(q - data);
 }
-
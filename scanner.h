@@ -5,31 +5,44 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <vector>
 #include "config.h"
 
-	
-// --- CFile -------------------------------------------------------------
 
-#define FILEBUFFERSIZE 4096
+// --- CFile -------------------------------------------------------------
+// The whole file is mapped into memory (read into a buffer if mapping
+// fails). getChar is the character at the current position, 0 at the
+// end of the file. A CFile opened on another one shares its data.
 
 class CFile
 {
-	int pos, count;
-	char *buffer;
+	const char *m_data;
+	size_t m_size;
+	size_t m_pos;
 	char m_LastChar;
-	FILE *m_stream;
-	char loadBuffer();
-	void init() { m_stream = NULL; m_LastChar = 0; buffer = NULL;
-					pos = 0; count = 0; }
+	bool m_mapped;
+	bool m_shared;
+#ifdef _WIN32
+	void *m_hFile, *m_hMap;
+#endif
+	void init()
+	{
+		m_data = NULL; m_size = m_pos = 0; m_LastChar = 0;
+		m_mapped = m_shared = false;
+#ifdef _WIN32
+		m_hFile = m_hMap = NULL;
+#endif
+	}
 public:
 	CFile() { init(); }
 	~CFile() { close(); }
 	bool open(const char filename[]);
-	bool rewind();
+	bool open(const CFile &src);
+	bool rewind() { if (!m_data) return false; seek(0); return true; }
 	char getNextChar()
 	{
-		if (pos < count) return m_LastChar = buffer[pos++];
-		return loadBuffer();
+		if (m_pos < m_size) m_pos++;
+		return m_LastChar = (m_pos < m_size) ? m_data[m_pos] : 0;
 	}
 	char getChar() { return m_LastChar; }
 	char skipToChar(char ch)
@@ -38,11 +51,24 @@ public:
 		return m_LastChar;
 	};
 	void close();
+
+	const char* data() { return m_data; }
+	size_t size() { return m_size; }
+	size_t tell() { return m_pos; }
+	void seek(size_t pos)
+	{
+		m_pos = (pos < m_size) ? pos : m_size;
+		m_LastChar = (m_pos < m_size) ? m_data[m_pos] : 0;
+	}
 };
 
 
 // --- Scanner -----------------------------------------------------------
-
+// On open all [SECTION] headers are indexed in one scan of the file.
+// getNextSection jumps to the next index entry. Lines have no length
+// limit. The line buffer is never shrunk: characters behind the
+// terminating 0 of a short line are still those of the previous longer
+// line (the BEGIN/END time stamp readers depend on that).
 
 #define MAXSECTIONLEN  20
 #define MAXLINELEN    300
@@ -50,11 +76,22 @@ public:
 
 class CScanner
 {
+	struct Section
+	{
+		size_t pos;   // position of '['
+		size_t data;  // position behind ']'
+		char name[MAXSECTIONLEN+1];
+	};
 	CFile m_logf;
+	std::vector<Section> m_index;
+	unsigned int m_next; // first section behind the current position
 	char m_Section[MAXSECTIONLEN+1];
-	char m_Line[MAXLINELEN+1];
+	std::vector<char> m_Line;
+	void buildIndex();
 public:
+	CScanner() : m_next(0), m_Line(MAXLINELEN+1, 0) { m_Section[0] = 0; }
 	bool open(const char filename[]);
+	bool open(const CScanner &src); // shares file and index of src (e.g. for another thread)
 	bool rewind();
 	void close();
 	~CScanner() { close(); }
@@ -63,10 +100,36 @@ public:
 	bool getNextSection(const char name[], const char stop[]);
 	bool isSection(const char name[]) { return strcmp(m_Section,name) == 0; }
 
+	// section index
+	unsigned int getSectionCount() { return m_index.size(); }
+	const char* getSectionName(unsigned int i) { return m_index[i].name; }
+	size_t getSectionPos(unsigned int i) { return m_index[i].pos; }
+	bool gotoSection(unsigned int i); // as if getNextSection had read section i
+	unsigned int getSectionNr() // current section, getSectionCount() at the end
+	{ return m_Section[0] ? m_next - 1 : m_index.size(); }
+
 	char* getNextLine();
-	char* getLine() { return m_Line; }
+	char* getLine() { return &m_Line[0]; }
 	void skipLine();
 };
 
 
+// fast sscanf(*s, "%i", &value) for decimal numbers: skips blanks,
+// reads sign and digits and moves *s behind the number
+inline bool ScanInt(char **s, int &value)
+{
+	const unsigned char *p = (const unsigned char*)*s;
+	while (*p == ' ' || *p == '\t') p++;
+	bool neg = *p == '-';
+	if (*p == '-' || *p == '+') p++;
+	unsigned int d = *p - '0';
+	if (d > 9) return false;
+	int x = 0;
+	do { x = 10*x + d; d = *++p - '0'; } while (d <= 9);
+	value = neg ? -x : x;
+	*s = (char*)p;
+	return true;
+}
+
+
 #endif
@@ -0,0 +1,61 @@
+// scurve.cpp
+
+#include <math.h>
+#include "scurve.h"
+#include "parallel.h"
+
+
+void CSCurves::Init(int x0, unsigned int nx, unsigned int ntrig)
+{
+	m_x0 = x0;
+	m_nx = nx;
+	m_ntrig = ntrig ? ntrig : 1;
+	m_eff.assign(nx*NPIXEL, 0.0f);
+}
+
+
+void CSCurves::Fit(const float *eff, unsigned int nx, float x0,
+	unsigned int p0, unsigned int p1, float *thr, float *noise)
+{
+	unsigned int i, p;
+	std::vector<float> s(3*(p1 - p0), 0.0f);
+	float *s0 = &s[0], *s1 = s0 + (p1 - p0), *s2 = s1 + (p1 - p0);
+
+	for (i = 0; i + 1 < nx; i++)
+	{
+		const float *e0 = eff + i*NPIXEL + p0;
+		const float *e1 = e0 + NPIXEL;
+		float x = i + 0.5f; // relative to x0
+		for (p = 0; p < p1 - p0; p++)
+		{
+			float d = e1[p] - e0[p];
+			s0[p] += d;
+			s1[p] += d*x;
+			s2[p] += d*x*x;
+		}
+	}
+
+	for (p = 0; p < p1 - p0; p++)
+	{
+		if (s0[p] < 0.5f) { thr[p0+p] = -1.0f; noise[p0+p] = 0.0f; continue; }
+		float m = s1[p]/s0[p];
+		float v = s2[p]/s0[p] - m*m;
+		thr[p0+p] = x0 + m;
+		noise[p0+p] = (v > 0.0f) ? sqrtf(v) : 0.0f;
+	}
+}
+
+
+void CSCurves::Fit(float *thr, float *noise, unsigned int nthreads)
+{
+	if (m_nx < 2)
+	{
+		for (unsigned int p = 0; p < NPIXEL; p++) { thr[p] = -1.0f; noise[p] = 0.0f; }
+		return;
+	}
+	const float *eff = &m_eff[0];
+	unsigned int nx = m_nx;
+	float x0 = float(m_x0);
+	ParallelFor(NPIXEL, [=](unsigned int p0, unsigned int p1)
+		{ Fit(eff, nx, x0, p0, p1, thr, noise); }, nthreads);
+}
@@ -0,0 +1,44 @@
+// scurve.h
+//
+// S-curves (hit efficiency versus DAC value) of all pixels of a ROC
+// and the fit of threshold and noise.
+//
+// The efficiencies are stored as dense array [x][pixel] with pixel =
+// col*ROC_NUMROWS + row, so that the fit runs over all pixels of one
+// DAC step in the inner loop (vectorized by the compiler) and the
+// pixels can be split over threads.
+//
+// Fit: closed-form moment estimate of the gaussian CDF. The increase
+// of efficiency between x and x+1 is the probability density at x+0.5:
+// threshold = mean, noise = standard deviation of this distribution.
+// A pixel without transition in the scan range gets threshold -1.
+
+#pragma once
+
+#include <vector>
+
+
+class CSCurves
+{
+	int m_x0;
+	unsigned int m_nx;
+	unsigned int m_ntrig;
+	std::vector<float> m_eff;
+	static void Fit(const float *eff, unsigned int nx, float x0,
+		unsigned int p0, unsigned int p1, float *thr, float *noise);
+public:
+	enum { NPIXEL = 52*80 };
+	CSCurves() : m_x0(0), m_nx(0), m_ntrig(0) {}
+	void Init(int x0, unsigned int nx, unsigned int ntrig);
+	int X0() { return m_x0; }
+	unsigned int Steps() { return m_nx; }
+	unsigned int Triggers() { return m_ntrig; }
+
+	void SetHits(unsigned int step, unsigned int col, unsigned int row, unsigned int hits)
+	{ m_eff[step*NPIXEL + col*80 + row] = float(hits)/m_ntrig; }
+	float GetEff(unsigned int step, unsigned int col, unsigned int row)
+	{ return m_eff[step*NPIXEL + col*80 + row]; }
+
+	// thr, noise: NPIXEL values
+	void Fit(float *thr, float *noise, unsigned int nthreads = 0);
+};
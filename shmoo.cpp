@@ -0,0 +1,167 @@
+// shmoo.cpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include "shmoo.h"
+
+#define SHMOO_MAGIC "SHMOO001"
+
+
+static bool PointLess(const CShmoo::Point &a, const CShmoo::Point &b)
+{
+	return (a.y < b.y) || (a.y == b.y && a.x < b.x);
+}
+
+
+bool CShmoo::Uniform(const Cell &c)
+{
+	int v = m_count[Index(c.x0, c.y0)];
+	if (v != 0 && v != int(m_ntrig)) return false;
+	return m_count[Index(c.x1, c.y0)] == v
+		&& m_count[Index(c.x0, c.y1)] == v
+		&& m_count[Index(c.x1, c.y1)] == v;
+}
+
+
+void CShmoo::Fill(const Cell &c)
+{
+	int v = m_count[Index(c.x0, c.y0)];
+	for (int y=c.y0; y<=c.y1; y++) for (int x=c.x0; x<=c.x1; x++)
+	{
+		int i = Index(x, y);
+		if (!m_measured[i]) m_count[i] = v;
+	}
+}
+
+
+// measures the points not measured yet
+bool CShmoo::MeasurePoints(std::vector<Point> &p)
+{
+	std::vector<Point> todo;
+	std::vector<int> count;
+	unsigned int i, k;
+
+	std::sort(p.begin(), p.end(), PointLess);
+	for (i=0; i<p.size(); i++)
+	{
+		if (m_measured[Index(p[i].x, p[i].y)]) continue;
+		if (!todo.empty() && todo.back().x == p[i].x && todo.back().y == p[i].y) continue;
+		todo.push_back(p[i]);
+	}
+
+	for (i=0; i<todo.size(); i+=MAXBATCH)
+	{
+		std::vector<Point> batch(todo.begin() + i,
+			todo.begin() + std::min(i + (unsigned int)MAXBATCH, (unsigned int)todo.size()));
+		if (!Measure(batch, count) || count.size() != batch.size()) return false;
+		for (k=0; k<batch.size(); k++)
+		{
+			int n = Index(batch[k].x, batch[k].y);
+			m_count[n] = std::min(count[k], int(m_ntrig));
+			m_measured[n] = true;
+			m_points++;
+		}
+	}
+	return true;
+}
+
+
+bool CShmoo::Scan(int xmin, int xmax, int ymin, int ymax, unsigned int ntrig, int step)
+{
+	m_xmin = xmin; m_xmax = xmax;
+	m_ymin = ymin; m_ymax = ymax;
+	m_ntrig = ntrig;
+	m_count.assign((xmax - xmin + 1)*(ymax - ymin + 1), -1);
+	m_measured.assign(m_count.size(), false);
+	m_points = 0;
+	if (step < 1) step = 1;
+
+	// --- coarse grid
+	std::vector<int> gx, gy;
+	int x, y;
+	for (x=xmin; x<xmax; x+=step) gx.push_back(x);
+	gx.push_back(xmax);
+	for (y=ymin; y<ymax; y+=step) gy.push_back(y);
+	gy.push_back(ymax);
+	if (gx.size() == 1) gx.push_back(xmax);
+	if (gy.size() == 1) gy.push_back(ymax);
+
+	std::vector<Point> p;
+	std::vector<Cell> cells, next;
+	unsigned int i, j;
+	for (j=0; j<gy.size(); j++) for (i=0; i<gx.size(); i++)
+	{
+		Point pt = { gx[i], gy[j] };
+		p.push_back(pt);
+	}
+	if (!MeasurePoints(p)) return false;
+
+	for (j=0; j+1<gy.size(); j++) for (i=0; i+1<gx.size(); i++)
+	{
+		Cell c = { gx[i], gy[j], gx[i+1], gy[j+1] };
+		cells.push_back(c);
+	}
+
+	// --- refine the cells on the boundary, one level at a time
+	while (!cells.empty())
+	{
+		p.clear();
+		next.clear();
+		for (i=0; i<cells.size(); i++)
+		{
+			const Cell &c = cells[i];
+			if (Uniform(c)) { Fill(c); continue; }
+
+			int xs[3], ys[3], nx = 0, ny = 0;
+			xs[nx++] = c.x0;
+			if (c.x1 - c.x0 > 1) xs[nx++] = (c.x0 + c.x1)/2;
+			if (c.x1 != c.x0) xs[nx++] = c.x1;
+			ys[ny++] = c.y0;
+			if (c.y1 - c.y0 > 1) ys[ny++] = (c.y0 + c.y1)/2;
+			if (c.y1 != c.y0) ys[ny++] = c.y1;
+			if (nx <= 2 && ny <= 2) continue; // all points are corners
+
+			for (int b=0; b<ny; b++) for (int a=0; a<nx; a++)
+			{
+				Point pt = { xs[a], ys[b] };
+				p.push_back(pt);
+			}
+			int ncx = (nx > 1) ? nx-1 : 1, ncy = (ny > 1) ? ny-1 : 1;
+			for (int b=0; b<ncy; b++) for (int a=0; a<ncx; a++)
+			{
+				Cell s = { xs[a], ys[b], xs[nx > 1 ? a+1 : a], ys[ny > 1 ? b+1 : b] };
+				next.push_back(s);
+			}
+		}
+		if (!MeasurePoints(p)) return false;
+		cells.swap(next);
+	}
+	return true;
+}
+
+
+bool CShmoo::Save(const char *filename, int vx, int vy)
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f) return false;
+	uint8_t header[8] =
+	{
+		uint8_t(vx), uint8_t(vy), uint8_t(m_xmin), uint8_t(m_xmax),
+		uint8_t(m_ymin), uint8_t(m_ymax), uint8_t(m_ntrig), 0
+	};
+	fwrite(SHMOO_MAGIC, 1, 8, f);
+	fwrite(header, 1, 8, f);
+
+	std::vector<uint8_t> row(m_xmax - m_xmin + 1);
+	for (int y=m_ymin; y<=m_ymax; y++)
+	{
+		for (int x=m_xmin; x<=m_xmax; x++)
+		{
+			int i = Index(x, y);
+			row[x - m_xmin] = uint8_t(m_count[i] & 0x7f) | (m_measured[i] ? 0 : 0x80);
+		}
+		fwrite(&row[0], 1, row.size(), f);
+	}
+	return fclose(f) == 0;
+}
@@ -0,0 +1,55 @@
+// shmoo.h
+//
+// Adaptive 2D shmoo: hit count versus two DACs. A coarse grid (step)
+// is measured first. A cell whose four corners all have no hits or all
+// have the full trigger count is filled by inference. Every other cell
+// is split in four and the new corners are measured, down to single
+// DAC steps. So only the pass/fail boundary is measured in full
+// resolution. Structures smaller than the coarse step inside a uniform
+// cell are not seen. step 1 measures every point.
+//
+// The points of one refinement level are measured in batches of up to
+// MAXBATCH points, sorted by y and x. Measure returns the hit count of
+// each point.
+//
+// binary matrix file (Save):
+//   "SHMOO001", vx, vy, xmin, xmax, ymin, ymax, ntrig, 0 (8 bytes)
+//   hit count for each y (ymin..ymax) and x (xmin..xmax),
+//   bit 7 set = inferred (not measured)
+
+#pragma once
+
+#include <vector>
+
+
+class CShmoo
+{
+public:
+	struct Point { int x, y; };
+	enum { MAXBATCH = 256 };
+private:
+	struct Cell { int x0, y0, x1, y1; };
+	int m_xmin, m_xmax, m_ymin, m_ymax;
+	unsigned int m_ntrig;
+	std::vector<int> m_count;     // index (y-ymin)*nx + x-xmin, -1 = unknown
+	std::vector<bool> m_measured;
+	unsigned long m_points;
+
+	int Index(int x, int y) { return (y - m_ymin)*(m_xmax - m_xmin + 1) + x - m_xmin; }
+	bool Uniform(const Cell &c);
+	void Fill(const Cell &c);
+	bool MeasurePoints(std::vector<Point> &p);
+protected:
+	virtual bool Measure(const std::vector<Point> &p, std::vector<int> &count) = 0;
+	unsigned int Triggers() { return m_ntrig; }
+public:
+	CShmoo() : m_xmin(0), m_xmax(-1), m_ymin(0), m_ymax(-1), m_ntrig(0), m_points(0) {}
+	virtual ~CShmoo() {}
+
+	bool Scan(int xmin, int xmax, int ymin, int ymax, unsigned int ntrig, int step);
+
+	int Get(int x, int y) { return m_count[Index(x, y)]; } // -1 = unknown
+	bool IsMeasured(int x, int y) { return m_measured[Index(x, y)]; }
+	unsigned long Points() { return m_points; } // measured points
+	bool Save(const char *filename, int vx, int vy);
+};
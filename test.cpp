@@ -477,8 +477,8 @@ void test_pixel()
 
 	aout.DetectLevel(Log);
 	aout.LevelHisto(Log);
-	aout.LevelCheck( g_chipdata.pixmap, Log);
-	aout.LevelCheck2(g_chipdata.pixmap, Log);
+	aout.LevelCheck( *g_chipdata.pixmap, Log);
+	aout.LevelCheck2(*g_chipdata.pixmap, Log);
 	tb.mDelay(1000);
 */
 }
@@ -516,9 +516,9 @@ void test_pulse_height()
 	{
 		tb.GetColPulseHeight(col,PULSE_REP, data);
 		for (row=0; row<ROC_NUMROWS; row++)
-			g_chipdata.pixmap.SetPulseHeight1(col,row, data[row]);
+			g_chipdata.pixmap->SetPulseHeight1(col,row, data[row]);
 	}
-	g_chipdata.pixmap.pulseHeight1Exist = true;
+	g_chipdata.pixmap->pulseHeight1Exist = true;
 
 
 	tb.roc_SetDAC(CtrlReg,0x04);
@@ -527,9 +527,9 @@ void test_pulse_height()
 	{
 		tb.GetColPulseHeight(col,PULSE_REP, data);
 		for (row=0; row<ROC_NUMROWS; row++)
-			g_chipdata.pixmap.SetPulseHeight2(col,row, data[row]);
+			g_chipdata.pixmap->SetPulseHeight2(col,row, data[row]);
 	}
-	g_chipdata.pixmap.pulseHeight2Exist = true;
+	g_chipdata.pixmap->pulseHeight2Exist = true;
 }
 
 
@@ -554,7 +554,7 @@ int FindPixel(int dcol, int count, CPixelAddr pix[])
 	for (x=2*dcol; x<x2; x++) for (y=0; y<ROC_NUMROWS; y++)
 	{
 		if (!(pos < count)) return pos;
-		if (!g_chipdata.pixmap.IsDefect(x,y)) { pix[pos].x = x; pix[pos].y = y; pos++; }
+		if (!g_chipdata.pixmap->IsDefect(x,y)) { pix[pos].x = x; pix[pos].y = y; pos++; }
 	}
 	return pos;
 }
@@ -881,8 +881,8 @@ void testAllPixel(int vtrim, unsigned int trimbit=100 /* reference */ )
 
 		for(row=0; row<ROC_NUMROWS; row++)
 		{
-			if (trimbit>3) g_chipdata.pixmap.SetRefLevel(col,row,res[row]);
-			else g_chipdata.pixmap.SetLevel(col,row,trimbit,res[row]);
+			if (trimbit>3) g_chipdata.pixmap->SetRefLevel(col,row,res[row]);
+			else g_chipdata.pixmap->SetLevel(col,row,trimbit,res[row]);
 		}
 	}
 }
@@ -903,7 +903,7 @@ int test_PUCs(bool forceDefTest = false)
 	testAllPixel(110, 2);
 	testAllPixel(150, 1);
 	testAllPixel(200, 0);
-	g_chipdata.pixmap.UpdateTrimDefects();
+	g_chipdata.pixmap->UpdateTrimDefects();
 
 	InitDAC();
 	return 0;
@@ -1047,10 +1047,10 @@ int test_roc(bool &repeat)
 
 	test_dac();
 
-//	g_chipdata.pixmap.Init(); is allready done
+//	g_chipdata.pixmap->Init(); is allready done
 
 	test_pixel();
-	unsigned int pixcnt = g_chipdata.pixmap.DefectPixelCount();
+	unsigned int pixcnt = g_chipdata.pixmap->DefectPixelCount();
 
 	delay_scan();
 
@@ -1069,21 +1069,21 @@ int test_roc(bool &repeat)
 	// --- Testresultat auswerten ------------------------------
 
 	Log.section("PIXMAP");
-	g_chipdata.pixmap.Print(Log);
+	g_chipdata.pixmap->Print(Log);
 	Log.section("PULSE");
-	g_chipdata.pixmap.PrintPulseHeight(Log);
-	g_chipdata.pixmap.PrintPulseHeight1(Log);
-	g_chipdata.pixmap.PrintPulseHeight2(Log);
+	g_chipdata.pixmap->PrintPulseHeight(Log);
+	g_chipdata.pixmap->PrintPulseHeight1(Log);
+	g_chipdata.pixmap->PrintPulseHeight2(Log);
 	Log.section("PUC1");
-	g_chipdata.pixmap.PrintRefLevel(Log);
+	g_chipdata.pixmap->PrintRefLevel(Log);
 	Log.section("PUC2");
-	g_chipdata.pixmap.PrintLevel(3, Log);
+	g_chipdata.pixmap->PrintLevel(3, Log);
 	Log.section("PUC3");
-	g_chipdata.pixmap.PrintLevel(2, Log);
+	g_chipdata.pixmap->PrintLevel(2, Log);
 	Log.section("PUC4");
-	g_chipdata.pixmap.PrintLevel(1, Log);
+	g_chipdata.pixmap->PrintLevel(1, Log);
 	Log.section("PUC5");
-	g_chipdata.pixmap.PrintLevel(0, Log);
+	g_chipdata.pixmap->PrintLevel(0, Log);
 
 	if (bin==4)
 	{
@@ -1107,7 +1107,7 @@ int test_roc(bool &repeat)
 	}
 
 	// count defect pixels
-	pixcnt = g_chipdata.pixmap.DefectPixelCount();
+	pixcnt = g_chipdata.pixmap->DefectPixelCount();
 
 	if      (pixcnt>=30) bin = 8;  // >= 30 pixel defect
 	else if (pixcnt>=10) bin = 9;  // >= 10 pixel defect
@@ -1120,7 +1120,7 @@ int test_roc(bool &repeat)
 	{
 		int col, row;
 		for (col=0; col<52; col++) for (row=0; row<80; row++)
-			if (g_chipdata.pixmap.GetDefectAddrCode(col,row)) addrErrors++;
+			if (g_chipdata.pixmap->GetDefectAddrCode(col,row)) addrErrors++;
 	}
 
 	if (pixcnt>0)
@@ -1224,7 +1224,7 @@ int test_roc_bumpbonder()
 	test_pixel();
 
 	Log.section("PIXMAP");
-	g_chipdata.pixmap.Print(Log);
+	g_chipdata.pixmap->Print(Log);
 
 	if (bin==4)
 	{
@@ -1244,12 +1244,12 @@ int test_roc_bumpbonder()
 	int col, row;
 	for (col=0; col<52; col++) for (row=0; row<80; row++)
 	{
-		if (g_chipdata.pixmap.GetMaskedCount(col,row) > 0) nPixUnmaskable++;
-		if (g_chipdata.pixmap.GetUnmaskedCount(col,row) == 0) nPixNoSignal++;
-		else if (g_chipdata.pixmap.GetUnmaskedCount(col,row) > 1) nPixNoisy++;
-		if (g_chipdata.pixmap.GetDefectAddrCode(col,row)) nPixAddrDefect++;
+		if (g_chipdata.pixmap->GetMaskedCount(col,row) > 0) nPixUnmaskable++;
+		if (g_chipdata.pixmap->GetUnmaskedCount(col,row) == 0) nPixNoSignal++;
+		else if (g_chipdata.pixmap->GetUnmaskedCount(col,row) > 1) nPixNoisy++;
+		if (g_chipdata.pixmap->GetDefectAddrCode(col,row)) nPixAddrDefect++;
 //		if (g_pixelmap.GetDefectTrimBit(col,row)) nPixNoTrim++;
-		if (g_chipdata.pixmap.IsDefect(col,row)) { nPixDefect++; continue; }
+		if (g_chipdata.pixmap->IsDefect(col,row)) { nPixDefect++; continue; }
 	}
 
 //	nColDefect = 0;
@@ -15,6 +15,7 @@
 #ifndef TEST_H
 #define TEST_H
 
+#include <vector>
 #include "config.h"
 
 
@@ -29,6 +30,43 @@ int test_TempSensor();
 int getTemperature();
 int test_Pixel();
 
+// threshold search mode of test_PUCs ("puc") and test_PUCsC ("pucc")
+bool SetThresholdSearch(const char *test, const char *mode);
+void PrintThresholdSearch();
+void CheckThresholdSearch(int ncol);
+
+// S-curves of all pixels (dac = Vcal or VthrComp), fit into the pixel map
+class CSCurves;
+bool GetSCurves(unsigned char dac, int xmin, int xmax, unsigned int ntrig, CSCurves &sc);
+void SetSCurveMaps(CSCurves &sc);
+
+// S-curves of the ROCs with roclist[roc] != 0 of a module, all ROCs in
+// parallel. sc[roc] for the tested ROCs.
+bool GetModuleSCurves(const int roclist[16], unsigned char dac, int xmin, int xmax,
+	unsigned int ntrig, std::vector<CSCurves> &sc);
+
+// mean pulse height of all pixels versus Vcal (high range)
+class CPhCalibration;
+bool GetPhCalibration(int xmin, int xmax, int step, unsigned int ntrig,
+	CPhCalibration &cal);
+
+// trim bits of all pixels to the Vcal threshold vcal (g_chipdata),
+// trimTest > 0: trimming in test_roc_dig
+extern int trimTest;
+bool TrimChip(int vcal, unsigned int count, std::vector<int> &level);
+void LogTrim();
+
+// DAC steps of all parallel pixel scans
+extern unsigned long parallelSteps;
+
+// test flow of test_roc_dig (filename 0 = default flow)
+class CTestFlow;
+extern CTestFlow testFlow;
+bool LoadTestFlow(const char *filename);
+
+// early stop of the trigger majority vote (batch 0 = all triggers)
+void SetTriggerVote(unsigned int batch, double alpha);
+
 // int test_roc(bool &repeat);
 int test_roc_dig(bool &repeat);
 // int test_roc_bumpbonder();
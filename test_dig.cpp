@@ -5,9 +5,15 @@
 #include "analyzer.h"
 
 #include "profiler.h"
+#include "trace.h"
+#include "threshold.h"
+#include "scurve.h"
+#include "phcal.h"
+#include "testflow.h"
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
 
 
 
@@ -116,6 +122,7 @@ void SetMHz(int MHz = 0)
 
 int test_startup(bool probecard)
 { PROFILING
+	TRACE_PHASE("startup")
 	double Idig = 0.0, Iana = 0.0;
 
 	// power on, supply current limits
@@ -185,6 +192,7 @@ int test_startup(bool probecard)
 
 int test_tout()
 { PROFILING
+	TRACE_PHASE("tout")
 
 	Log.section("TOKEN", false);
 	InitDAC();
@@ -297,6 +305,7 @@ bool CalDelScan(int col, int row)
 
 void CalDelScan()
 { PROFILING
+	TRACE_PHASE("caldelscan")
 	int i = 0;
 	while (!CalDelScan(24+2*i,40+i) && i < 4) i++;
 }
@@ -380,6 +389,7 @@ bool Check_Prog(int addr_i2c)
 
 int test_i2c()
 { PROFILING
+	TRACE_PHASE("i2c")
 	// --- init
 	Log.section("I2C");
 	tb.Pg_SetCmd(0, PG_TOK);
@@ -438,6 +448,7 @@ int test_i2c()
 
 void test_readback()
 { PROFILING
+	TRACE_PHASE("readback")
 	if ((settings.port_prober >= 0) && (g_chipdata.mapPos != 3)) return;
 
 	tb.Pg_SetCmd(0, PG_TOK);
@@ -518,6 +529,7 @@ double getIana(int dac, bool prot = false)
 
 void test_current()
 { PROFILING
+	TRACE_PHASE("current")
 	int xmin = 30;
 	tb.roc_SetDAC(VwllPr,  0);
 	tb.roc_SetDAC(VwllSh,  0);
@@ -562,6 +574,7 @@ void test_current()
 
 void test_pixel()
 { PROFILING
+	TRACE_PHASE("pixel")
 	// load settings
 	InitDAC();
 	tb.roc_Chip_Mask();
@@ -623,16 +636,16 @@ void test_pixel()
 				// must be empty readout
 
 				DecodePixel(data, pos, pix);
-				g_chipdata.pixmap.SetMaskedCount(col, row, pix.n);
+				g_chipdata.pixmap->SetMaskedCount(col, row, pix.n);
 
 				// must be single pixel hit
 				DecodePixel(data, pos, pix);
-				g_chipdata.pixmap.SetUnmaskedCount(col, row, pix.n);
+				g_chipdata.pixmap->SetUnmaskedCount(col, row, pix.n);
 				if (pix.n > 0)
 				{
-					g_chipdata.pixmap.SetDefectColCode(col, row, pix.x != col);
-					g_chipdata.pixmap.SetDefectRowCode(col, row, pix.y != row);
-					g_chipdata.pixmap.SetPulseHeight(col, row, pix.p);
+					g_chipdata.pixmap->SetDefectColCode(col, row, pix.x != col);
+					g_chipdata.pixmap->SetDefectRowCode(col, row, pix.y != row);
+					g_chipdata.pixmap->SetPulseHeight(col, row, pix.p);
 				}
 			}
 		}
@@ -649,13 +662,16 @@ void test_pixel()
 #define PULSE_VCAL1  40 // High Range
 #define PULSE_VCAL2  60 // High Range
 
-void test_pulse_height1()
+vector<uint16_t> pulseHeightData[2]; // readout of test_pulse_height1/2
+
+
+void AcquirePulseHeight(int vcal, vector<uint16_t> &data)
 { PROFILING
 	InitDAC();
 
 	// load individual settings
 	tb.roc_SetDAC(CtrlReg, 0);
-	tb.roc_SetDAC(Vcal, PULSE_VCAL1);
+	tb.roc_SetDAC(Vcal, vcal);
 	tb.roc_SetDAC(CtrlReg, 0x04);
 
 	tb.Pg_SetCmd(0, PG_RESR + 25);
@@ -694,86 +710,57 @@ void test_pulse_height1()
 	tb.Daq_Stop();
 
 	// read data
-	vector<uint16_t> data;
 	tb.Daq_Read(data, 50000);
 	tb.Daq_Close();
+}
+
 
-	// analyze data
+// host only (no DTB access), may run in parallel to the next test
+void AnalyzePulseHeight1()
+{ PROFILING
 	PixelReadoutData pix;
-	int pos = 0;
+	int col, row, pos = 0;
 	try
 	{
 		for (col=0; col<ROC_NUMCOLS; col++)	for (row=0; row<ROC_NUMROWS; row++)
 		{
-			DecodePixel(data, pos, pix);
-			if (pix.n != 0)	g_chipdata.pixmap.SetPulseHeight1(col,row, pix.p);
+			DecodePixel(pulseHeightData[0], pos, pix);
+			if (pix.n != 0)	g_chipdata.pixmap->SetPulseHeight1(col,row, pix.p);
 		}
 	} catch (int) { return; }
-	g_chipdata.pixmap.pulseHeight1Exist = true;
+	g_chipdata.pixmap->pulseHeight1Exist = true;
 }
 
 
-void test_pulse_height2()
+void AnalyzePulseHeight2()
 { PROFILING
-	InitDAC();
-
-	// load individual settings
-	tb.roc_SetDAC(CtrlReg, 0);
-	tb.roc_SetDAC(Vcal, PULSE_VCAL2);
-	tb.roc_SetDAC(CtrlReg, 0x04);
-
-	tb.Pg_SetCmd(0, PG_RESR + 25);
-	tb.Pg_SetCmd(1, PG_CAL  + 15 + tct_wbc);
-	tb.Pg_SetCmd(2, PG_TRG  + 16);
-	tb.Pg_SetCmd(3, PG_TOK);
-
-	tb.uDelay(100);
-	tb.Flush();
-
-	tb.Daq_Open(50000);
-	tb.Daq_Select_Deser160(deserAdjust);
-	tb.Daq_Start();
-
-	int col, row;
-
-	// scan data
-	for (col=0; col<ROC_NUMCOLS; col++)
-	{
-		tb.roc_Col_Enable(col, true);
-		tb.uDelay(10);
-		for (row=0; row<ROC_NUMROWS; row++)
-		{
-			tb.roc_Pix_Cal (col, row, false);
-			tb.roc_Pix_Trim(col, row, 15);
-			tb.uDelay(5);
-			tb.Pg_Single();
-			tb.uDelay(10);
-			tb.roc_Pix_Mask(col, row);
-			tb.roc_ClrCal();
-		}
-		tb.roc_Col_Enable(col, false);
-		tb.uDelay(10);
-	}
-
-	tb.Daq_Stop();
-
-	// read data
-	vector<uint16_t> data;
-	tb.Daq_Read(data, 50000);
-	tb.Daq_Close();
-
-	// analyze data
 	PixelReadoutData pix;
-	int pos = 0;
+	int col, row, pos = 0;
 	try
 	{
 		for (col=0; col<ROC_NUMCOLS; col++)	for (row=0; row<ROC_NUMROWS; row++)
 		{
-			DecodePixel(data, pos, pix);
-			if (pix.n != 0)	g_chipdata.pixmap.SetPulseHeight2(col,row, pix.p);
+			DecodePixel(pulseHeightData[1], pos, pix);
+			if (pix.n != 0)	g_chipdata.pixmap->SetPulseHeight2(col,row, pix.p);
 		}
 	} catch (int) { return; }
-	g_chipdata.pixmap.pulseHeight2Exist = true;
+	g_chipdata.pixmap->pulseHeight2Exist = true;
+}
+
+
+void test_pulse_height1()
+{ PROFILING
+	TRACE_PHASE("pulse height 1")
+	AcquirePulseHeight(PULSE_VCAL1, pulseHeightData[0]);
+	AnalyzePulseHeight1();
+}
+
+
+void test_pulse_height2()
+{ PROFILING
+	TRACE_PHASE("pulse height 2")
+	AcquirePulseHeight(PULSE_VCAL2, pulseHeightData[1]);
+	AnalyzePulseHeight2();
 }
 
 
@@ -785,14 +772,15 @@ void test_pulse_height2()
 
 void test_pulseheight()
 { PROFILING
+	TRACE_PHASE("phscan")
 	int col = 10, row = 10;
 	InitDAC();
 	tb.roc_SetDAC(Vcal, VCAL_TEST);
 	tb.roc_SetDAC(CtrlReg,0x04); // 0x04
 
-	if (g_chipdata.pixmap.GetUnmaskedCount(col, row) == 0) col += 2;
-	if (g_chipdata.pixmap.GetUnmaskedCount(col, row) == 0) col += 2;
-	if (g_chipdata.pixmap.GetUnmaskedCount(col, row) == 0) col += 2;
+	if (g_chipdata.pixmap->GetUnmaskedCount(col, row) == 0) col += 2;
+	if (g_chipdata.pixmap->GetUnmaskedCount(col, row) == 0) col += 2;
+	if (g_chipdata.pixmap->GetUnmaskedCount(col, row) == 0) col += 2;
 
 	Log.section("PHSCAN");
 
@@ -869,14 +857,116 @@ void test_pulseheight()
 //  test pixel threshold
 // =======================================================================
 
+CMajorityVote votePUC(9);   // GetPixel
+CMajorityVote votePUCC(20); // GetPixelC
+
+
 bool GetPixel(unsigned int x)
 { PROFILING
-	const unsigned int count = 9;
-	unsigned int i;
-	unsigned int n = 0;
+	unsigned int i, n;
 	tb.roc_SetDAC(VthrComp, x);
 	tb.uDelay(30);
 
+	votePUC.Start();
+	while ((n = votePUC.Next()) > 0)
+	{
+		tb.Daq_Start();
+		for (i=0; i<n; i++)
+		{
+			tb.Pg_Single();
+			tb.uDelay(5);
+		}
+		tb.Daq_Stop();
+		vector<uint16_t> data;
+		tb.Daq_Read(data, 10000);
+		int pos = 0;
+		PixelReadoutData pix;
+
+		for (i=0; i<n; i++)
+		{
+			DecodePixel(data, pos, pix);
+			votePUC.Add(pix.n > 0);
+		}
+	}
+
+	return votePUC.Result();
+}
+
+
+class CSearchVthrComp : public CThresholdSearch
+{
+	int Probe(unsigned int x) { return GetPixel(x) ? 1 : 0; }
+public:
+	CSearchVthrComp() : CThresholdSearch(1, 100) {}
+} searchPUC; // test_PUCs
+
+
+unsigned char FindLevel()
+{ PROFILING
+	static unsigned char x = 20;  // first estimation
+	if (x>80) x = 80; else if (x<1) x=1;
+
+	try
+	{
+		x = searchPUC.Find(x);
+	} catch (int) { x = 20;  return 200; }
+
+	return x;
+}
+
+
+// =======================================================================
+//  parallel pixel threshold (one pixel per double column)
+// =======================================================================
+
+struct PixelLevel
+{
+	unsigned char col, row;
+	int level;  // -1 = not found
+	unsigned int hits; // at the last DAC value
+	unsigned int phSum; // pulse height sum of the hits
+	bool fired; // majority of hits
+};
+
+bool parallelPUC  = false; // test_PUCs:  parallel scan
+bool parallelPUCC = false; // test_PUCsC: parallel scan
+unsigned long parallelSteps = 0; // DAC steps of all parallel scans
+
+
+// enables the calibrate pulse of one pixel per double column in row:
+// even (side 0) or odd (side 1) columns < ncol. The trim bits are
+// trimMap[col*ROC_NUMROWS + row] if a trim map is given.
+void SelectGroup(int row, int side, int ncol, unsigned char trim,
+	const unsigned char *trimMap, vector<PixelLevel> &pix)
+{
+	pix.clear();
+	for (int col=side; col<ncol; col+=2)
+	{
+		PixelLevel p;
+		p.col = col; p.row = row;
+		pix.push_back(p);
+		tb.roc_Pix_Trim(col, row, trimMap ? trimMap[col*ROC_NUMROWS + row] : trim);
+		tb.roc_Pix_Cal (col, row, 0);
+	}
+}
+
+
+void DeselectGroup(const vector<PixelLevel> &pix)
+{
+	tb.roc_ClrCal();
+	for (unsigned int i=0; i<pix.size(); i++) tb.roc_Pix_Mask(pix[i].col, pix[i].row);
+}
+
+
+// fires count triggers at DAC value x and sorts the hits by address
+bool GetPixels(unsigned char dac, unsigned int x, unsigned int count,
+	vector<PixelLevel> &pix)
+{ PROFILING
+	unsigned int i, k;
+	parallelSteps++;
+	tb.roc_SetDAC(dac, x);
+	tb.uDelay(30);
+
 	tb.Daq_Start();
 	for (i=0; i<count; i++)
 	{
@@ -885,40 +975,113 @@ bool GetPixel(unsigned int x)
 	}
 	tb.Daq_Stop();
 	vector<uint16_t> data;
-	tb.Daq_Read(data, 10000);
+	tb.Daq_Read(data, 30000);
+
+	vector<unsigned int> n(pix.size(), 0), ph(pix.size(), 0);
+	vector<PixelHit> hits;
+	unsigned int hdr;
 	int pos = 0;
-	PixelReadoutData pix;
+	try
+	{
+		for (i=0; i<count; i++)
+		{
+			DecodePixels(data, pos, hdr, hits);
+			for (k=0; k<hits.size(); k++)
+			{
+				unsigned int j = 0;
+				while (j<pix.size() && (pix[j].col != hits[k].x || pix[j].row != hits[k].y)) j++;
+				if (j<pix.size()) { n[j]++; ph[j] += hits[k].p; }
+			}
+		}
+	} catch (int) { return false; }
 
-	for (i=0; i<count; i++)
+	for (i=0; i<pix.size(); i++)
+	{
+		pix[i].hits = n[i];
+		pix[i].phSum = ph[i];
+		pix[i].fired = n[i] > count/2;
+	}
+	return true;
+}
+
+
+// threshold of all pixels with one DAC sweep starting at start:
+// down for the pixels firing at start, up for the others
+bool FindLevels(unsigned char dac, int lo, int hi, int start, unsigned int count,
+	vector<PixelLevel> &pix)
+{ PROFILING
+	unsigned int i, open = 0;
+	if (start < lo) start = lo; else if (start > hi) start = hi;
+	if (!GetPixels(dac, start, count, pix)) return false;
+	vector<bool> high(pix.size());
+	for (i=0; i<pix.size(); i++)
+	{
+		pix[i].level = -1;
+		high[i] = pix[i].fired;
+		if (high[i]) open++;
+	}
+
+	int x = start;
+	while (open && x > lo)
+	{
+		if (!GetPixels(dac, --x, count, pix)) return false;
+		for (i=0; i<pix.size(); i++)
+			if (high[i] && pix[i].level < 0 && !pix[i].fired) { pix[i].level = x+1; open--; }
+	}
+
+	open = 0;
+	for (i=0; i<pix.size(); i++)
+	{
+		if (high[i] && pix[i].level < 0) pix[i].level = lo;
+		if (!high[i]) open++;
+	}
+
+	x = start;
+	while (open && x < hi)
 	{
-		DecodePixel(data, pos, pix);
-		if (pix.n > 0) n++;
+		if (!GetPixels(dac, ++x, count, pix)) return false;
+		for (i=0; i<pix.size(); i++)
+			if (!high[i] && pix[i].level < 0 && pix[i].fired) { pix[i].level = x; open--; }
 	}
 
-	return n > count/2;
+	for (i=0; i<pix.size(); i++) if (pix[i].level < 0) pix[i].level = hi;
+	return true;
 }
 
 
-unsigned char FindLevel()
+// measures the first ncol columns with one pixel per double column in
+// parallel. The other pixels are masked. level[col*ROC_NUMROWS + row]
+// is -1 after a readout error. guess is updated with the median.
+void testPixelsParallel(unsigned char dac, int lo, int hi, int &guess,
+	unsigned int count, int ncol, unsigned char trim, vector<int> &level,
+	const unsigned char *trimMap = 0)
 { PROFILING
-	static unsigned char x = 20;  // first estimation
-	if (x>80) x = 80; else if (x<1) x=1;
+	int col, row, side;
+	unsigned int i;
+	vector<PixelLevel> pix;
+	vector<int> sorted;
+	level.assign(ncol*ROC_NUMROWS, -1);
 
-	try
+	for (col=0; col<ncol; col++) tb.roc_Col_Enable(col, 1);
+	for (row=0; row<ROC_NUMROWS; row++) for (side=0; side<2; side++)
 	{
-		if (GetPixel(x))
-		{
-			do x--; while (GetPixel(x) && x>0);
-			x++;
-		}
-		else
+		SelectGroup(row, side, ncol, trim, trimMap, pix);
+		if (pix.empty()) continue;
+
+		bool ok = FindLevels(dac, lo, hi, guess, count, pix);
+		DeselectGroup(pix);
+		if (!ok) continue;
+
+		sorted.clear();
+		for (i=0; i<pix.size(); i++)
 		{
-			do x++; while (!GetPixel(x) && x<100);
-			if (x>100) x=100;
+			level[pix[i].col*ROC_NUMROWS + row] = pix[i].level;
+			sorted.push_back(pix[i].level);
 		}
-	} catch (int) { x = 20;  return 200; }
-
-	return x;
+		std::nth_element(sorted.begin(), sorted.begin() + sorted.size()/2, sorted.end());
+		guess = sorted[sorted.size()/2];
+	}
+	for (col=0; col<ncol; col++) tb.roc_Col_Enable(col, 0);
 }
 
 
@@ -954,21 +1117,47 @@ void testAllPixel(int vtrim, unsigned int trimbit=4 /* reference */ )
 	unsigned int trimvalue = (trimbit<4) ? (~(0x01<<trimbit)&15) : 15;
 
 	int col, row;
+	if (parallelPUC)
+	{
+		static int guess = 20;
+		vector<int> level;
+		testPixelsParallel(VthrComp, 1, 100, guess, 9, ROC_NUMCOLS, trimvalue, level);
+		for (col=0; col<ROC_NUMCOLS; col++) for(row=0; row<ROC_NUMROWS; row++)
+		{
+			int x = level[col*ROC_NUMROWS + row];
+			if (x < 0) x = 200;
+			if (trimbit>3) g_chipdata.pixmap->SetRefLevel(col,row,x);
+			else g_chipdata.pixmap->SetLevel(col,row,trimbit,x);
+		}
+		return;
+	}
+
 	for (col=0; col<ROC_NUMCOLS; col++)
 	{
 		testColPixel(col,trimvalue,res);
 
 		for(row=0; row<ROC_NUMROWS; row++)
 		{
-			if (trimbit>3) g_chipdata.pixmap.SetRefLevel(col,row,res[row]);
-			else g_chipdata.pixmap.SetLevel(col,row,trimbit,res[row]);
+			if (trimbit>3) g_chipdata.pixmap->SetRefLevel(col,row,res[row]);
+			else g_chipdata.pixmap->SetLevel(col,row,trimbit,res[row]);
 		}
 	}
 }
 
 
-int test_PUCs(bool forceDefTest = false)
-{ PROFILING
+// DAQ buffer (words) for ntrig triggers of GetPixels: per trigger a ROC
+// header and two words per hit, at most one hit per column (the
+// selected group of SelectGroup has one pixel per double column, the
+// rest is margin for noise hits)
+unsigned int PixelsDaqSize(unsigned int ntrig)
+{
+	unsigned int size = ntrig*(1 + 2*ROC_NUMCOLS) + 100;
+	return (size > 10000) ? size : 10000;
+}
+
+
+void InitPUCs(unsigned int daqSize = 10000)
+{
 	tb.Pg_SetCmd(0, PG_RESR + 25);
 	tb.Pg_SetCmd(1, PG_CAL  + 15 + tct_wbc);
 	tb.Pg_SetCmd(2, PG_TRG  + 16);
@@ -976,18 +1165,25 @@ int test_PUCs(bool forceDefTest = false)
 	tb.uDelay(100);
 	tb.Flush();
 
-	tb.Daq_Open(10000);
+	tb.Daq_Open(daqSize);
 	tb.Daq_Select_Deser160(deserAdjust);
 
 	InitDAC();
 	tb.roc_SetDAC(Vcal, settings.sensor ? VCAL_LEVEL_SENSOR : VCAL_LEVEL);
+}
+
+
+int test_PUCs(bool forceDefTest = false)
+{ PROFILING
+	TRACE_PHASE("PUCs")
+	InitPUCs();
 
 	testAllPixel( 80);
 	testAllPixel( 80, 3);
 	testAllPixel(110, 2);
 	testAllPixel(150, 1);
 	testAllPixel(255, 0); // 200
-	g_chipdata.pixmap.UpdateTrimDefects();
+	g_chipdata.pixmap->UpdateTrimDefects();
 
 	InitDAC();
 
@@ -1020,60 +1216,54 @@ int PixelFired(vector<uint16_t> x, int &pos)
 
 int GetPixelC(unsigned int x)
 {
-	const unsigned int count = 20;
-	unsigned int i;
-	unsigned int n = 0;
+	unsigned int i, n;
 	tb.roc_SetDAC(Vcal, x);
 	tb.uDelay(30);
 
-	tb.Daq_Start();
-	for (i=0; i<count; i++)
+	votePUCC.Start();
+	while ((n = votePUCC.Next()) > 0)
 	{
-		tb.Pg_Single();
-		tb.uDelay(5);
-	}
-	tb.Daq_Stop();
-	vector<uint16_t> data;
-	tb.Daq_Read(data, 10000);
-	int pos = 0;
+		tb.Daq_Start();
+		for (i=0; i<n; i++)
+		{
+			tb.Pg_Single();
+			tb.uDelay(5);
+		}
+		tb.Daq_Stop();
+		vector<uint16_t> data;
+		tb.Daq_Read(data, 10000);
+		int pos = 0;
 
-	for (i=0; i<count; i++)
-	{
-		int res = PixelFired(data, pos);
-		if (res > 0) n++;
-		else if (res < 0) return res; 
+		for (i=0; i<n; i++)
+		{
+			int res = PixelFired(data, pos);
+			if (res < 0) return res;
+			votePUCC.Add(res > 0);
+		}
 	}
 
-	return (n > count/2) ? 1 : 0;
+	return votePUCC.Result() ? 1 : 0;
 }
 
 
+class CSearchVcal : public CThresholdSearch
+{
+	int Probe(unsigned int x) { return GetPixelC(x); }
+public:
+	CSearchVcal() : CThresholdSearch(1, 253) {}
+} searchPUCC; // test_PUCsC (host search)
+
+bool searchPUCC_dtb = true; // test_PUCsC: search on DTB (testColPixel)
+
+
 int FindLevelC()
 { PROFILING
 	static unsigned char x = 9;  // first estimation
 	if (x>253) x = 200; else if (x<1) x=1;
 
-	int res = GetPixelC(x);
+	int res = searchPUCC.Find(x);
 	if (res < 0) return res;
-	if (res > 0)
-	{
-		do
-		{
-			x--;
-			res = GetPixelC(x);
-			if (res < 0) return res;
-		} while ((res > 0) && x>0);
-		x++;
-	}
-	else
-	{
-		do
-		{
-			x++;
-			res = GetPixelC(x);
-			if (res < 0) return res;
-		} while (!(res > 0) && x<253);
-	}
+	x = res;
 
 	return x;
 }
@@ -1116,22 +1306,41 @@ bool testAllPixelC(int vtrim, unsigned int trimbit=4 /* reference */ )
 	unsigned int trimvalue = (trimbit<4) ? (~(0x01<<trimbit)&15) : 15;
 
 	int col, row;
+	if (parallelPUCC)
+	{
+		static int guess = 9;
+		vector<int> level;
+		testPixelsParallel(Vcal, 1, 253, guess, 20, ROC_NUMCOLS, trimvalue, level);
+		for (col=0; col<ROC_NUMCOLS; col++) for(row=0; row<ROC_NUMROWS; row++)
+		{
+			int x = level[col*ROC_NUMROWS + row];
+			if (x < 0) return false;
+			if (trimbit>3) g_chipdata.pixmap->SetRefLevel(col,row,x);
+			else g_chipdata.pixmap->SetLevel(col,row,trimbit,x);
+		}
+		return true;
+	}
+
 	for (col=0; col<ROC_NUMCOLS; col++)
 	{
-		if (!tb.testColPixel(col,trimvalue,res)) return false;
+		if (searchPUCC_dtb)
+		{
+			if (!tb.testColPixel(col,trimvalue,res)) return false;
+		}
+		else if (!testColPixelC(col,trimvalue,res)) return false;
 
 		for(row=0; row<ROC_NUMROWS; row++)
 		{
-			if (trimbit>3) g_chipdata.pixmap.SetRefLevel(col,row,res[row]);
-			else g_chipdata.pixmap.SetLevel(col,row,trimbit,res[row]);
+			if (trimbit>3) g_chipdata.pixmap->SetRefLevel(col,row,res[row]);
+			else g_chipdata.pixmap->SetLevel(col,row,trimbit,res[row]);
 		}
 	}
 	return true;
 }
 
 
-int test_PUCsC(bool forceDefTest = false)
-{ PROFILING
+void InitPUCsC(unsigned int daqSize = 10000)
+{
 	tb.Pg_SetCmd(0, PG_RESR + 25);
 	tb.Pg_SetCmd(1, PG_CAL  + 15 + tct_wbc);
 	tb.Pg_SetCmd(2, PG_TRG  + 16);
@@ -1139,19 +1348,26 @@ int test_PUCsC(bool forceDefTest = false)
 	tb.uDelay(100);
 	tb.Flush();
 
-	tb.Daq_Open(10000);
+	tb.Daq_Open(daqSize);
 	tb.Daq_Select_Deser160(deserAdjust);
 
 	InitDAC();
 	tb.roc_SetDAC(VthrComp, 20);
 	tb.roc_SetDAC(CtrlReg,0x00); // 0x04
+}
+
+
+int test_PUCsC(bool forceDefTest = false)
+{ PROFILING
+	TRACE_PHASE("PUCs")
+	InitPUCsC();
 
 	testAllPixelC(  0);
 	testAllPixelC(100, 3);
 	testAllPixelC(255, 2); // 110
 //	testAllPixelC(255, 1); // 150
 //	testAllPixelC(255, 0); // 200
-	g_chipdata.pixmap.UpdateTrimDefects();
+	g_chipdata.pixmap->UpdateTrimDefects();
 
 	InitDAC();
 
@@ -1162,120 +1378,696 @@ int test_PUCsC(bool forceDefTest = false)
 
 
 // =======================================================================
-//
-//    digital ROC test
-//
+//  S-curves
 // =======================================================================
 
-void test_cleanup(int bin)
-{
-	tb.Init();
+// hit efficiency of all pixels versus Vcal (setup of test_PUCsC) or
+// VthrComp (setup of test_PUCs), one pixel per double column in parallel
+bool GetSCurves(unsigned char dac, int xmin, int xmax, unsigned int ntrig, CSCurves &sc)
+{ PROFILING
+	TRACE_PHASE("scurves")
+	int col, row, side, x;
+	unsigned int i;
+	bool ok = true;
+	vector<PixelLevel> pix;
+
+	InitChip();
+	if (dac == Vcal) InitPUCsC(PixelsDaqSize(ntrig)); else InitPUCs(PixelsDaqSize(ntrig));
+	sc.Init(xmin, xmax - xmin + 1, ntrig);
+
+	for (col=0; col<ROC_NUMCOLS; col++) tb.roc_Col_Enable(col, 1);
+	for (row=0; ok && row<ROC_NUMROWS; row++) for (side=0; ok && side<2; side++)
+	{
+		SelectGroup(row, side, ROC_NUMCOLS, 15, 0, pix);
+		for (x=xmin; ok && x<=xmax; x++)
+		{
+			ok = GetPixels(dac, x, ntrig, pix);
+			for (i=0; ok && i<pix.size(); i++)
+				sc.SetHits(x - xmin, pix[i].col, pix[i].row, pix[i].hits);
+		}
+		DeselectGroup(pix);
+	}
+	for (col=0; col<ROC_NUMCOLS; col++) tb.roc_Col_Enable(col, 0);
+
+	InitDAC();
+	tb.Daq_Close();
 	tb.Flush();
-	g_chipdata.bin = bin;
-	g_chipdata.Calculate();
-	Log.section("CLASS", false);
-	Log.printf(" %i\n", g_chipdata.chipClass);
-	Log.section("POFF", false);
-	Log.printf(" %i\n", bin);
+	return ok;
 }
 
 
-int test_roc_dig(bool &repeat)
-{ PROFILING
-	repeat = false;
-	g_chipdata.InitVana = VANA0;
+// =======================================================================
+//  module: all ROCs in parallel
+// =======================================================================
 
-	tb.SetVD(2.5);
-	tb.SetID(0.4);
-	tb.SetVA(1.5);
-	tb.SetIA(0.4);
+// GetPixels for the pixel groups of the ROCs of the token chain
+// (pix[roc], empty for a ROC that is not tested). All ROCs are
+// triggered together, the hits are separated by DecodeModule.
+// Every ROC of the chain sends a header on each trigger, also the ROCs
+// that are not tested, so the chain length is taken from the number of
+// headers in the data. The hits of ROCs without pixel group are dropped.
+bool GetModulePixels(unsigned char dac, unsigned int x, unsigned int count,
+	vector< vector<PixelLevel> > &pix)
+{ PROFILING
+	unsigned int i, k, roc, nroc = pix.size();
+	parallelSteps++;
+	for (roc=0; roc<nroc; roc++) if (!pix[roc].empty())
+	{
+		tb.roc_I2cAddr(roc);
+		tb.roc_SetDAC(dac, x);
+	}
+	tb.uDelay(30);
 
-	SetMHz();
+	tb.Daq_Start();
+	for (i=0; i<count; i++)
+	{
+		tb.Pg_Single();
+		tb.uDelay(5);
+	}
+	tb.Daq_Stop();
+	vector<uint16_t> data, block;
+	uint32_t rest;
+	do
+	{
+		tb.Daq_Read(block, 30000, rest);
+		data.insert(data.end(), block.begin(), block.end());
+	} while (rest > 0 && block.size() > 0);
+
+	// ROC headers per trigger
+	unsigned int nhdr = 0;
+	for (i=0; i<data.size(); i++) if ((data[i] & 0x8ffc) == 0x87f8) nhdr++;
+	if (count == 0 || nhdr % count != 0 || nhdr/count < nroc) return false;
+	unsigned int nchain = nhdr/count;
+
+	vector< vector<unsigned int> > n(nroc);
+	for (roc=0; roc<nroc; roc++) n[roc].assign(pix[roc].size(), 0);
+	vector<unsigned int> hdr;
+	vector< vector<PixelHit> > hits;
+	int pos = 0;
+	try
+	{
+		for (i=0; i<count; i++)
+		{
+			DecodeModule(data, pos, nchain, hdr, hits);
+			for (roc=0; roc<nroc; roc++) for (k=0; k<hits[roc].size(); k++)
+			{
+				vector<PixelLevel> &p = pix[roc];
+				unsigned int j = 0;
+				while (j<p.size() && (p[j].col != hits[roc][k].x || p[j].row != hits[roc][k].y)) j++;
+				if (j<p.size()) n[roc][j]++;
+			}
+		}
+	} catch (int) { return false; }
 
-	int bin = 1;
-	tb.roc_I2cAddr(0);
-	tb.SetRocAddress(0);
+	for (roc=0; roc<nroc; roc++) for (i=0; i<pix[roc].size(); i++)
+	{
+		pix[roc][i].hits = n[roc][i];
+		pix[roc][i].fired = n[roc][i] > count/2;
+	}
+	return true;
+}
 
-	switch (test_startup(true))
+
+// GetSCurves for the selected ROCs of a module at the same time
+bool GetModuleSCurves(const int roclist[16], unsigned char dac, int xmin, int xmax,
+	unsigned int ntrig, vector<CSCurves> &sc)
+{ PROFILING
+	TRACE_PHASE("module scurves")
+	int col, row, side, x;
+	unsigned int i, k, roc;
+	bool ok = true;
+
+	// ROC i at I2C address i and position i of the token chain
+	vector<unsigned int> rocs;
+	for (roc=0; roc<16; roc++) if (roclist[roc]) rocs.push_back(roc);
+	if (rocs.empty()) return true;
+	unsigned int nroc = rocs.back() + 1;
+	vector< vector<PixelLevel> > pix(nroc);
+
+	sc.resize(nroc);
+	for (k=0; k<rocs.size(); k++)
 	{
-		case ERROR_IMAX:
-			bin = 1; // Ueberstrom
-			test_cleanup(bin);
-			return bin;
-		case ERROR_IMIN:
-			bin = 2; // kein Strom
-			test_cleanup(bin);
-			return bin;
+		roc = rocs[k];
+		tb.roc_I2cAddr(roc);
+		InitChip();
+		if (dac == Vcal) InitPUCsC(); else InitPUCs();
+		sc[roc].Init(xmin, xmax - xmin + 1, ntrig);
+		for (col=0; col<ROC_NUMCOLS; col++) tb.roc_Col_Enable(col, 1);
 	}
+	tb.Daq_Open(200000);
+	tb.Daq_Select_Deser160(deserAdjust);
 
-	if (test_tout())
+	for (row=0; ok && row<ROC_NUMROWS; row++) for (side=0; ok && side<2; side++)
 	{
-		bin = 3; // kein Token Out
-		test_cleanup(bin);
-		return bin;
+		for (k=0; k<rocs.size(); k++)
+		{
+			tb.roc_I2cAddr(rocs[k]);
+			SelectGroup(row, side, ROC_NUMCOLS, 15, 0, pix[rocs[k]]);
+		}
+		for (x=xmin; ok && x<=xmax; x++)
+		{
+			ok = GetModulePixels(dac, x, ntrig, pix);
+			for (roc=0; ok && roc<nroc; roc++) for (i=0; i<pix[roc].size(); i++)
+				sc[roc].SetHits(x - xmin, pix[roc][i].col, pix[roc][i].row, pix[roc][i].hits);
+		}
+		for (k=0; k<rocs.size(); k++)
+		{
+			tb.roc_I2cAddr(rocs[k]);
+			DeselectGroup(pix[rocs[k]]);
+		}
 	}
 
- 	switch (test_i2c())
+	for (k=0; k<rocs.size(); k++)
 	{
-	case ERROR_I2C:
-		bin = 4;
-		test_cleanup(bin);
-		return bin;
-	case ERROR_I2C0: bin = 4;
+		tb.roc_I2cAddr(rocs[k]);
+		for (col=0; col<ROC_NUMCOLS; col++) tb.roc_Col_Enable(col, 0);
+		InitDAC();
+	}
+	tb.roc_I2cAddr(rocs[0]);
+	tb.Daq_Close();
+	tb.Flush();
+	return ok;
+}
+
+
+// fits the S-curves and stores threshold and noise in the pixel map
+void SetSCurveMaps(CSCurves &sc)
+{ PROFILING
+	vector<float> thr(CSCurves::NPIXEL), noise(CSCurves::NPIXEL);
+	sc.Fit(&thr[0], &noise[0]);
+	for (int col=0; col<ROC_NUMCOLS; col++) for (int row=0; row<ROC_NUMROWS; row++)
+		g_chipdata.pixmap->SetThreshold(col, row,
+			thr[col*ROC_NUMROWS + row], noise[col*ROC_NUMROWS + row]);
+}
+
+
+// =======================================================================
+//  pulse height calibration
+// =======================================================================
+
+// mean pulse height of all pixels for Vcal = xmin, xmin+step .. xmax
+// (high range), one pixel per double column in parallel
+bool GetPhCalibration(int xmin, int xmax, int step, unsigned int ntrig,
+	CPhCalibration &cal)
+{ PROFILING
+	TRACE_PHASE("phcal")
+	int col, row, side;
+	unsigned int i, k;
+	bool ok = true;
+	vector<PixelLevel> pix;
+
+	if (step < 1) step = 1;
+	unsigned int nx = (xmax - xmin)/step + 1;
+	InitChip();
+	InitPUCsC(PixelsDaqSize(ntrig));
+	tb.roc_SetDAC(CtrlReg, 0x04);
+	cal.Init(xmin, nx, step);
+
+	for (col=0; col<ROC_NUMCOLS; col++) tb.roc_Col_Enable(col, 1);
+	for (row=0; ok && row<ROC_NUMROWS; row++) for (side=0; ok && side<2; side++)
+	{
+		SelectGroup(row, side, ROC_NUMCOLS, 15, 0, pix);
+		for (k=0; ok && k<nx; k++)
+		{
+			ok = GetPixels(Vcal, xmin + k*step, ntrig, pix);
+			for (i=0; ok && i<pix.size(); i++)
+				cal.SetPh(k, pix[i].col, pix[i].row, pix[i].hits, pix[i].phSum);
+		}
+		DeselectGroup(pix);
+	}
+	for (col=0; col<ROC_NUMCOLS; col++) tb.roc_Col_Enable(col, 0);
+
+	InitDAC();
+	tb.Daq_Close();
+	tb.Flush();
+	return ok;
+}
+
+
+// =======================================================================
+//  trim bits
+// =======================================================================
+
+int trimTest = 0; // test_roc_dig: trim target (Vcal), 0 = no trimming
+
+
+// threshold of a single pixel on any DAC at a fixed Vcal
+class CSearchDac : public CThresholdSearch
+{
+	unsigned char m_dac;
+	unsigned int m_count;
+	vector<PixelLevel> m_pix;
+	int Probe(unsigned int x)
+	{
+		if (!GetPixels(m_dac, x, m_count, m_pix)) return -1;
+		return m_pix[0].fired ? 1 : 0;
+	}
+public:
+	CSearchDac(unsigned char dac, unsigned int count, unsigned char col, unsigned char row)
+		: CThresholdSearch(0, 255, BRACKET), m_dac(dac), m_count(count), m_pix(1)
+	{ m_pix[0].col = col; m_pix[0].row = row; }
+};
+
+
+// smallest value of dac at which the pixel fires at Vcal vcal
+int FindDacLevel(unsigned char dac, int start, int col, int row,
+	unsigned char trim, int vcal, unsigned int count)
+{ PROFILING
+	tb.roc_SetDAC(Vcal, vcal);
+	tb.roc_Col_Enable(col, 1);
+	tb.roc_Pix_Trim(col, row, trim);
+	tb.roc_Pix_Cal (col, row, 0);
+	CSearchDac search(dac, count, col, row);
+	int x = search.Find(start);
+	tb.roc_ClrCal();
+	tb.roc_Pix_Mask(col, row);
+	tb.roc_Col_Enable(col, 0);
+	return x;
+}
+
+
+// fired[col*ROC_NUMROWS + row]: pixel fires at Vcal vcal with the trim map
+bool GetPixelsFired(int vcal, unsigned int count, const unsigned char *trimMap,
+	vector<bool> &fired)
+{ PROFILING
+	int col, row, side;
+	unsigned int i;
+	bool ok = true;
+	vector<PixelLevel> pix;
+	fired.assign(ROC_NUMCOLS*ROC_NUMROWS, false);
+
+	for (col=0; col<ROC_NUMCOLS; col++) tb.roc_Col_Enable(col, 1);
+	for (row=0; ok && row<ROC_NUMROWS; row++) for (side=0; ok && side<2; side++)
+	{
+		SelectGroup(row, side, ROC_NUMCOLS, 15, trimMap, pix);
+		ok = GetPixels(Vcal, vcal, count, pix);
+		for (i=0; ok && i<pix.size(); i++)
+			fired[pix[i].col*ROC_NUMROWS + row] = pix[i].fired;
+		DeselectGroup(pix);
+	}
+	for (col=0; col<ROC_NUMCOLS; col++) tb.roc_Col_Enable(col, 0);
+	return ok;
+}
+
+
+bool TrimPixels(int vcal, unsigned int count, vector<int> &level)
+{ PROFILING
+	const int NPIX = ROC_NUMCOLS*ROC_NUMROWS;
+	int p, bit, guess = vcal;
+	int pmin = -1, pmax = -1;
+	vector<unsigned char> trim(NPIX, 0), trial(NPIX);
+	vector<int> level1;
+	vector<bool> fired;
+
+	// --- VthrComp: pixel with the lowest threshold at vcal
+	tb.roc_SetDAC(Vtrim, 0);
+	testPixelsParallel(Vcal, 1, 253, guess, count, ROC_NUMCOLS, 15, level);
+	for (p=0; p<NPIX; p++)
+	{
+		if (level[p] < 0) return false;
+		if (level[p] >= 253) continue; // no hit
+		if (pmin < 0 || level[p] < level[pmin]) pmin = p;
+		if (pmax < 0 || level[p] > level[pmax]) pmax = p;
+	}
+	if (pmin < 0) return false;
+
+	int vthrcomp = FindDacLevel(VthrComp, 20,
+		pmin/ROC_NUMROWS, pmin%ROC_NUMROWS, 15, vcal, count);
+	if (vthrcomp < 0 || vthrcomp >= 255) return false;
+	tb.roc_SetDAC(VthrComp, vthrcomp);
+
+	// --- Vtrim: pixel with the highest threshold at vcal with trim bits 0
+	int vtrim = FindDacLevel(Vtrim, 40,
+		pmax/ROC_NUMROWS, pmax%ROC_NUMROWS, 0, vcal, count);
+	if (vtrim < 0) return false;
+	tb.roc_SetDAC(Vtrim, vtrim);
+	tb.uDelay(100);
+
+	// --- trim bits: largest value that still fires at vcal
+	for (bit=3; bit>=0; bit--)
+	{
+		for (p=0; p<NPIX; p++) trial[p] = trim[p] | (1<<bit);
+		if (!GetPixelsFired(vcal, count, &trial[0], fired)) return false;
+		for (p=0; p<NPIX; p++) if (fired[p]) trim[p] = trial[p];
+	}
+
+	// --- trim value or trim value + 1, the closer threshold to vcal
+	guess = vcal;
+	testPixelsParallel(Vcal, 1, 253, guess, count, ROC_NUMCOLS, 15, level, &trim[0]);
+	for (p=0; p<NPIX; p++) trial[p] = (trim[p] < 15) ? trim[p] + 1 : 15;
+	testPixelsParallel(Vcal, 1, 253, guess, count, ROC_NUMCOLS, 15, level1, &trial[0]);
+	for (p=0; p<NPIX; p++)
+	{
+		if (level[p] < 0 || level1[p] < 0) return false;
+		if (abs(level1[p] - vcal) < abs(level[p] - vcal))
+		{
+			trim[p] = trial[p];
+			level[p] = level1[p];
+		}
+	}
+
+	g_chipdata.trimVcal = vcal;
+	g_chipdata.trimVthrComp = vthrcomp;
+	g_chipdata.trimVtrim = vtrim;
+	for (p=0; p<NPIX; p++)
+		g_chipdata.pixmap->SetTrim(p/ROC_NUMROWS, p%ROC_NUMROWS, trim[p]);
+	return true;
+}
+
+
+// Trims all pixels to the Vcal threshold vcal (setup of test_PUCsC):
+//  1. VthrComp: lowest threshold (trim bits 15, Vtrim 0) at vcal
+//  2. Vtrim: highest threshold with trim bits 0 at vcal
+//  3. trim bits: successive approximation, all pixels in parallel
+//  4. trim value + 1 if its threshold is closer to vcal
+// The DACs and the trim map are stored in g_chipdata. level gets the
+// thresholds with the final trim bits (253 = no hit).
+bool TrimChip(int vcal, unsigned int count, vector<int> &level)
+{ PROFILING
+	TRACE_PHASE("trim")
+	InitChip();
+	InitPUCsC();
+	g_chipdata.trimVcal = g_chipdata.trimVthrComp = g_chipdata.trimVtrim = -1;
+
+	bool ok = TrimPixels(vcal, count, level);
+
+	InitDAC();
+	tb.Daq_Close();
+	tb.Flush();
+	return ok;
+}
+
+
+void LogTrim()
+{
+	if (g_chipdata.trimVcal < 0) return;
+	Log.section("TRIM", false);
+	Log.printf(" %i %i %i\n", g_chipdata.trimVcal,
+		g_chipdata.trimVthrComp, g_chipdata.trimVtrim);
+	g_chipdata.pixmap->PrintTrim(Log);
+}
+
+
+// =======================================================================
+//  threshold search selection and check
+// =======================================================================
+
+bool SetThresholdSearch(const char *test, const char *mode)
+{
+	CThresholdSearch::Mode m = CThresholdSearch::LINEAR;
+	bool dtb = strcmp(mode, "dtb") == 0;
+	bool parallel = strcmp(mode, "parallel") == 0;
+	if (!dtb && !parallel && !CThresholdSearch::ParseMode(mode, m)) return false;
+
+	if (strcmp(test, "puc") == 0)
+	{
+		if (dtb) return false;
+		parallelPUC = parallel;
+		if (!parallel) searchPUC.SetMode(m);
+	}
+	else if (strcmp(test, "pucc") == 0)
+	{
+		parallelPUCC = parallel;
+		searchPUCC_dtb = dtb;
+		if (!dtb && !parallel) searchPUCC.SetMode(m);
+	}
+	else return false;
+	return true;
+}
+
+
+void PrintThresholdSearch()
+{
+	printf("puc  (VthrComp): %s\n", parallelPUC ? "parallel" :
+		CThresholdSearch::ModeName(searchPUC.GetMode()));
+	printf("pucc (Vcal):     %s\n", parallelPUCC ? "parallel" : searchPUCC_dtb ? "dtb" :
+		CThresholdSearch::ModeName(searchPUCC.GetMode()));
+	if (votePUC.GetBatch())
+		printf("trigger vote:    batch %u, alpha %g\n", votePUC.GetBatch(), votePUC.GetAlpha());
+	else
+		printf("trigger vote:    all triggers\n");
+}
+
+
+void SetTriggerVote(unsigned int batch, double alpha)
+{
+	votePUC.Set(batch, alpha);
+	votePUCC.Set(batch, alpha);
+}
+
+
+void PrintSearchCheck(const char *mode, const vector<int> &ref, const vector<int> &res,
+	long probes, long triggers, double t)
+{
+	unsigned int i, same = 0, near = 0;
+	int dmax = 0;
+	for (i=0; i<res.size(); i++)
+	{
+		int d = abs(res[i] - ref[i]);
+		if (d == 0) same++;
+		if (d <= 1) near++;
+		if (d > dmax) dmax = d;
+	}
+	if (probes >= 0)
+		printf(" %-8s %8li %7.2lf %7.2lf %6u %6u %5i %8.1lf\n", mode, probes,
+			double(probes)/res.size(), double(triggers)/res.size(),
+			same, near, dmax, t*1000.0);
+	else
+		printf(" %-8s %8s %7s %7s %6u %6u %5i %8.1lf\n", mode, "-", "-", "-",
+			same, near, dmax, t*1000.0);
+}
+
+
+// runs the threshold search of test_PUCs and test_PUCsC with all modes
+// over the first ncol columns and compares the results with linear
+void CheckThresholdSearch(int ncol)
+{
+	// second linear run shows the differences caused by noise
+	const CThresholdSearch::Mode modes[4] = { CThresholdSearch::LINEAR,
+		CThresholdSearch::LINEAR, CThresholdSearch::BINARY, CThresholdSearch::BRACKET };
+	const char *name[4] = { "linear", "repeat", "binary", "bracket" };
+	const char *header =
+		" mode       probes  /pixel  trig/px  equal  +/-1  max|d|  time[ms]\n";
+	vector<int> level[4];
+	unsigned char res[ROC_NUMROWS];
+	vector<uint8_t> resC;
+	int m, col, row;
+	clock_t t;
+
+	InitChip();
+
+	// --- VthrComp threshold (test_PUCs)
+	InitPUCs();
+	tb.roc_SetDAC(Vtrim, 80);
+	printf("--- test_PUCs threshold search (%i columns) ---------------\n%s", ncol, header);
+	CThresholdSearch::Mode mode = searchPUC.GetMode();
+	for (m=0; m<4; m++)
+	{
+		searchPUC.SetMode(modes[m]);
+		searchPUC.ResetProbes();
+		votePUC.ResetStatistics();
+		t = clock();
+		for (col=0; col<ncol; col++)
+		{
+			testColPixel(col, 15, res);
+			for (row=0; row<ROC_NUMROWS; row++) level[m].push_back(res[row]);
+		}
+		PrintSearchCheck(name[m], level[0], level[m],
+			searchPUC.Probes(), votePUC.Triggers(), double(clock() - t)/CLOCKS_PER_SEC);
+	}
+	searchPUC.SetMode(mode);
+
+	vector<int> levelPar;
+	int guess = 20;
+	parallelSteps = 0;
+	t = clock();
+	testPixelsParallel(VthrComp, 1, 100, guess, 9, ncol, 15, levelPar);
+	PrintSearchCheck("parallel", level[0], levelPar, parallelSteps, parallelSteps*9,
+		double(clock() - t)/CLOCKS_PER_SEC);
+	InitDAC();
+	tb.Daq_Close();
+
+	// --- Vcal threshold (test_PUCsC)
+	InitPUCsC();
+	tb.roc_SetDAC(Vtrim, 0);
+	printf("--- test_PUCsC threshold search (%i columns) --------------\n%s", ncol, header);
+	mode = searchPUCC.GetMode();
+	for (m=0; m<4; m++)
+	{
+		level[m].clear();
+		searchPUCC.SetMode(modes[m]);
+		searchPUCC.ResetProbes();
+		votePUCC.ResetStatistics();
+		t = clock();
+		for (col=0; col<ncol; col++)
+		{
+			if (!testColPixelC(col, 15, resC)) break;
+			for (row=0; row<ROC_NUMROWS; row++) level[m].push_back(resC[row]);
+		}
+		if (level[m].size() < level[0].size())
+		{
+			printf(" %-8s readout error\n", name[m]);
+			continue;
+		}
+		PrintSearchCheck(name[m], level[0], level[m],
+			searchPUCC.Probes(), votePUCC.Triggers(), double(clock() - t)/CLOCKS_PER_SEC);
+	}
+	searchPUCC.SetMode(mode);
+
+	vector<int> levelDtb;
+	t = clock();
+	for (col=0; col<ncol; col++)
+	{
+		if (!tb.testColPixel(col, 15, resC)) break;
+		for (row=0; row<ROC_NUMROWS; row++) levelDtb.push_back(resC[row]);
+	}
+	if (levelDtb.size() == level[0].size())
+		PrintSearchCheck("dtb", level[0], levelDtb, -1, -1, double(clock() - t)/CLOCKS_PER_SEC);
+
+	guess = 9;
+	parallelSteps = 0;
+	t = clock();
+	testPixelsParallel(Vcal, 1, 253, guess, 20, ncol, 15, levelPar);
+	PrintSearchCheck("parallel", level[0], levelPar, parallelSteps, parallelSteps*20,
+		double(clock() - t)/CLOCKS_PER_SEC);
+	InitDAC();
+	tb.Daq_Close();
+	tb.Flush();
+}
+
+
+// =======================================================================
+//
+//    digital ROC test
+//
+// =======================================================================
+
+void test_cleanup(int bin)
+{
+	TRACE_PHASE("cleanup")
+	tb.Init();
+	tb.Flush();
+	g_chipdata.bin = bin;
+	g_chipdata.Calculate();
+	Log.section("CLASS", false);
+	Log.printf(" %i\n", g_chipdata.chipClass);
+	Log.section("POFF", false);
+	Log.printf(" %i\n", bin);
+}
+
+
+// --- test flow steps: return bin (> 0) to stop the dependent steps
+
+int flow_startup(CTestFlow &flow)
+{
+	switch (test_startup(true))
+	{
+		case ERROR_IMAX: return 1; // Ueberstrom
+		case ERROR_IMIN: return 2; // kein Strom
+	}
+	return 0;
+}
+
+
+int flow_tout(CTestFlow &flow)
+{
+	return test_tout() ? 3 : 0; // kein Token Out
+}
+
+
+int flow_i2c(CTestFlow &flow)
+{
+	switch (test_i2c())
+	{
+		case ERROR_I2C: return 4;
+		case ERROR_I2C0: flow.Set("bin", 4); // bin after the pixel maps
 	}
 	tb.roc_I2cAddr(0);
 	tb.SetRocAddress(0);
+	return 0;
+}
 
-	test_readback();
 
-	test_current();
+int flow_readback(CTestFlow &flow) { test_readback(); return 0; }
+int flow_current(CTestFlow &flow)  { test_current();  return 0; }
+int flow_caldel(CTestFlow &flow)   { CalDelScan();    return 0; }
 
-	CalDelScan();
 
+int flow_phscan(CTestFlow &flow)
+{
 	test_pulseheight();
 	test_pulseheight();
+	return 0;
+}
+
 
+int flow_pixel(CTestFlow &flow)
+{
 	test_pixel();
-	unsigned int pixcnt = g_chipdata.pixmap.DefectPixelCount();
+	flow.Set("pixcnt", g_chipdata.pixmap->DefectPixelCount());
+	return 0;
+}
 
-	if (pixcnt<=400)
-	{
-		test_pulse_height1();
-		test_pulse_height2();
-	}
 
-//	test_DCOLs();
+int flow_ph1(CTestFlow &flow)
+{
+	TRACE_PHASE("pulse height 1")
+	AcquirePulseHeight(PULSE_VCAL1, pulseHeightData[0]);
+	return 0;
+}
 
-	test_PUCsC(pixcnt<500);
 
-	// --- Testresultat auswerten ------------------------------
+int flow_ph2(CTestFlow &flow)
+{
+	TRACE_PHASE("pulse height 2")
+	AcquirePulseHeight(PULSE_VCAL2, pulseHeightData[1]);
+	return 0;
+}
 
+
+int flow_puc(CTestFlow &flow)
+{
+	test_PUCsC(flow.Get("pixcnt") < 500);
+	return 0;
+}
+
+
+int flow_maps(CTestFlow &flow)
+{
 	Log.section("PIXMAP");
-	g_chipdata.pixmap.Print(Log);
+	g_chipdata.pixmap->Print(Log);
 	Log.section("PULSE");
-	g_chipdata.pixmap.PrintPulseHeight(Log);
-	g_chipdata.pixmap.PrintPulseHeight1(Log);
-	g_chipdata.pixmap.PrintPulseHeight2(Log);
+	g_chipdata.pixmap->PrintPulseHeight(Log);
+	g_chipdata.pixmap->PrintPulseHeight1(Log);
+	g_chipdata.pixmap->PrintPulseHeight2(Log);
 	Log.section("PUC1");
-	g_chipdata.pixmap.PrintRefLevel(Log);
+	g_chipdata.pixmap->PrintRefLevel(Log);
 	Log.section("PUC2");
-	g_chipdata.pixmap.PrintLevel(3, Log);
+	g_chipdata.pixmap->PrintLevel(3, Log);
 	Log.section("PUC3");
-	g_chipdata.pixmap.PrintLevel(2, Log);
+	g_chipdata.pixmap->PrintLevel(2, Log);
 //	Log.section("PUC4");
-//	g_chipdata.pixmap.PrintLevel(1, Log);
+//	g_chipdata.pixmap->PrintLevel(1, Log);
 //	Log.section("PUC5");
-//	g_chipdata.pixmap.PrintLevel(0, Log);
+//	g_chipdata.pixmap->PrintLevel(0, Log);
 
-	if (bin==4)
-	{
-		test_cleanup(bin);
-		return bin;
-	}
+	return (flow.Get("bin") == 4) ? 4 : 0;
+}
 
 
+int flow_trim(CTestFlow &flow)
+{
+	vector<int> level;
+	if (TrimChip(trimTest, 10, level)) LogTrim();
+	return 0;
+}
+
+
+int flow_bin(CTestFlow &flow)
+{
 	// count defect pixels
-	pixcnt = g_chipdata.pixmap.DefectPixelCount();
+	int bin = 0;
+	unsigned int pixcnt = g_chipdata.pixmap->DefectPixelCount();
 
 	if      (pixcnt>=30) bin = 8;  // >= 30 pixel defect
 	else if (pixcnt>=10) bin = 9;  // >= 10 pixel defect
@@ -1288,22 +2080,80 @@ int test_roc_dig(bool &repeat)
 	{
 		int col, row;
 		for (col=0; col<52; col++) for (row=0; row<80; row++)
-			if (g_chipdata.pixmap.GetDefectAddrCode(col,row)) addrErrors++;
-	}
-
-	if (pixcnt>0)
-	{
-		test_cleanup(bin);
-		if (bin > 8 && addrErrors > 0) repeat = true;
-		return bin;
+			if (g_chipdata.pixmap->GetDefectAddrCode(col,row)) addrErrors++;
 	}
+	if (bin > 8 && addrErrors > 0) flow.Set("repeat", 1);
 
-	bin = 0; // no error
+	return bin;
+}
 
-	test_cleanup(bin);
 
-	return bin;
+const CTestFlow::Function flowFunction[] =
+{
+	{ "startup",  flow_startup,  0 },
+	{ "tout",     flow_tout,     0 },
+	{ "i2c",      flow_i2c,      0 },
+	{ "readback", flow_readback, 0 },
+	{ "current",  flow_current,  0 },
+	{ "caldel",   flow_caldel,   0 },
+	{ "phscan",   flow_phscan,   0 },
+	{ "pixel",    flow_pixel,    0 },
+	{ "ph1",      flow_ph1,      AnalyzePulseHeight1 },
+	{ "ph2",      flow_ph2,      AnalyzePulseHeight2 },
+	{ "puc",      flow_puc,      0 },
+	{ "maps",     flow_maps,     0 },
+	{ "trim",     flow_trim,     0 },
+	{ "bin",      flow_bin,      0 }
+};
+
+
+const char defaultFlow[] =
+	"startup\n"
+	"tout      startup\n"
+	"i2c       tout\n"
+	"readback  i2c\n"
+	"current   readback\n"
+	"caldel    current\n"
+	"phscan    caldel\n"
+	"pixel     phscan\n"
+	"ph1       pixel     pixcnt<=400\n"
+	"ph2       pixel     pixcnt<=400\n"
+	"puc       pixel\n"
+	"maps      ph1 ph2 puc\n"
+	"trim      maps      trim>0 pixcnt<500\n"
+	"bin       trim\n";
+
+
+CTestFlow testFlow(flowFunction, sizeof(flowFunction)/sizeof(flowFunction[0]), defaultFlow);
+
+
+bool LoadTestFlow(const char *filename)
+{
+	return filename ? testFlow.Load(filename) : testFlow.Parse(defaultFlow);
 }
 
 
+int test_roc_dig(bool &repeat)
+{ PROFILING
+	TRACE_PHASE("test_roc_dig")
+	repeat = false;
+	g_chipdata.InitVana = VANA0;
 
+	tb.SetVD(2.5);
+	tb.SetID(0.4);
+	tb.SetVA(1.5);
+	tb.SetIA(0.4);
+
+	SetMHz();
+
+	tb.roc_I2cAddr(0);
+	tb.SetRocAddress(0);
+
+	testFlow.Reset();
+	testFlow.Set("trim", trimTest);
+	int bin = testFlow.Run();
+	repeat = testFlow.Get("repeat") != 0;
+
+	test_cleanup(bin);
+	return bin;
+}
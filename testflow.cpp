@@ -0,0 +1,293 @@
+// testflow.cpp
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sstream>
+#include "testflow.h"
+#include "trace.h"
+
+
+enum { OP_LT, OP_LE, OP_GT, OP_GE, OP_EQ, OP_NE };
+
+static const char *opName[] = { "<", "<=", ">", ">=", "==", "!=" };
+
+
+bool CTestFlow::Cond::Eval(int x) const
+{
+	switch (op)
+	{
+		case OP_LT: return x <  value;
+		case OP_LE: return x <= value;
+		case OP_GT: return x >  value;
+		case OP_GE: return x >= value;
+		case OP_EQ: return x == value;
+		case OP_NE: return x != value;
+	}
+	return false;
+}
+
+
+const CTestFlow::Function* CTestFlow::Find(const char *name)
+{
+	for (unsigned int i=0; i<m_nfunctions; i++)
+		if (strcmp(m_function[i].name, name) == 0) return &m_function[i];
+	return 0;
+}
+
+
+bool CTestFlow::ParseCond(const std::string &s, Cond &c)
+{
+	size_t pos = s.find_first_of("<>=!");
+	if (pos == 0 || pos == std::string::npos) return false;
+	c.var = s.substr(0, pos);
+	const char *p = s.c_str() + pos;
+	for (c.op = 5; c.op >= 0; c.op--) // two char operators first
+		if (strncmp(p, opName[c.op], strlen(opName[c.op])) == 0) break;
+	if (c.op < 0) return false;
+	p += strlen(opName[c.op]);
+	char *end;
+	c.value = strtol(p, &end, 0);
+	return end != p && *end == 0;
+}
+
+
+// orders the steps by dependency, independent steps keep the file order
+bool CTestFlow::Sort(std::vector<Step> &steps)
+{
+	unsigned int i, k, n = steps.size();
+	std::map<std::string, unsigned int> index;
+	for (i=0; i<n; i++) index[steps[i].f->name] = i;
+
+	std::vector<unsigned int> order;
+	std::vector<bool> placed(n, false);
+	while (order.size() < n)
+	{
+		for (i=0; i<n; i++)
+		{
+			if (placed[i]) continue;
+			for (k=0; k<steps[i].depNames.size(); k++)
+				if (!placed[index[steps[i].depNames[k]]]) break;
+			if (k == steps[i].depNames.size()) break;
+		}
+		if (i == n)
+		{
+			printf("flow: circular dependency\n");
+			return false;
+		}
+		placed[i] = true;
+		order.push_back(i);
+	}
+
+	std::vector<Step> sorted(n);
+	std::vector<unsigned int> pos(n);
+	for (i=0; i<n; i++) pos[order[i]] = i;
+	for (i=0; i<n; i++)
+	{
+		Step &s = steps[order[i]];
+		sorted[i].f = s.f;
+		sorted[i].depNames = s.depNames;
+		sorted[i].cond = s.cond;
+		for (k=0; k<s.depNames.size(); k++)
+			sorted[i].deps.push_back(pos[index[s.depNames[k]]]);
+	}
+	steps.swap(sorted);
+	return true;
+}
+
+
+bool CTestFlow::Parse(const char *text)
+{
+	std::vector<Step> steps;
+	std::istringstream in(text);
+	std::string line, token;
+	unsigned int i, k;
+	int lineNr = 0;
+
+	while (std::getline(in, line))
+	{
+		lineNr++;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos) line.erase(comment);
+		std::istringstream words(line);
+		if (!(words >> token)) continue;
+
+		Step s;
+		s.f = Find(token.c_str());
+		if (!s.f)
+		{
+			printf("flow line %i: unknown step %s\n", lineNr, token.c_str());
+			return false;
+		}
+		for (i=0; i<steps.size(); i++) if (steps[i].f == s.f)
+		{
+			printf("flow line %i: step %s defined twice\n", lineNr, token.c_str());
+			return false;
+		}
+		while (words >> token)
+		{
+			if (token == "-") continue;
+			if (token.find_first_of("<>=!") != std::string::npos)
+			{
+				Cond c;
+				if (!ParseCond(token, c))
+				{
+					printf("flow line %i: illegal condition %s\n", lineNr, token.c_str());
+					return false;
+				}
+				s.cond.push_back(c);
+			}
+			else s.depNames.push_back(token);
+		}
+		steps.push_back(std::move(s));
+	}
+
+	for (i=0; i<steps.size(); i++) for (k=0; k<steps[i].depNames.size(); k++)
+	{
+		unsigned int j;
+		for (j=0; j<steps.size(); j++) if (steps[i].depNames[k] == steps[j].f->name) break;
+		if (j == steps.size())
+		{
+			printf("flow: step %s depends on missing step %s\n",
+				steps[i].f->name, steps[i].depNames[k].c_str());
+			return false;
+		}
+	}
+	if (!Sort(steps)) return false;
+
+	JoinAll();
+	m_steps.swap(steps);
+	Reset();
+	return true;
+}
+
+
+bool CTestFlow::Load(const char *filename)
+{
+	FILE *f = fopen(filename, "rt");
+	if (!f) { printf("flow: could not open %s\n", filename); return false; }
+	std::string text;
+	char s[256];
+	while (fgets(s, sizeof(s), f)) text += s;
+	fclose(f);
+	return Parse(text.c_str());
+}
+
+
+void CTestFlow::Reset()
+{
+	JoinAll();
+	m_var.clear();
+	for (unsigned int i=0; i<m_steps.size(); i++)
+	{
+		Step &s = m_steps[i];
+		s.state = WAITING;
+		s.bin = 0;
+		s.tAcquire = s.tAnalyze = 0.0;
+	}
+}
+
+
+int CTestFlow::Get(const char *var)
+{
+	std::map<std::string, int>::iterator it = m_var.find(var);
+	return (it != m_var.end()) ? it->second : 0;
+}
+
+
+void CTestFlow::Join(Step &s)
+{
+	if (s.analysis.joinable()) s.analysis.join();
+}
+
+
+void CTestFlow::JoinAll()
+{
+	for (unsigned int i=0; i<m_steps.size(); i++) Join(m_steps[i]);
+}
+
+
+int CTestFlow::Run()
+{
+	int bin = 0;
+	unsigned int i, k;
+	try
+	{
+		for (i=0; i<m_steps.size(); i++)
+		{
+			Step &s = m_steps[i];
+			for (k=0; k<s.deps.size(); k++)
+			{
+				Step &d = m_steps[s.deps[k]];
+				if (d.state == BINNED || d.state == BLOCKED) s.state = BLOCKED;
+				Join(d);
+			}
+			if (s.state == BLOCKED) continue;
+
+			for (k=0; k<s.cond.size(); k++)
+				if (!s.cond[k].Eval(Get(s.cond[k].var.c_str()))) break;
+			if (k < s.cond.size()) { s.state = SKIPPED; continue; }
+
+			double t = CPhaseTimer::WallTime();
+			s.bin = s.f->acquire(*this);
+			s.tAcquire = CPhaseTimer::WallTime() - t;
+			if (s.bin > 0)
+			{
+				s.state = BINNED;
+				if (!bin) bin = s.bin;
+				continue;
+			}
+
+			s.state = DONE;
+			if (s.f->analyze)
+			{
+				Analyze analyze = s.f->analyze;
+				double *tAnalyze = &s.tAnalyze;
+				s.analysis = std::thread([analyze, tAnalyze]()
+				{
+					double t = CPhaseTimer::WallTime();
+					analyze();
+					*tAnalyze = CPhaseTimer::WallTime() - t;
+				});
+			}
+		}
+	}
+	catch (...) { JoinAll(); throw; }
+	JoinAll();
+
+	return bin ? bin : Get("bin");
+}
+
+
+void CTestFlow::Print()
+{
+	for (unsigned int i=0; i<m_steps.size(); i++)
+	{
+		Step &s = m_steps[i];
+		printf("%-10s", s.f->name);
+		for (unsigned int k=0; k<s.depNames.size(); k++) printf(" %s", s.depNames[k].c_str());
+		for (unsigned int k=0; k<s.cond.size(); k++)
+			printf(" %s%s%i", s.cond[k].var.c_str(), opName[s.cond[k].op], s.cond[k].value);
+		printf("\n");
+	}
+}
+
+
+void CTestFlow::PrintTiming()
+{
+	static const char *stateName[] = { "-", "done", "skipped", "blocked", "bin" };
+	double tAcquire = 0.0, tAnalyze = 0.0;
+	printf(" step       state     acquire[ms] analyze[ms]\n");
+	for (unsigned int i=0; i<m_steps.size(); i++)
+	{
+		Step &s = m_steps[i];
+		char state[16];
+		if (s.state == BINNED) snprintf(state, sizeof(state), "bin %i", s.bin);
+		else snprintf(state, sizeof(state), "%s", stateName[s.state]);
+		printf(" %-10s %-9s %11.1f %11.1f\n", s.f->name, state,
+			s.tAcquire*1000.0, s.tAnalyze*1000.0);
+		tAcquire += s.tAcquire;
+		tAnalyze += s.tAnalyze;
+	}
+	printf(" %-10s %-9s %11.1f %11.1f\n", "total", "", tAcquire*1000.0, tAnalyze*1000.0);
+}
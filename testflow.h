@@ -0,0 +1,88 @@
+// testflow.h
+//
+// Test flow as graph of steps with dependencies. Each step is one of
+// the registered test functions (Function). Acquire talks to the DTB
+// and returns a bin (> 0) if the chip is binned by this step, 0 to go
+// on. Analyze (optional) is host analysis of the acquired data; it runs
+// in its own thread while the next steps acquire and is finished before
+// a step that depends on it starts.
+//
+// The steps run in dependency order (file order if independent).
+//   skipped  a condition is false, the dependent steps run anyway
+//   blocked  a step it depends on has binned the chip
+// The result of Run is the first bin of a step, else the flow
+// variable "bin" (deferred binning), else 0.
+//
+// flow file, one step per line, '#' starts a comment:
+//   <step> [<dependency> ...] [<var><op><value> ...]
+// op: < <= > >= == !=. All conditions must be true to run the step.
+// Variables are set by the steps (CTestFlow::Set), unknown ones are 0.
+// example:
+//   pixel   phscan
+//   ph1     pixel   pixcnt<=400
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+
+
+class CTestFlow
+{
+public:
+	typedef int (*Acquire)(CTestFlow &flow);
+	typedef void (*Analyze)();
+	struct Function
+	{
+		const char *name;
+		Acquire acquire;
+		Analyze analyze; // 0 = none
+	};
+	enum State { WAITING, DONE, SKIPPED, BLOCKED, BINNED };
+private:
+	struct Cond
+	{
+		std::string var;
+		int op;
+		int value;
+		bool Eval(int x) const;
+	};
+	struct Step
+	{
+		const Function *f;
+		std::vector<std::string> depNames;
+		std::vector<unsigned int> deps;
+		std::vector<Cond> cond;
+		State state;
+		int bin;
+		double tAcquire, tAnalyze; // s
+		std::thread analysis;
+	};
+	const Function *m_function;
+	unsigned int m_nfunctions;
+	std::vector<Step> m_steps; // dependency order
+	std::map<std::string, int> m_var;
+
+	const Function* Find(const char *name);
+	static bool ParseCond(const std::string &s, Cond &c);
+	bool Sort(std::vector<Step> &steps);
+	void Join(Step &s);
+public:
+	CTestFlow(const Function *function, unsigned int nfunctions, const char *flow = 0)
+		: m_function(function), m_nfunctions(nfunctions) { if (flow) Parse(flow); }
+	~CTestFlow() { JoinAll(); }
+
+	bool Parse(const char *text);
+	bool Load(const char *filename);
+
+	void Reset(); // clears variables and step states
+	void Set(const char *var, int value) { m_var[var] = value; }
+	int Get(const char *var);
+
+	int Run();
+	void JoinAll();
+	void Print();       // steps
+	void PrintTiming(); // step states and times of the last run
+};
@@ -0,0 +1,65 @@
+// textbuffer.h
+//
+// CTextBuffer collects the text of a file in memory, Write stores it
+// with one unbuffered fwrite. PutInt and PutFixed format like printf
+// "%i" and "%0.<decimals>f" without the format parsing; rounding ties,
+// large numbers and NaN are left to snprintf, so the text is the same.
+
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+
+
+class CTextBuffer
+{
+	std::string m_s;
+public:
+	void Clear() { m_s.clear(); }
+	const std::string& Str() const { return m_s; }
+
+	CTextBuffer& Put(const char *s) { m_s += s; return *this; }
+	CTextBuffer& Put(char c) { m_s += c; return *this; }
+
+	CTextBuffer& PutInt(long x)
+	{
+		char b[24];
+		char *p = b + sizeof(b);
+		unsigned long v = (x < 0) ? 0ul - (unsigned long)x : (unsigned long)x;
+		do { *--p = char('0' + v%10); v /= 10; } while (v);
+		if (x < 0) *--p = '-';
+		m_s.append(p, b + sizeof(b) - p);
+		return *this;
+	}
+
+	CTextBuffer& PutFixed(double x, unsigned int decimals)
+	{
+		static const double scale[7] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6 };
+		double t = (decimals < 7) ? fabs(x)*scale[decimals] : -1.0;
+		if (!(t >= 0.0 && t < 1e9) || fabs(t - floor(t) - 0.5) < 1e-6)
+		{
+			char b[352];
+			snprintf(b, sizeof(b), "%0.*f", int(decimals), x);
+			return Put(b);
+		}
+		unsigned long v = (unsigned long)floor(t + 0.5);
+		char b[24];
+		char *p = b + sizeof(b);
+		for (unsigned int i = 0; i < decimals; i++) { *--p = char('0' + v%10); v /= 10; }
+		if (decimals) *--p = '.';
+		do { *--p = char('0' + v%10); v /= 10; } while (v);
+		if (signbit(x)) *--p = '-';
+		m_s.append(p, b + sizeof(b) - p);
+		return *this;
+	}
+
+	bool Write(const char *filename) const
+	{
+		FILE *f = fopen(filename, "wt");
+		if (f == NULL) return false;
+		setvbuf(f, NULL, _IONBF, 0);
+		bool ok = fwrite(m_s.data(), 1, m_s.size(), f) == m_s.size();
+		return (fclose(f) == 0) && ok;
+	}
+};
@@ -0,0 +1,184 @@
+// threshold.cpp
+
+#include <string.h>
+#include <math.h>
+#include "threshold.h"
+
+
+int CThresholdSearch::WalkDown(int x)
+{ // x fired: step down to the last hit
+	while (x > m_lo)
+	{
+		int res = Test(x-1);
+		if (res < 0) return res;
+		if (res == 0) break;
+		x--;
+	}
+	return x;
+}
+
+
+int CThresholdSearch::WalkUp(int x)
+{ // x not fired: step up to the first hit
+	while (x < m_hi)
+	{
+		x++;
+		int res = Test(x);
+		if (res < 0) return res;
+		if (res > 0) break;
+	}
+	return x;
+}
+
+
+int CThresholdSearch::Linear(int x)
+{
+	int res = Test(x);
+	if (res < 0) return res;
+	return res ? WalkDown(x) : WalkUp(x);
+}
+
+
+int CThresholdSearch::Binary()
+{
+	int res = Test(m_hi);
+	if (res <= 0) return res < 0 ? res : m_hi;
+
+	int lo = m_lo - 1, hi = m_hi; // lo: no hit, hi: hit
+	while (hi - lo > 1)
+	{
+		int x = (lo + hi)/2;
+		res = Test(x);
+		if (res < 0) return res;
+		if (res) hi = x; else lo = x;
+	}
+	return hi;
+}
+
+
+int CThresholdSearch::Bracket(int x)
+{
+	int res = Test(x);
+	if (res < 0) return res;
+
+	// bracket the threshold with growing steps: lo no hit, hi hit
+	int lo, hi, step = 1;
+	if (res)
+	{
+		hi = x;
+		while (true)
+		{
+			if (hi <= m_lo) return m_lo;
+			x = hi - step; if (x < m_lo) x = m_lo;
+			res = Test(x);
+			if (res < 0) return res;
+			if (res == 0) { lo = x; break; }
+			hi = x; step <<= 1;
+		}
+	}
+	else
+	{
+		lo = x;
+		while (true)
+		{
+			if (lo >= m_hi) return m_hi;
+			x = lo + step; if (x > m_hi) x = m_hi;
+			res = Test(x);
+			if (res < 0) return res;
+			if (res) { hi = x; break; }
+			lo = x; step <<= 1;
+		}
+	}
+
+	// successive approximation inside the bracket
+	while (hi - lo > 1)
+	{
+		x = (lo + hi)/2;
+		res = Test(x);
+		if (res < 0) return res;
+		if (res) hi = x; else lo = x;
+	}
+
+	// confirm the transition, continue linearly if noise has fooled us
+	res = Test(hi);
+	if (res < 0) return res;
+	if (res == 0) return WalkUp(hi);
+	if (hi > m_lo)
+	{
+		res = Test(hi-1);
+		if (res < 0) return res;
+		if (res) return WalkDown(hi-1);
+	}
+	return hi;
+}
+
+
+int CThresholdSearch::Find(int start)
+{
+	if (start < m_lo) start = m_lo; else if (start > m_hi) start = m_hi;
+	switch (m_mode)
+	{
+		case BINARY:  return Binary();
+		case BRACKET: return Bracket(start);
+		default:      return Linear(start);
+	}
+}
+
+
+const char* CThresholdSearch::ModeName(Mode mode)
+{
+	switch (mode)
+	{
+		case BINARY:  return "binary";
+		case BRACKET: return "bracket";
+		default:      return "linear";
+	}
+}
+
+
+bool CThresholdSearch::ParseMode(const char *name, Mode &mode)
+{
+	if      (strcmp(name, "linear")  == 0) mode = LINEAR;
+	else if (strcmp(name, "binary")  == 0) mode = BINARY;
+	else if (strcmp(name, "bracket") == 0) mode = BRACKET;
+	else return false;
+	return true;
+}
+
+
+// === majority vote ========================================================
+
+void CMajorityVote::Set(unsigned int batch, double alpha)
+{
+	m_batch = (batch < m_count) ? batch : 0;
+	if (alpha < 1e-9) alpha = 1e-9; else if (alpha > 0.5) alpha = 0.5;
+	m_alpha = alpha;
+	m_margin = (unsigned int)ceil(log((1.0 - alpha)/alpha)/log(0.9/0.1));
+	if (m_margin < 1) m_margin = 1;
+}
+
+
+unsigned int CMajorityVote::Next()
+{
+	if (m_n == 0) return m_batch ? m_batch : m_count;
+
+	unsigned int miss = m_n - m_hits;
+	unsigned int needHit  = m_count/2 + 1;        // majority hit
+	unsigned int needMiss = m_count - m_count/2;  // majority no hit
+	if (m_n >= m_count || m_hits >= needHit || miss >= needMiss) return 0;
+	if (m_batch && (m_hits >= miss + m_margin || miss >= m_hits + m_margin)) return 0;
+
+	// smallest batch that can decide the majority
+	needHit -= m_hits;
+	needMiss -= miss;
+	return (needHit < needMiss) ? needHit : needMiss;
+}
+
+
+bool CMajorityVote::Result()
+{
+	unsigned int miss = m_n - m_hits;
+	if (m_hits > m_count/2) return true;
+	if (miss >= m_count - m_count/2) return false;
+	return m_hits > miss;
+}
@@ -0,0 +1,85 @@
+// threshold.h
+//
+// Search of the threshold of a pixel: the smallest DAC value x in
+// [lo, hi] at which Probe(x) reports a hit. Probe returns 1 (pixel
+// fired), 0 (not fired) or < 0 (readout error, search is aborted).
+// The response is assumed to be monotone in x, apart from noise at
+// the threshold.
+//
+// modes:
+//   LINEAR   walk one DAC step at a time from the start value
+//            (same result as the original FindLevel walk)
+//   BINARY   successive approximation over [lo, hi]
+//   BRACKET  exponential bracketing around the start value, binary
+//            search inside the bracket and a confirmation of the
+//            transition (x-1 no hit, x hit). If the confirmation fails
+//            (noise) the search continues linearly from there.
+//
+// If the pixel never fires the result is hi for all modes.
+//
+// CMajorityVote decides if a pixel fires from up to count triggers.
+// By default (batch 0) all triggers are sent at once, like the fixed
+// count vote of the original test. With a batch size (command vote)
+// the triggers are sent in batches and the vote stops as soon as the
+// majority is decided or a sequential probability ratio test (hit
+// probability 0.9 / 0.1) reaches the error probability alpha.
+
+#pragma once
+
+
+class CThresholdSearch
+{
+public:
+	enum Mode { LINEAR, BINARY, BRACKET };
+private:
+	Mode m_mode;
+	int m_lo, m_hi;
+	unsigned long m_probes;
+	int Test(int x) { m_probes++; return Probe(x); }
+	int WalkDown(int x);
+	int WalkUp(int x);
+	int Linear(int x);
+	int Binary();
+	int Bracket(int x);
+protected:
+	virtual int Probe(unsigned int x) = 0;
+public:
+	CThresholdSearch(int lo, int hi, Mode mode = LINEAR)
+		: m_mode(mode), m_lo(lo), m_hi(hi), m_probes(0) {}
+	virtual ~CThresholdSearch() {}
+
+	void SetMode(Mode mode) { m_mode = mode; }
+	Mode GetMode() { return m_mode; }
+	int Find(int start); // threshold or < 0 on error
+	unsigned long Probes() { return m_probes; }
+	void ResetProbes() { m_probes = 0; }
+
+	static const char* ModeName(Mode mode);
+	static bool ParseMode(const char *name, Mode &mode);
+};
+
+
+class CMajorityVote
+{
+	unsigned int m_count;  // max. number of triggers
+	unsigned int m_batch;  // first batch, 0 = all triggers at once
+	double m_alpha;
+	unsigned int m_margin; // |hits - misses| that stops the vote
+	unsigned int m_n, m_hits;
+	unsigned long m_votes, m_triggers;
+public:
+	CMajorityVote(unsigned int count, unsigned int batch = 0, double alpha = 0.01)
+		: m_count(count), m_n(0), m_hits(0), m_votes(0), m_triggers(0) { Set(batch, alpha); }
+	void Set(unsigned int batch, double alpha);
+	unsigned int GetBatch() { return m_batch; }
+	double GetAlpha() { return m_alpha; }
+
+	void Start() { m_n = m_hits = 0; m_votes++; }
+	unsigned int Next(); // triggers to send, 0 = vote decided
+	void Add(bool hit) { m_n++; m_triggers++; if (hit) m_hits++; }
+	bool Result();
+
+	unsigned long Votes() { return m_votes; }
+	unsigned long Triggers() { return m_triggers; }
+	void ResetStatistics() { m_votes = m_triggers = 0; }
+};
@@ -0,0 +1,245 @@
+// trace.cpp
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <time.h>
+#include "trace.h"
+
+
+struct CTraceEvent
+{
+	const char *name;
+	const char *category;
+	long long start;
+	long long duration;
+};
+
+
+struct CTraceBuffer
+{
+	std::mutex lock; // Add of the owner thread against Start/Stop
+	unsigned int tid;
+	unsigned int size;
+	unsigned long dropped;
+	std::vector<CTraceEvent> event;
+};
+
+
+std::atomic<bool> CTrace::active(false);
+
+static std::mutex trace_lock;
+static std::vector<CTraceBuffer*> trace_buffers; // one per thread, never freed
+static thread_local CTraceBuffer *trace_buffer = 0;
+static unsigned int trace_capacity = 0;
+static std::string trace_filename;
+
+
+long long CTrace::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+static CTraceBuffer* GetTraceBuffer()
+{
+	if (!trace_buffer)
+	{
+		std::lock_guard<std::mutex> lock(trace_lock);
+		CTraceBuffer *b = trace_buffer = new CTraceBuffer;
+		b->tid = trace_buffers.size() + 1;
+		b->size = 0;
+		b->dropped = 0;
+		b->event.resize(trace_capacity);
+		trace_buffers.push_back(b);
+	}
+	return trace_buffer;
+}
+
+
+void CTrace::Add(const char *name, const char *category, long long start, long long duration)
+{
+	CTraceBuffer *b = GetTraceBuffer();
+	std::lock_guard<std::mutex> lock(b->lock);
+	if (!IsActive()) return; // stopped since the scope began
+	if (b->size < b->event.size())
+	{
+		CTraceEvent &e = b->event[b->size++];
+		e.name = name;
+		e.category = category;
+		e.start = start;
+		e.duration = duration;
+	}
+	else b->dropped++;
+}
+
+
+bool CTrace::Start(const char *filename, unsigned int eventsPerThread)
+{
+	FILE *f = fopen(filename, "wt");
+	if (!f) return false;
+	fclose(f);
+
+	{
+		std::lock_guard<std::mutex> lock(trace_lock);
+		trace_filename = filename;
+		trace_capacity = eventsPerThread;
+		for (unsigned int i=0; i<trace_buffers.size(); i++)
+		{
+			std::lock_guard<std::mutex> buffer_lock(trace_buffers[i]->lock);
+			trace_buffers[i]->size = 0;
+			trace_buffers[i]->dropped = 0;
+			trace_buffers[i]->event.resize(trace_capacity);
+		}
+	}
+	GetTraceBuffer(); // allocate the buffer of the calling thread now
+	active = true;
+	return true;
+}
+
+
+static void WriteJsonString(FILE *f, const char *s)
+{
+	putc('"', f);
+	for (; *s; s++)
+	{
+		if (*s == '"' || *s == '\\') putc('\\', f);
+		putc(*s, f);
+	}
+	putc('"', f);
+}
+
+
+bool CTrace::Stop()
+{
+	if (!IsActive()) return false;
+	active = false;
+
+	std::lock_guard<std::mutex> lock(trace_lock);
+	unsigned int i, k;
+
+	// wait for threads within Add, later calls see active == false
+	std::vector<std::unique_lock<std::mutex> > writers;
+	for (i=0; i<trace_buffers.size(); i++)
+		writers.push_back(std::unique_lock<std::mutex>(trace_buffers[i]->lock));
+
+	FILE *f = fopen(trace_filename.c_str(), "wt");
+	if (!f) return false;
+
+	// time stamps relative to the first event, in us
+	long long t0 = -1;
+	for (i=0; i<trace_buffers.size(); i++)
+		for (k=0; k<trace_buffers[i]->size; k++)
+		{
+			long long t = trace_buffers[i]->event[k].start;
+			if (t0 < 0 || t < t0) t0 = t;
+		}
+
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+	bool first = true;
+	for (i=0; i<trace_buffers.size(); i++)
+	{
+		CTraceBuffer &b = *trace_buffers[i];
+		fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+			"\"args\":{\"name\":\"%s%u\"}}", first ? "" : ",\n", b.tid,
+			b.tid == 1 ? "main " : "thread ", b.tid);
+		first = false;
+		for (k=0; k<b.size; k++)
+		{
+			CTraceEvent &e = b.event[k];
+			fputs(",\n{\"name\":", f);
+			WriteJsonString(f, e.name);
+			fputs(",\"cat\":", f);
+			WriteJsonString(f, e.category);
+			fprintf(f, ",\"ph\":\"X\",\"ts\":%0.3f,\"dur\":%0.3f,\"pid\":1,\"tid\":%u}",
+				(e.start - t0)*1e-3, e.duration*1e-3, b.tid);
+		}
+		if (b.dropped)
+			printf("trace: %lu events of thread %u dropped (buffer full)\n", b.dropped, b.tid);
+	}
+	fputs("\n]}\n", f);
+	fclose(f);
+	return true;
+}
+
+
+// write an open trace at program exit
+static struct CTraceAutoStop { ~CTraceAutoStop() { CTrace::Stop(); } } trace_autostop;
+
+
+// === phase timer ==========================================================
+
+struct CPhaseStat
+{
+	const char *name;
+	unsigned int n;
+	double cpu, wall;
+};
+
+std::atomic<bool> CPhaseTimer::active(false);
+
+static std::mutex phase_lock;
+static std::vector<CPhaseStat> phase_stat; // in order of first appearance
+
+
+double CPhaseTimer::CpuTime()
+{
+#ifdef _WIN32
+	return double(clock())/CLOCKS_PER_SEC;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+#endif
+}
+
+
+double CPhaseTimer::WallTime()
+{
+	return CTrace::Now()*1e-9;
+}
+
+
+void CPhaseTimer::Add(const char *name, double cpu, double wall)
+{
+	std::lock_guard<std::mutex> lock(phase_lock);
+	unsigned int i;
+	for (i=0; i<phase_stat.size(); i++)
+		if (strcmp(phase_stat[i].name, name) == 0) break;
+	if (i == phase_stat.size())
+	{
+		CPhaseStat x = { name, 0, 0.0, 0.0 };
+		phase_stat.push_back(x);
+	}
+	phase_stat[i].n++;
+	phase_stat[i].cpu += cpu;
+	phase_stat[i].wall += wall;
+}
+
+
+void CPhaseTimer::Start()
+{
+	std::lock_guard<std::mutex> lock(phase_lock);
+	phase_stat.clear();
+	active = true;
+}
+
+
+void CPhaseTimer::Stop()
+{
+	active = false;
+}
+
+
+void CPhaseTimer::Report()
+{
+	std::lock_guard<std::mutex> lock(phase_lock);
+	printf(" phase              calls    cpu[s]   wall[s]\n");
+	for (unsigned int i=0; i<phase_stat.size(); i++)
+		printf(" %-16s %7u %9.3f %9.3f\n", phase_stat[i].name,
+			phase_stat[i].n, phase_stat[i].cpu, phase_stat[i].wall);
+}
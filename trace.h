@@ -0,0 +1,91 @@
+// trace.h
+//
+// Timeline recorder for test flows, RPC calls and USB transfers.
+// Events are stored in a preallocated buffer per thread and written as
+// Chrome trace (JSON) file that can be opened with chrome://tracing or
+// ui.perfetto.dev. A buffer is locked only against Start and Stop,
+// which may run while other threads still record.
+//
+// Compiled in with ENABLE_TRACING (config.h), started and stopped at
+// run time with the "trace" command. Test phases (TRACE_PHASE) are
+// always compiled in, they also feed the phase timer.
+
+#pragma once
+
+#include <atomic>
+#include "config.h"
+
+
+class CTrace
+{
+	static std::atomic<bool> active;
+public:
+	static bool IsActive() { return active.load(std::memory_order_relaxed); }
+	static long long Now(); // ns
+	static void Add(const char *name, const char *category, long long start, long long duration);
+
+	static bool Start(const char *filename, unsigned int eventsPerThread = 1000000);
+	static bool Stop(); // writes the trace file
+};
+
+
+// records the execution time of a scope
+class CTraceScope
+{
+	const char *m_name;
+	const char *m_category;
+	long long m_start;
+public:
+	CTraceScope(const char *name, const char *category)
+		: m_name(name), m_category(category)
+	{ m_start = CTrace::IsActive() ? CTrace::Now() : -1; }
+	~CTraceScope()
+	{ if (m_start >= 0) CTrace::Add(m_name, m_category, m_start, CTrace::Now() - m_start); }
+};
+
+
+// Host time per test phase (CPU time of the calling thread and wall
+// time, inclusive nested phases). Used to time replayed sessions.
+class CPhaseTimer
+{
+	static std::atomic<bool> active;
+public:
+	static bool IsActive() { return active.load(std::memory_order_relaxed); }
+	static double CpuTime(); // s
+	static double WallTime(); // s
+	static void Add(const char *name, double cpu, double wall);
+
+	static void Start(); // clears the statistics
+	static void Stop();
+	static void Report();
+};
+
+
+// marks a test phase in the trace and in the phase timer
+class CTracePhase
+{
+	CTraceScope m_scope;
+	const char *m_name;
+	double m_cpu, m_wall;
+public:
+	CTracePhase(const char *name) : m_scope(name, "phase"), m_name(name)
+	{
+		if (CPhaseTimer::IsActive())
+		{ m_cpu = CPhaseTimer::CpuTime(); m_wall = CPhaseTimer::WallTime(); }
+		else m_cpu = -1.0;
+	}
+	~CTracePhase()
+	{
+		if (m_cpu >= 0.0)
+			CPhaseTimer::Add(m_name, CPhaseTimer::CpuTime() - m_cpu, CPhaseTimer::WallTime() - m_wall);
+	}
+};
+
+
+#define TRACE_PHASE(name) CTracePhase trace_phase(name);
+
+#ifdef ENABLE_TRACING
+#define TRACE_SCOPE(name,category) CTraceScope trace_scope(name, category);
+#else
+#define TRACE_SCOPE(name,category)
+#endif
@@ -2,6 +2,8 @@
 
 
 #include "profiler.h"
+#include "trace.h"
+#include <string.h>
 #include "rpc_error.h"
 #include "usb.h"
 
@@ -84,6 +86,7 @@ bool CUSB::Open(char serialNumber[])
 	if (isUSB_open) { ftStatus = FT_DEVICE_NOT_OPENED; return false; }
 
 	m_posR = m_sizeR = m_posW = 0;
+	ftStatusW = ftStatusR = FT_OK;
 	ftStatus = FT_OpenEx(serialNumber, FT_OPEN_BY_SERIAL_NUMBER, &ftHandle);
 	if (ftStatus != FT_OK) return false;
 
@@ -108,17 +111,23 @@ void CUSB::Write(const void *buffer, unsigned int bytesToWrite)
 { PROFILING
 	if (!isUSB_open) throw CRpcError(CRpcError::WRITE_ERROR);
 
-	DWORD k=0;
-	for (k=0; k < bytesToWrite; k++)
+	const unsigned char *p = (const unsigned char*)buffer;
+	while (bytesToWrite)
 	{
 		if (m_posW >= USBWRITEBUFFERSIZE) Flush();
-		m_bufferW[m_posW++] = ((unsigned char*)buffer)[k];
+		DWORD n = USBWRITEBUFFERSIZE - m_posW;
+		if (n > bytesToWrite) n = bytesToWrite;
+		memcpy(m_bufferW + m_posW, p, n);
+		m_posW += n;
+		p += n;
+		bytesToWrite -= n;
 	}
 }
 
 
 void CUSB::Flush()
 { PROFILING
+	TRACE_SCOPE("USB Flush", "usb")
 	DWORD bytesWritten;
 	DWORD bytesToWrite = m_posW;
 	m_posW = 0;
@@ -127,30 +136,31 @@ void CUSB::Flush()
 
 	if (!bytesToWrite) return;
 
-	ftStatus = FT_Write(ftHandle, m_bufferW, bytesToWrite, &bytesWritten);
+	ftStatusW = FT_Write(ftHandle, m_bufferW, bytesToWrite, &bytesWritten);
 
-	if (ftStatus != FT_OK) throw CRpcError(CRpcError::WRITE_ERROR);
-	if (bytesWritten != bytesToWrite) { ftStatus = FT_IO_ERROR; throw CRpcError(CRpcError::WRITE_ERROR); }
+	if (ftStatusW != FT_OK) throw CRpcError(CRpcError::WRITE_ERROR);
+	if (bytesWritten != bytesToWrite) { ftStatusW = FT_IO_ERROR; throw CRpcError(CRpcError::WRITE_ERROR); }
 }
 
 
 bool CUSB::FillBuffer(DWORD minBytesToRead)
 { PROFILING
+	TRACE_SCOPE("USB FillBuffer", "usb")
 	if (!isUSB_open) return false;
 
 	DWORD bytesAvailable, bytesToRead;
 
-	ftStatus = FT_GetQueueStatus(ftHandle, &bytesAvailable);
-	if (ftStatus != FT_OK) return false;
+	ftStatusR = FT_GetQueueStatus(ftHandle, &bytesAvailable);
+	if (ftStatusR != FT_OK) return false;
 
 	if (m_posR<m_sizeR) return false;
 
 	bytesToRead = (bytesAvailable>minBytesToRead)? bytesAvailable : minBytesToRead;
 	if (bytesToRead>USBREADBUFFERSIZE) bytesToRead = USBREADBUFFERSIZE;
 
-	ftStatus = FT_Read(ftHandle, m_bufferR, bytesToRead, &m_sizeR);
+	ftStatusR = FT_Read(ftHandle, m_bufferR, bytesToRead, &m_sizeR);
 	m_posR = 0;
-	if (ftStatus != FT_OK)
+	if (ftStatusR != FT_OK)
 	{
 		m_sizeR = 0;
 		return false;
@@ -163,28 +173,28 @@ void CUSB::Read(void *buffer,  unsigned int bytesToRead)
 { PROFILING
 	if (!isUSB_open) throw CRpcError(CRpcError::READ_ERROR);
 
-	DWORD i;
-
-	for (i=0; i<bytesToRead; i++)
+	unsigned char *p = (unsigned char*)buffer;
+	while (bytesToRead)
 	{
-		if (m_posR<m_sizeR)
-			((unsigned char*)buffer)[i] = m_bufferR[m_posR++];
-
-		else
+		if (m_posR >= m_sizeR)
 		{
-			DWORD n = bytesToRead-i;
+			DWORD n = bytesToRead;
 			if (n>USBREADBUFFERSIZE) n = USBREADBUFFERSIZE;
 
 			if (!FillBuffer(n)) throw CRpcError(CRpcError::READ_ERROR);
 			if (m_sizeR < n) throw CRpcError(CRpcError::READ_ERROR);
-
-			if (m_posR<m_sizeR)
-				((unsigned char*)buffer)[i] = m_bufferR[m_posR++];
-			else
+			if (m_posR >= m_sizeR)
 			{   // timeout (bytesRead < bytesToRead)
 				throw CRpcError(CRpcError::READ_TIMEOUT);
 			}
 		}
+
+		DWORD n = m_sizeR - m_posR;
+		if (n > bytesToRead) n = bytesToRead;
+		memcpy(p, m_bufferR + m_posR, n);
+		m_posR += n;
+		p += n;
+		bytesToRead -= n;
 	}
 }
 
@@ -194,6 +204,7 @@ void CUSB::Clear()
 	if (!isUSB_open) return;
 
 	ftStatus = FT_Purge(ftHandle, FT_PURGE_RX|FT_PURGE_TX);
+	ftStatusW = ftStatusR = FT_OK;
 	m_posR = m_sizeR = 0;
 	m_posW = 0;
 }
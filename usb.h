@@ -27,7 +27,9 @@ class CUSB : public CRpcIo
 {
 	bool isUSB_open;
 	FT_HANDLE ftHandle;
-	FT_STATUS ftStatus;
+	FT_STATUS ftStatus;  // connection (open, enum, clear)
+	FT_STATUS ftStatusW; // send (send lock)
+	FT_STATUS ftStatusR; // receive (reply turn)
 
 	DWORD enumPos, enumCount;
 
@@ -44,7 +46,7 @@ public:
 	{
 		m_posR = m_sizeR = m_posW = 0;
 		isUSB_open = false;
-		ftHandle = 0; ftStatus = 0;
+		ftHandle = 0; ftStatus = ftStatusW = ftStatusR = 0;
 		enumPos = enumCount = 0;
 	}
 	~CUSB() { /* Close(); */ }
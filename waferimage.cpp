@@ -0,0 +1,368 @@
+// waferimage.cpp
+
+#include <math.h>
+#include <limits.h>
+#include "CImg.h"
+using namespace cimg_library;
+#ifdef cimg_use_png
+#include <zlib.h>
+#endif
+
+#include "color.h"
+#include "parallel.h"
+#include "waferimage.h"
+
+
+typedef CImg<unsigned char> CImage;
+
+const char * const PIXIMG_NAME[NPIXIMG] = { "defect", "thr", "ph1", "phgain", "ref" };
+
+static const unsigned char BLACK[3] = {   0,   0,   0 };
+static const unsigned char GRAY[3]  = { 128, 128, 128 };
+
+
+// font of CImg draw_text (13 pixels, RGB), built once: the font cache
+// of draw_text is not thread safe
+static CImgList<float> MakeFont()
+{
+	CImgList<float> font = CImgList<float>::font(13, true);
+	cimglist_for(font,l) font[l].resize(font[l]._width + 1, -100, -100, -100, 0);
+	cimglist_for_in(font,0,255,l) font[l].resize(-100, -100, 1, 3);
+	return font;
+}
+
+static const CImgList<float>& TextFont()
+{
+	static const CImgList<float> font = MakeFont();
+	return font;
+}
+
+
+static void TableColor(int i, unsigned char rgb[3])
+{
+	const CColor &c = COLOR_TABLE[(0 <= i && i < SIZE_OF_COLORTABLE) ? i : 1];
+	rgb[0] = (unsigned char)(c.r*255.0f + 0.5f);
+	rgb[1] = (unsigned char)(c.g*255.0f + 0.5f);
+	rgb[2] = (unsigned char)(c.b*255.0f + 0.5f);
+}
+
+
+// t = 0..1: blue, cyan, green, yellow, red
+static void HeatColor(double t, unsigned char rgb[3])
+{
+	static const unsigned char c[5][3] =
+	{ { 0, 0, 255 }, { 0, 255, 255 }, { 0, 255, 0 }, { 255, 255, 0 }, { 255, 0, 0 } };
+	if (t < 0.0) t = 0.0; else if (t > 1.0) t = 1.0;
+	double f = 4.0*t;
+	int i = int(f);
+	if (i > 3) i = 3;
+	f -= i;
+	for (int k=0; k<3; k++) rgb[k] = (unsigned char)(c[i][k] + f*(c[i+1][k] - c[i][k]) + 0.5);
+}
+
+
+// block of size x size pixels at x, y
+static void FillBlock(CImage &img, int x, int y, int size, const unsigned char rgb[3])
+{
+	for (int c=0; c<3; c++)
+	{
+		unsigned char *p = img.data(x, y, 0, c);
+		for (int i=0; i<size; i++, p += img.width()) memset(p, rgb[c], size);
+	}
+}
+
+
+#ifdef cimg_use_png
+// CImg save_png uses the default zlib level and adaptive filters; the
+// maps (uniform blocks) are written four times faster with level 1 and
+// no filter, at about the same size
+static bool SavePng(const CImage &img, const char filename[])
+{
+	FILE *f = fopen(filename, "wb");
+	if (f == NULL) return false;
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
+	png_infop info = png ? png_create_info_struct(png) : 0;
+	std::vector<png_byte> row(3*img.width());
+	volatile bool ok = false;
+	if (info && !setjmp(png_jmpbuf(png)))
+	{
+		png_init_io(png, f);
+		png_set_compression_level(png, Z_BEST_SPEED);
+		png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+		png_set_IHDR(png, info, img.width(), img.height(), 8, PNG_COLOR_TYPE_RGB,
+			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+		png_write_info(png, info);
+		for (int y=0; y<img.height(); y++)
+		{
+			const unsigned char *r = img.data(0, y, 0, 0), *g = img.data(0, y, 0, 1), *b = img.data(0, y, 0, 2);
+			for (int x=0; x<img.width(); x++)
+			{
+				row[3*x] = r[x]; row[3*x+1] = g[x]; row[3*x+2] = b[x];
+			}
+			png_write_row(png, &row[0]);
+		}
+		png_write_end(png, info);
+		ok = true;
+	}
+	if (png) png_destroy_write_struct(&png, info ? &info : (png_infopp)0);
+	return (fclose(f) == 0) && ok;
+}
+#endif
+
+
+static bool Save(CImage &img, const char filename[])
+{
+#ifdef cimg_use_png
+	if (!cimg::strcasecmp(cimg::split_filename(filename), "png")) return SavePng(img, filename);
+#endif
+	try { img.save(filename); }
+	catch (CImgException &) { return false; }
+	return true;
+}
+
+
+// <waferId>_<row><col><pos> as the XML files, test_chip chips by chip id
+static std::string ChipName(CChip &chip)
+{
+	char s[96];
+	if (chip.mapX || chip.mapY || !chip.chipId[0])
+		snprintf(s, sizeof(s), "%s_%i%i%c", chip.waferId, chip.mapY, chip.mapX, "ABCD"[chip.mapPos & 3]);
+	else snprintf(s, sizeof(s), "%s_%s", chip.waferId, chip.chipId);
+	return s;
+}
+
+
+// === wafer map =========================================================
+
+#define WCELL    12  // chip cell (with 1 pixel gap)
+#define WDIE      3  // additional gap between dies
+#define WMARGIN  10
+#define WHEADER  40
+#define WLEGEND 100
+#define WLINE    16  // legend line
+
+bool WaferImage(CWaferDataBase &db, const char filename[], unsigned int mode)
+{
+	int bincount;
+	const int *color;
+	const char *type;
+	switch (mode)
+	{
+		case 0:  bincount = 13; color = COLOR_BIN;   type = "bin";       break;
+		case 1:  bincount = 24; color = COLOR_FAIL;  type = "fail code"; break;
+		case 2:  bincount = 5;  color = COLOR_CLASS; type = "class";     break;
+		default: return false;
+	}
+
+	CChip *p = db.GetFirst();
+	if (!p) return false;
+
+	// chip grid: x = 2*mapX + pos%2, y = 2*mapY + 1 - pos/2
+	int xmin = INT_MAX, xmax = INT_MIN, ymin = INT_MAX, ymax = INT_MIN;
+	unsigned int n = 0;
+	for (CChip *q = p; q; q = CWaferDataBase::GetNext(q))
+	{
+		if (2*q->mapX   < xmin) xmin = 2*q->mapX;
+		if (2*q->mapX+1 > xmax) xmax = 2*q->mapX+1;
+		if (2*q->mapY   < ymin) ymin = 2*q->mapY;
+		if (2*q->mapY+1 > ymax) ymax = 2*q->mapY+1;
+		n++;
+	}
+	int nx = xmax - xmin + 1, ny = ymax - ymin + 1;
+	int gw = nx*WCELL + (nx/2)*WDIE, gh = ny*WCELL + (ny/2)*WDIE;
+	int legendh = (bincount + 1)*WLINE;
+	CImage img(2*WMARGIN + gw + WLEGEND, WHEADER + ((gh > legendh) ? gh : legendh) + WMARGIN, 1, 3, 255);
+	const CImgList<float> &font = TextFont();
+
+	img.draw_text(WMARGIN, 4, "%s  %s  %s", BLACK, 0, 1.0f, font, p->productId, p->waferId, p->startTime);
+	img.draw_text(WMARGIN, 20, "%s map, %u chips", BLACK, 0, 1.0f, font, type, n);
+
+	int yield[32] = { 0 };
+	unsigned char rgb[3];
+	for (; p; p = CWaferDataBase::GetNext(p))
+	{
+		int v;
+		switch (mode)
+		{
+			case 1:  v = p->failCode;  break;
+			case 2:  v = p->chipClass-1; break;
+			default: v = p->bin;
+		}
+		if (0 <= v && v < bincount) { yield[v]++; TableColor(color[v], rgb); }
+		else memcpy(rgb, GRAY, 3);
+
+		int cx = 2*p->mapX + p->mapPos%2 - xmin;
+		int cy = ymax - (2*p->mapY + 1 - p->mapPos/2);
+		int x = WMARGIN + cx*WCELL + (cx/2)*WDIE;
+		int y = WHEADER + cy*WCELL + (cy/2)*WDIE;
+		img.draw_rectangle(x, y, x+WCELL-2, y+WCELL-2, rgb);
+	}
+
+	// legend: color and count of each value
+	int x = 2*WMARGIN + gw;
+	for (int v=0; v<bincount; v++)
+	{
+		int y = WHEADER + v*WLINE;
+		TableColor(color[v], rgb);
+		img.draw_rectangle(x, y, x+WCELL-2, y+WCELL-2, rgb);
+		img.draw_text(x + WCELL + 4, y-1, "%2i: %i", BLACK, 0, 1.0f, font, (mode == 2) ? v+1 : v, yield[v]);
+	}
+
+	return Save(img, filename);
+}
+
+
+// === pixel maps ========================================================
+
+#define PSCALE    4  // image pixels per ROC pixel
+#define PMARGIN  10
+#define PHEADER  24
+#define PBAR     12  // heat scale
+#define PLABEL   50
+
+static bool RenderPixelImage(CChip &chip, unsigned int type, const char filename[],
+	const CImgList<float> &font)
+{
+	std::shared_ptr<CPixelMap> mapRef = chip.pixmap.Get();
+	CPixelMap &map = *mapRef;
+	int col, row;
+
+	// values, NAN: no value
+	static const float NOVALUE = NAN;
+	float v[ROCNUMCOLS][ROCNUMROWS];
+	switch (type)
+	{
+	case PIXIMG_DEFECT:
+		if (!map.mapExist) return false;
+		break;
+	case PIXIMG_REFLEVEL: // [PUC1]
+		if (!map.levelExist) return false;
+		for (col=0; col<ROCNUMCOLS; col++) for (row=0; row<ROCNUMROWS; row++)
+		{
+			int y = map.GetRefLevel(col,row);
+			v[col][row] = (y < 100) ? float(y) : NOVALUE;
+		}
+		break;
+	case PIXIMG_THRESHOLD:
+		if (!map.scurveExist) return false;
+		for (col=0; col<ROCNUMCOLS; col++) for (row=0; row<ROCNUMROWS; row++)
+		{
+			float thr = map.GetThreshold(col,row);
+			v[col][row] = (thr >= 0.0f) ? thr : NOVALUE;
+		}
+		break;
+	case PIXIMG_PH1:
+	case PIXIMG_PHGAIN:
+		if (!map.pulseHeight1Exist || (type == PIXIMG_PHGAIN && !map.pulseHeight2Exist)) return false;
+		for (col=0; col<ROCNUMCOLS; col++) for (row=0; row<ROCNUMROWS; row++)
+		{
+			int ph1 = map.GetPulseHeight1(col,row);
+			int ph2 = (type == PIXIMG_PHGAIN) ? map.GetPulseHeight2(col,row) : 0;
+			v[col][row] = (ph1 < 10000 && ph2 < 10000) ? float((type == PIXIMG_PHGAIN) ? ph2-ph1 : ph1) : NOVALUE;
+		}
+		break;
+	default: return false;
+	}
+
+	int gw = ROCNUMCOLS*PSCALE, gh = ROCNUMROWS*PSCALE;
+	CImage img(2*PMARGIN + gw + ((type == PIXIMG_DEFECT) ? 0 : PMARGIN + PBAR + PLABEL),
+		PHEADER + gh + PMARGIN, 1, 3, 255);
+	img.draw_text(PMARGIN, 4, "%s %s", BLACK, 0, 1.0f, font, ChipName(chip).c_str(), PIXIMG_NAME[type]);
+
+	unsigned char rgb[3];
+	if (type == PIXIMG_DEFECT)
+	{
+		unsigned char c[7][3];
+		TableColor(8, c[0]);  // good
+		TableColor(0, c[1]);  // no signal
+		TableColor(5, c[2]);  // unmaskable
+		TableColor(23, c[3]); // noisy
+		TableColor(14, c[4]); // address
+		TableColor(21, c[5]); // trim bit
+		TableColor(1, c[6]);  // other
+		for (col=0; col<ROCNUMCOLS; col++) for (row=0; row<ROCNUMROWS; row++)
+		{
+			int i;
+			if (!map.IsDefect(col,row))                 i = 0;
+			else if (map.GetUnmaskedCount(col,row) == 0) i = 1;
+			else if (map.GetMaskedCount(col,row) > 0)    i = 2;
+			else if (map.GetUnmaskedCount(col,row) > 1)  i = 3;
+			else if (map.GetDefectAddrCode(col,row))     i = 4;
+			else if (map.GetDefectTrimBit(col,row))      i = 5;
+			else i = 6;
+			FillBlock(img, PMARGIN + col*PSCALE, PHEADER + (ROCNUMROWS-1-row)*PSCALE, PSCALE, c[i]);
+		}
+		return Save(img, filename);
+	}
+
+	// heat scale: mean +/- 3 std, limited to the values
+	int n = 0;
+	double sum = 0.0, sum2 = 0.0, vmin = 0.0, vmax = 0.0;
+	for (col=0; col<ROCNUMCOLS; col++) for (row=0; row<ROCNUMROWS; row++)
+	{
+		double x = v[col][row];
+		if (isnan(x)) continue;
+		if (n == 0 || x < vmin) vmin = x;
+		if (n == 0 || x > vmax) vmax = x;
+		sum += x;
+		sum2 += x*x;
+		n++;
+	}
+	double lo = 0.0, hi = 1.0;
+	if (n)
+	{
+		double mean = sum/n, var = sum2/n - mean*mean;
+		double d = 3.0*((var > 0.0) ? sqrt(var) : 0.0);
+		lo = (mean - d > vmin) ? mean - d : vmin;
+		hi = (mean + d < vmax) ? mean + d : vmax;
+		if (hi <= lo) hi = lo + 1.0;
+	}
+
+	for (col=0; col<ROCNUMCOLS; col++) for (row=0; row<ROCNUMROWS; row++)
+	{
+		if (isnan(v[col][row])) memcpy(rgb, GRAY, 3);
+		else HeatColor((v[col][row] - lo)/(hi - lo), rgb);
+		FillBlock(img, PMARGIN + col*PSCALE, PHEADER + (ROCNUMROWS-1-row)*PSCALE, PSCALE, rgb);
+	}
+
+	int x = 2*PMARGIN + gw;
+	for (int y=0; y<gh; y++)
+	{
+		HeatColor(1.0 - double(y)/(gh-1), rgb);
+		img.draw_line(x, PHEADER + y, x+PBAR-1, PHEADER + y, rgb);
+	}
+	img.draw_text(x + PBAR + 4, PHEADER - 2,       "%0.1f", BLACK, 0, 1.0f, font, hi);
+	img.draw_text(x + PBAR + 4, PHEADER + gh - 12, "%0.1f", BLACK, 0, 1.0f, font, lo);
+
+	return Save(img, filename);
+}
+
+
+bool PixelImage(CChip &chip, unsigned int type, const char filename[])
+{
+	return RenderPixelImage(chip, type, filename, TextFont());
+}
+
+
+unsigned int PixelImages(CWaferDataBase &db, unsigned int type,
+	const char dir[], const char ext[], unsigned int nthreads)
+{
+	if (type >= NPIXIMG) return 0;
+	std::vector<CChip*> list;
+	for (CChip *p = db.GetFirst(); p; p = db.GetNext(p)) list.push_back(p);
+
+	const CImgList<float> &font = TextFont();
+	std::vector<char> ok(list.size(), 0);
+	ParallelFor(list.size(), [&](unsigned int i0, unsigned int i1)
+	{
+		for (unsigned int i = i0; i < i1; i++)
+		{
+			std::string name = ChipName(*list[i]) + "_" + PIXIMG_NAME[type] + "." + ext;
+			ok[i] = RenderPixelImage(*list[i], type, PathJoin(dir, name.c_str()).c_str(), font);
+		}
+	}, nthreads);
+
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < ok.size(); i++) if (ok[i]) count++;
+	return count;
+}
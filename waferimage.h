@@ -0,0 +1,42 @@
+// waferimage.h
+//
+// Raster images of the wafer database (CImg), an alternative to the
+// PostScript maps of GenerateWaferMap. The format follows the file
+// extension: .ppm is written by CImg itself, .png with libpng if the
+// build defines cimg_use_png (else CImg calls an external converter).
+//
+// WaferImage: bin, fail code or class map (mode 0, 1, 2 as in
+//   GenerateWaferMap), one cell per chip at its map position (chips
+//   A B over C D in a die), with the count of each value as legend.
+// PixelImage: 52x80 map of one chip, column to the right, row 0 at the
+//   bottom. PIXIMG_DEFECT shows the defect classes (green good, black
+//   no signal, red unmaskable, yellow noisy, blue address, orange trim
+//   bit, gray other), the other types a heat scale over mean +/- 3 std
+//   (gray: no value).
+// PixelImages: the maps of all chips, rendered in parallel, into
+//   <dir>/<waferId>_<chip>_<type>.<ext>. Returns the number of images.
+
+#pragma once
+
+#include "chipdatabase.h"
+
+
+enum
+{
+	PIXIMG_DEFECT,
+	PIXIMG_THRESHOLD, // S-curve threshold
+	PIXIMG_PH1,       // pulse height PH1
+	PIXIMG_PHGAIN,    // PH2 - PH1
+	PIXIMG_REFLEVEL,  // trim reference level (PUC1)
+	NPIXIMG
+};
+
+extern const char * const PIXIMG_NAME[NPIXIMG]; // file name suffix
+
+
+bool WaferImage(CWaferDataBase &db, const char filename[], unsigned int mode);
+
+bool PixelImage(CChip &chip, unsigned int type, const char filename[]);
+
+unsigned int PixelImages(CWaferDataBase &db, unsigned int type,
+	const char dir[], const char ext[] = "png", unsigned int nthreads = 0);
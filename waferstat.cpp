@@ -0,0 +1,146 @@
+// waferstat.cpp
+
+#include <math.h>
+#include <string.h>
+#include "trace.h"
+#include "waferstat.h"
+
+
+void CWaferStatistics::Reset(const char waferId[])
+{
+	m_waferId = waferId;
+	m_chips.clear();
+	m_tests = 0;
+	m_tBegin = m_tLast = 0.0;
+
+	memset(m_bin, 0, sizeof(m_bin));
+	memset(m_fail, 0, sizeof(m_fail));
+	memset(m_class, 0, sizeof(m_class));
+	m_pick1 = 0;
+	memset(m_defect, 0, sizeof(m_defect));
+	m_defectSum = m_defectSum2 = 0.0;
+	m_colDefect = 0;
+
+	memset(m_window, 0, sizeof(m_window));
+	m_windowPos = m_windowGood = 0;
+}
+
+
+void CWaferStatistics::Count(const Result &r, int sign)
+{
+	m_bin[r.bin] += sign;
+	if (0 <= r.failCode && r.failCode < NFAIL) m_fail[r.failCode] += sign;
+	if (1 <= r.chipClass && r.chipClass <= NCLASS) m_class[r.chipClass-1] += sign;
+	if (r.pickClass == 1) m_pick1 += sign;
+
+	int d = r.nPixDefect;
+	m_defect[(d <= 0) ? 0 : (d <= 4) ? 1 : (d <= 40) ? 2 : 3] += sign;
+	m_defectSum  += sign*double(d);
+	m_defectSum2 += sign*double(d)*d;
+	if (r.nColDefect > 0) m_colDefect += sign;
+}
+
+
+void CWaferStatistics::Add(CChip &chip, int bin)
+{
+	if (m_tests && m_waferId != chip.waferId)
+	{ // next wafer
+		if (!m_file.empty()) WriteFile();
+		Reset(chip.waferId);
+	}
+	if (m_tests == 0) { m_waferId = chip.waferId; m_tBegin = CPhaseTimer::WallTime(); }
+	m_tLast = CPhaseTimer::WallTime();
+
+	Result r;
+	r.bin = (bin < 0) ? 0 : (bin < NBINS) ? bin : NBINS-1;
+	r.failCode   = chip.failCode;
+	r.chipClass  = chip.chipClass;
+	r.pickClass  = chip.pickClass;
+	r.nPixDefect = chip.nPixDefect;
+	r.nColDefect = chip.nColDefect;
+
+	char key[96];
+	snprintf(key, sizeof(key), "%i %i %i %s", chip.mapX, chip.mapY, chip.mapPos, chip.chipId);
+
+	std::pair<std::unordered_map<std::string, Result>::iterator, bool> it
+		= m_chips.insert(std::make_pair(std::string(key), r));
+	if (it.second) Count(r, 1);
+	else if (r.failCode > it.first->second.failCode)
+	{ // retest with a higher fail code replaces the former result
+		Count(it.first->second, -1);
+		it.first->second = r;
+		Count(r, 1);
+	}
+
+	// trend
+	bool good = r.pickClass == 1;
+	if (m_tests >= WINDOW && m_window[m_windowPos]) m_windowGood--;
+	m_window[m_windowPos] = good;
+	if (good) m_windowGood++;
+	m_windowPos = (m_windowPos + 1) % WINDOW;
+	m_tests++;
+
+	if (m_alarm > 0.0 && m_tests >= WINDOW && RecentYield() < m_alarm)
+		printf(" yield alarm: %0.1f%% pick class 1 in the last %i chips\n", RecentYield(), int(WINDOW));
+
+	if (!m_file.empty() && m_tests % m_period == 0 && !WriteFile())
+		printf(" could not write %s\n", m_file.c_str());
+}
+
+
+double CWaferStatistics::RecentYield()
+{
+	unsigned int n = (m_tests < WINDOW) ? m_tests : WINDOW;
+	return n ? m_windowGood*100.0/n : 0.0;
+}
+
+
+bool CWaferStatistics::SetFile(const char filename[], unsigned int period)
+{
+	m_file = filename;
+	m_period = period ? period : 1;
+	return m_file.empty() || WriteFile();
+}
+
+
+bool CWaferStatistics::WriteFile()
+{
+	std::string tmp = m_file + ".tmp";
+	FILE *f = fopen(tmp.c_str(), "wt");
+	if (f == NULL) return false;
+	Print(f);
+	if (fclose(f) != 0) return false;
+#ifdef _WIN32
+	remove(m_file.c_str());
+#endif
+	return rename(tmp.c_str(), m_file.c_str()) == 0;
+}
+
+
+void CWaferStatistics::Print(FILE *f)
+{
+	int i, n = m_chips.size();
+	double rate = (m_tests > 1 && m_tLast > m_tBegin) ? (m_tests-1)*3600.0/(m_tLast-m_tBegin) : 0.0;
+
+	fprintf(f,"wafer:  %s\n", m_waferId.c_str());
+	fprintf(f,"tests:  %u (%0.0f/h)\n", m_tests, rate);
+	fprintf(f,"#Chips: %4i\n#fail: ", n);
+	for (i=0; i<NFAIL; i++) fprintf(f," %4i", m_fail[i]);
+	fputs("\n%fail: ",f);
+	for (i=0; i<NFAIL; i++) fprintf(f," %4.1f", n ? m_fail[i]*100.0/n : 0.0);
+	fprintf(f,"\n#Class:  ");
+	for (i=0; i<NCLASS; i++) fprintf(f," %4i", m_class[i]);
+	fputs("\n%Class:  ",f);
+	for (i=0; i<NCLASS; i++) fprintf(f," %4.1f", n ? m_class[i]*100.0/n : 0.0);
+	fprintf(f,"\n#Bin:   ");
+	for (i=0; i<NBINS; i++) fprintf(f," %4i", m_bin[i]);
+	fprintf(f,"\nyield:   %4.1f%% (pick class 1), last %u tests %4.1f%%\n",
+		Yield(), (m_tests < WINDOW) ? m_tests : unsigned(WINDOW), RecentYield());
+
+	double mean = n ? m_defectSum/n : 0.0;
+	double var  = n ? m_defectSum2/n - mean*mean : 0.0;
+	fprintf(f,"pixel defects: mean %0.2f, std %0.2f\n", mean, (var > 0.0) ? sqrt(var) : 0.0);
+	fprintf(f,"#Defect: 0: %i, 1-4: %i, 5-40: %i, >40: %i\n",
+		m_defect[0], m_defect[1], m_defect[2], m_defect[3]);
+	fprintf(f,"dcol defect: %i chips\n", m_colDefect);
+}
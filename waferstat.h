@@ -0,0 +1,87 @@
+// waferstat.h
+//
+// Running statistics of the chips tested on the current wafer, updated
+// by test_wafer/test_chip after each chip (command wstat). Add costs
+// O(1): a retested chip replaces its former result like in the wafer
+// database (the result with the highest fail code counts). Chips are
+// identified by wafer position and chip id: test_wafer has no chip id,
+// test_chip no position (unlike the database, chips at map position
+// 0/0 are distinguished). A chip of another wafer starts a new
+// statistics.
+//
+// The summary file is rewritten after each <period> chips, at the end
+// of a wafer and by Save at the end of a go run (written to <file>.tmp
+// and renamed, so a viewer never sees a partial file). The yield of the
+// last WINDOW tests is the trend of the wafer; below the alarm level a
+// warning is printed.
+
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include "chipdatabase.h"
+
+
+class CWaferStatistics
+{
+public:
+	enum
+	{
+		NBINS   = 25,
+		NFAIL   = CChip::FAIL_NOFAIL+1,
+		NCLASS  = 5,
+		NDEFECT = 4,   // pixel defects 0, 1..4, 5..40, > 40 (class limits)
+		WINDOW  = 50
+	};
+
+private:
+	struct Result
+	{
+		int bin, failCode, chipClass, pickClass, nPixDefect, nColDefect;
+	};
+
+	std::string m_waferId;
+	std::unordered_map<std::string, Result> m_chips;
+	unsigned int m_tests;
+	double m_tBegin, m_tLast;
+
+	// sums over the counted result of each chip
+	int m_bin[NBINS];
+	int m_fail[NFAIL];
+	int m_class[NCLASS];
+	int m_pick1;
+	int m_defect[NDEFECT];
+	double m_defectSum, m_defectSum2;
+	int m_colDefect;
+
+	// trend
+	bool m_window[WINDOW];
+	unsigned int m_windowPos, m_windowGood;
+
+	std::string m_file;
+	unsigned int m_period;
+	double m_alarm;
+
+	void Count(const Result &r, int sign);
+	bool WriteFile();
+public:
+	CWaferStatistics() : m_period(10), m_alarm(0.0) { Reset(); }
+
+	void Reset(const char waferId[] = "");
+	void Add(CChip &chip, int bin); // evaluated chip (after CChip::Calculate)
+
+	bool SetFile(const char filename[], unsigned int period); // "" = no file
+	bool Save() { return m_file.empty() || m_tests == 0 || WriteFile(); } // end of a run
+	const char* File() { return m_file.c_str(); }
+	unsigned int Period() { return m_period; }
+	void SetAlarm(double percent) { m_alarm = percent; }
+	double Alarm() { return m_alarm; }
+
+	unsigned int Chips() { return m_chips.size(); }
+	unsigned int Tests() { return m_tests; }
+	double Yield() { return m_chips.size() ? m_pick1*100.0/m_chips.size() : 0.0; }
+	double RecentYield(); // last WINDOW tests
+
+	void Print(FILE *f);
+};